@@ -13,16 +13,22 @@
 #include <xiaoLog/exports.h>
 #include <xiaoLog/NonCopyable.h>
 #include <xiaoLog/Date.h>
+#include <xiaoLog/LoggerFile.h>
+#include <xiaoLog/LogSink.h>
 #include <memory>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <future>
 
 namespace xiaoLog
 {
-    using StringPtr = std::shared_ptr<std::string>;
     using StringPtrQueue = std::queue<StringPtr>;
+    class AsyncLogExecutor;
 
     /**
      * @brief This class implements utility functions for writing logs
@@ -32,6 +38,33 @@ namespace xiaoLog
     class XIAOLOG_EXPORT AsyncFileLogger : NonCopyable
     {
     public:
+        /**
+         * @brief How the logging thread waits for buffers.
+         *
+         * - kBlocking: sleep on a condition variable. Producers wake the
+         *   thread with a futex call when they hand over a buffer.
+         * - kAdaptive: spin for a while, then yield, then sleep like
+         *   kBlocking. Producers only make a syscall if the thread sleeps.
+         * - kBusyPoll: spin all the time, meant for a dedicated core.
+         *   Producers never make a syscall to wake the thread.
+         *
+         * In all modes an idle logger with an empty buffer doesn't wake up
+         * periodically, except kBusyPoll which never sleeps.
+         */
+        enum class WaitStrategy
+        {
+            kBlocking = 0,
+            kAdaptive,
+            kBusyPoll
+        };
+
+        /**
+         * @brief The length of the header of a sequenced record, see
+         * setRecordSequence().
+         *
+         */
+        static constexpr size_t kRecordHeaderLength{26};
+
         /**
          * @brief Write the message to the log file.
          *
@@ -41,17 +74,144 @@ namespace xiaoLog
         void output(const char *msg, const uint64_t len);
 
         /**
-         * @brief Flush data from memory buffer to the log file.
+         * @brief Flush data from memory buffer to the log file. The buffer is
+         * handed over by the logging thread when the coalescing delay has
+         * passed, flushes requested while one is pending are merged into it.
          *
          */
         void flush();
 
+        /**
+         * @brief Flush and wait until all the messages output before the call
+         * are written to the log file.
+         *
+         * @param sync Also wait until they are synced to the disk.
+         */
+        void flushAndWait(bool sync = false)
+        {
+            flushAsync(sync).wait();
+        }
+
+        /**
+         * @brief Flush and return a future which becomes ready when all the
+         * messages output before the call are written to the log file. If
+         * logging is not started, the messages are written by the caller.
+         *
+         * @param sync Also wait until they are synced to the disk.
+         * @return std::future<void>
+         */
+        std::future<void> flushAsync(bool sync = false);
+
         /**
          * @brief Strat writing log files.
          *
          */
         void startLogging();
 
+        /**
+         * @brief Set how the logging thread waits for buffers. It must be
+         * called before startLogging() and has no effect with an executor.
+         *
+         * @param strategy
+         */
+        void setWaitStrategy(WaitStrategy strategy)
+        {
+            waitStrategy_ = strategy;
+        }
+
+        /**
+         * @brief Set the max time a message stays in the memory buffer before
+         * it's written to the file. The default is 1 second.
+         *
+         * @param interval
+         */
+        void setFlushInterval(std::chrono::microseconds interval)
+        {
+            flushInterval_ = interval;
+        }
+
+        /**
+         * @brief Set how long a flush() may be delayed so that the flushes of
+         * a burst of errors are written together. The default is 0, the
+         * flush is done as soon as the logging thread wakes up.
+         *
+         * @param delay
+         */
+        void setFlushCoalesceDelay(std::chrono::microseconds delay)
+        {
+            flushCoalesceDelay_ = delay;
+        }
+
+        /**
+         * @brief Pin the logging thread to the given CPUs. It must be called
+         * before startLogging().
+         *
+         * @param cpus
+         */
+        void setThreadAffinity(std::vector<int> cpus)
+        {
+            cpuAffinity_ = std::move(cpus);
+        }
+
+        /**
+         * @brief Set the scheduling policy and priority of the logging thread,
+         * e.g. SCHED_FIFO. It must be called before startLogging().
+         *
+         * @param policy
+         * @param priority
+         */
+        void setThreadScheduling(int policy, int priority)
+        {
+            schedPolicy_ = policy;
+            schedPriority_ = priority;
+        }
+
+        /**
+         * @brief Place the memory buffers on a NUMA node. The logging thread
+         * runs on the CPUs of the node unless setThreadAffinity() is used.
+         * It must be called before startLogging().
+         *
+         * @param node
+         */
+        void setNumaNode(int node)
+        {
+            numaNode_ = node;
+        }
+
+        /**
+         * @brief Set whether the memory buffers are backed by transparent huge
+         * pages.
+         *
+         * @param flag
+         */
+        void setHugePageBuffers(bool flag = true)
+        {
+            hugePageBuffers_ = flag;
+        }
+
+        /**
+         * @brief Set whether the memory buffers are locked in RAM with mlock.
+         * The buffers are always prefaulted in startLogging().
+         *
+         * @param flag
+         */
+        void setLockBuffers(bool flag = true)
+        {
+            lockBuffers_ = flag;
+        }
+
+        /**
+         * @brief Let a shared AsyncLogExecutor write the log files instead of
+         * a thread owned by this logger. It must be called before
+         * startLogging().
+         *
+         * @param executor
+         */
+        void setExecutor(std::shared_ptr<AsyncLogExecutor> executor)
+        {
+            executor_ = std::move(executor);
+        }
+
         /**
          * @brief Set the size limit of log files. When the log file size reaches
          * the limit, the log file is switched.
@@ -74,6 +234,78 @@ namespace xiaoLog
             maxFiles_ = maxFiles;
         }
 
+        /**
+         * @brief Set the max total size of log files. When the total size of
+         * the rotated log files exceeds the limit, the oldest log files will
+         * be deleted.
+         *
+         * @param bytes
+         */
+        void setMaxTotalSize(uint64_t bytes)
+        {
+            maxTotalSize_ = bytes;
+        }
+
+        /**
+         * @brief Set the max age of log files. Rotated log files older than
+         * the age will be deleted.
+         *
+         * @param age
+         */
+        void setMaxFileAge(std::chrono::seconds age)
+        {
+            maxFileAge_ = age;
+        }
+
+        /**
+         * @brief Set whether to compress the rotated log files with gzip.
+         *
+         * @param flag
+         */
+        void setCompressRotatedFiles(bool flag = true)
+        {
+            compressRotatedFiles_ = flag;
+        }
+
+        /**
+         * @brief Set whether to close, compress and delete the rotated log
+         * files in a housekeeping thread instead of the logging thread. The
+         * next log file is opened in advance so switching the log file
+         * doesn't stall writing.
+         *
+         * @param flag
+         */
+        void setAsyncHousekeeping(bool flag = true)
+        {
+            asyncHousekeeping_ = flag;
+        }
+
+        /**
+         * @brief Set the wall-clock period to switch the log file, hourly or
+         * daily. It works together with the size limit.
+         *
+         * @param period
+         * @param localTime Whether the period boundaries are in local time or
+         * in UTC.
+         */
+        void setRotationPeriod(LoggerFile::RotationPeriod period,
+                               bool localTime = false)
+        {
+            rotationPeriod_ = period;
+            rotateInLocalTime_ = localTime;
+        }
+
+        /**
+         * @brief Set whether to move the rotated log files into one directory
+         * per day. Retention limits are then applied to whole days.
+         *
+         * @param flag
+         */
+        void setDirectoryPerDay(bool flag = true)
+        {
+            directoryPerDay_ = flag;
+        }
+
         /**
          * @brief Set whether to switch the log file when the AsyncFileLogger object
          * is destroyed. If this flag is set to true, the log file is not switched
@@ -86,6 +318,99 @@ namespace xiaoLog
             switchOnLimitOnly_ = flag;
         }
 
+        /**
+         * @brief Set the way buffers are written to the log file. It must be
+         * called before the first log is written.
+         *
+         * @param mode
+         */
+        void setFileWriteMode(LoggerFile::WriteMode mode)
+        {
+            writeMode_ = mode;
+        }
+
+        /**
+         * @brief Set the compression dictionary of the
+         * LoggerFile::WriteMode::kFramed write mode. It must be called before
+         * the first log is written.
+         *
+         * @param dictionary See FramedLog::trainDictionary().
+         */
+        void setFrameDictionary(std::string dictionary)
+        {
+            frameDictionary_ = std::move(dictionary);
+        }
+
+        /**
+         * @brief Set when the log file is synced to the disk. It must be
+         * called before the first log is written.
+         *
+         * @param policy
+         * @param syncBytes See LoggerFile::setSyncPolicy().
+         * @param syncInterval See LoggerFile::setSyncPolicy().
+         */
+        void setSyncPolicy(LoggerFile::SyncPolicy policy,
+                           uint64_t syncBytes = 0,
+                           std::chrono::milliseconds syncInterval =
+                               std::chrono::milliseconds(0))
+        {
+            syncPolicy_ = policy;
+            syncBytes_ = syncBytes;
+            syncInterval_ = syncInterval;
+        }
+
+        /**
+         * @brief Keep a sparse time and level index beside each log file, for
+         * the xiaolog-query tool. It must be called before the first log is
+         * written.
+         *
+         * @param bytes The size of the indexed blocks, e.g. 64 KiB. 0
+         * disables the index.
+         */
+        void setIndexInterval(uint64_t bytes)
+        {
+            indexInterval_ = bytes;
+        }
+
+        /**
+         * @brief Make flush() wait until the data is synced to the disk. The
+         * Logger calls the flush function for ERROR and FATAL messages, so
+         * these are on the disk when the log statement returns.
+         *
+         * @param flag
+         */
+        void setSyncOnFlush(bool flag = true)
+        {
+            syncOnFlush_ = flag;
+        }
+
+        /**
+         * @brief Write the buffers to a sink instead of the log files, e.g.
+         * a DatagramSink. The file settings are ignored then. It must be
+         * called before startLogging().
+         *
+         * @param sink
+         */
+        void setSink(std::shared_ptr<LogSink> sink)
+        {
+            sink_ = std::move(sink);
+        }
+
+        /**
+         * @brief Prefix every message with a number taken from the sequence.
+         * The number is taken while the message is put into the buffer, so
+         * several loggers sharing a sequence each write an ascending file and
+         * the files can be merged by number. The header is the number in 16
+         * hex digits, a space, the message length in 8 hex digits and a space.
+         * It must be called before startLogging().
+         *
+         * @param sequence
+         */
+        void setRecordSequence(std::shared_ptr<std::atomic<uint64_t>> sequence)
+        {
+            recordSequence_ = std::move(sequence);
+        }
+
         void setFileName(const std::string &baseName,
                          const std::string &extName = ".log",
                          const std::string &path = "./")
@@ -103,6 +428,7 @@ namespace xiaoLog
         AsyncFileLogger();
 
     protected:
+        friend class AsyncLogExecutor;
         std::mutex mutex_;
         std::condition_variable cond_;
         StringPtr logBufferPtr_;
@@ -111,53 +437,81 @@ namespace xiaoLog
         StringPtrQueue tmpBuffers_;
         void writeLogToFile(const StringPtr buf);
         std::unique_ptr<std::thread> threadPtr_;
-        bool stopFlag_{false};
+        std::atomic<bool> stopFlag_{false};
         void logThreadFunc();
+        void waitForBuffers();
+        bool spinForBuffers(std::chrono::steady_clock::time_point deadline);
+        WaitStrategy waitStrategy_{WaitStrategy::kBlocking};
+        std::chrono::microseconds flushInterval_{std::chrono::seconds(1)};
+        std::atomic<uint64_t> swapCount_{0};
+        uint64_t lastSwapCount_{0};
+        bool backendParked_{false};
+        void applyThreadPlacement();
+        void placeBuffer(const StringPtr &buf);
+        void prefaultBuffer(const StringPtr &buf);
+        // Allocate a buffer when none is free, called with mutex_ held.
+        StringPtr newBuffer();
+        std::vector<int> cpuAffinity_;
+        int schedPolicy_{-1};
+        int schedPriority_{0};
+        int numaNode_{-1};
+        bool hugePageBuffers_{false};
+        bool lockBuffers_{false};
+        struct FlushWaiter
+        {
+            uint64_t swapCount;
+            bool sync;
+            std::promise<void> promise;
+        };
+        void completeFlushWaiters(bool all);
+        std::vector<FlushWaiter> flushWaiters_;
+        std::atomic<bool> syncRequested_{false};
+        void requestFlush();
+        bool flushDue(std::chrono::steady_clock::time_point now) const
+        {
+            return now.time_since_epoch().count() >=
+                   flushDeadline_.load(std::memory_order_acquire);
+        }
+        std::chrono::microseconds flushCoalesceDelay_{0};
+        // Nanoseconds on the steady clock, INT64_MAX if no flush is pending.
+        std::atomic<int64_t> flushDeadline_{INT64_MAX};
+        // The buffers written to the file, and those flushed to it.
+        uint64_t writtenCount_{0};
+        uint64_t flushedCount_{0};
+        bool started_{false};
+        void writeTmpBuffers();
+        void writeBuffersInExecutor(bool flushLogBuffer);
+        void notifyWriter();
+        std::shared_ptr<AsyncLogExecutor> executor_;
         std::string filePath_{"./"};
         std::string fileBaseName_{"xiaoLog"};
         std::string fileExtName_{".log"};
         uint64_t sizeLimit_{20 * 1024 * 1024};
         bool switchOnLimitOnly_{false};
         size_t maxFiles_{0};
+        LoggerFile::WriteMode writeMode_{LoggerFile::WriteMode::kStdio};
+        uint64_t maxTotalSize_{0};
+        std::chrono::seconds maxFileAge_{0};
+        bool compressRotatedFiles_{false};
+        bool asyncHousekeeping_{false};
+        LoggerFile::RotationPeriod rotationPeriod_{
+            LoggerFile::RotationPeriod::kNone};
+        bool rotateInLocalTime_{false};
+        bool directoryPerDay_{false};
+        LoggerFile::SyncPolicy syncPolicy_{LoggerFile::SyncPolicy::kNone};
+        uint64_t syncBytes_{0};
+        std::chrono::milliseconds syncInterval_{0};
+        bool syncOnFlush_{false};
+        uint64_t indexInterval_{0};
+        std::string frameDictionary_;
 
-        class LoggerFile : NonCopyable
-        {
-        public:
-            LoggerFile(const std::string &filePath,
-                       const std::string &fileBaseName,
-                       const std::string &fileExtName,
-                       bool switchOnLimitOnly = false,
-                       size_t maxFiles = 0);
-            ~LoggerFile();
-            void writeLog(const StringPtr buf);
-            void open();
-            void switchLog(bool openNewOne);
-            uint64_t getLength();
-            explicit operator bool() const
-            {
-                return fp_ != nullptr;
-            }
-            void flush();
-
-        protected:
-            void initFilenameQueue();
-            void deleteOldFiles();
-
-            FILE *fp_{nullptr};
-            Date creationDate_;
-            std::string fileFullName_;
-            std::string filePath_;
-            std::string fileBaseName_;
-            std::string fileExtName_;
-            static uint64_t fileSeq_;
-            bool switchOnLimitOnly_{false};
-
-            size_t maxFiles_{0};
-            std::deque<std::string> filenameQueue_;
-        };
         std::unique_ptr<LoggerFile> loggerFilePtr_;
+        std::shared_ptr<LogSink> sink_;
+        void flushOutput(bool sync);
 
         uint64_t lostCounter_{0};
+        std::shared_ptr<std::atomic<uint64_t>> recordSequence_;
+        void appendRecord(const char *msg, uint64_t len);
         void swapBuffer();
     };
 }
\ No newline at end of file
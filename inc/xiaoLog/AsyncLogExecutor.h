@@ -0,0 +1,108 @@
+/**
+ * @file AsyncLogExecutor.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+namespace xiaoLog
+{
+    class AsyncFileLogger;
+
+    /**
+     * @brief This class runs a few threads that write the buffers of many
+     * AsyncFileLogger objects. The loggers register themselves in
+     * startLogging() and unregister when they are destroyed. The periodic
+     * flushes of all the loggers are driven by one timer wheel, an idle
+     * executor doesn't wake up at all.
+     *
+     * @code
+     * auto executor = std::make_shared<xiaoLog::AsyncLogExecutor>();
+     * xiaoLog::AsyncFileLogger accessLogger, auditLogger;
+     * accessLogger.setExecutor(executor);
+     * auditLogger.setExecutor(executor);
+     * accessLogger.startLogging();
+     * auditLogger.startLogging();
+     * @endcode
+     */
+    class XIAOLOG_EXPORT AsyncLogExecutor : NonCopyable
+    {
+    public:
+        /**
+         * @brief Construct a new AsyncLogExecutor object
+         *
+         * @param threadNum The number of I/O threads.
+         */
+        explicit AsyncLogExecutor(size_t threadNum = 1);
+        ~AsyncLogExecutor();
+
+    private:
+        friend class AsyncFileLogger;
+        using Clock = std::chrono::steady_clock;
+
+        struct LoggerState
+        {
+            bool queued{false};
+            bool running{false};
+            bool pending{false};
+            bool flushPending{false};
+            bool scheduled{false};
+        };
+        struct TimerEntry
+        {
+            AsyncFileLogger *logger;
+            size_t rounds;
+        };
+
+        void registerLogger(AsyncFileLogger *logger);
+        void unregisterLogger(AsyncFileLogger *logger);
+
+        /**
+         * @brief Called by a logger when it has buffers ready to be written.
+         *
+         */
+        void notify(AsyncFileLogger *logger);
+
+        /**
+         * @brief Called by a logger when the first message is put into an
+         * empty buffer, the buffer is flushed after the delay. A forced timer
+         * is added even if the logger has one already.
+         *
+         */
+        void scheduleFlush(AsyncFileLogger *logger,
+                           std::chrono::microseconds delay,
+                           bool force = false);
+
+        void enqueue(AsyncFileLogger *logger, LoggerState &state);
+        void advanceWheel(Clock::time_point now);
+        void threadFunc();
+
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::condition_variable idleCond_;
+        std::unordered_map<AsyncFileLogger *, LoggerState> loggers_;
+        std::deque<AsyncFileLogger *> readyQueue_;
+        std::vector<std::vector<TimerEntry>> wheel_;
+        size_t currentSlot_{0};
+        size_t timerCount_{0};
+        Clock::time_point nextTick_;
+        std::vector<std::thread> threads_;
+        bool stop_{false};
+    };
+}
@@ -0,0 +1,277 @@
+/**
+ * @file ColumnarLog.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/LogIndex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+namespace xiaoLog
+{
+    /**
+     * @brief The columnar log format. Records are stored in row groups of up
+     * to a fixed number of rows, each column of a group in its own chunk:
+     *
+     * - time: microseconds since epoch, delta encoded varints.
+     * - level: run length encoded, kNoLevel for records without a level.
+     * - tid, file and channel: dictionary encoded.
+     * - line: varints.
+     * - message: lengths as varints followed by the bytes.
+     *
+     * Chunks are compressed with deflate if xiaoLog was built with zlib. The
+     * footer has the min/max statistics of every row group, so a reader
+     * skips the groups a query can't match and reads only the columns it
+     * needs.
+     *
+     */
+    class XIAOLOG_EXPORT ColumnarLog
+    {
+    public:
+        enum Column
+        {
+            kTime = 0,
+            kLevel,
+            kTid,
+            kFile,
+            kLine,
+            kChannel,
+            kMessage,
+            kNumberOfColumns
+        };
+
+        static constexpr unsigned kAllColumns{(1u << kNumberOfColumns) - 1};
+        static constexpr uint8_t kNoLevel{0xff};
+
+        struct Record
+        {
+            int64_t time{0};
+            uint8_t level{kNoLevel};
+            uint64_t tid{0};
+            std::string file;
+            uint32_t line{0};
+            int32_t channel{-1};
+            std::string message;
+        };
+
+        struct RowGroup
+        {
+            uint64_t offset;
+            uint32_t rows;
+            uint32_t columnLengths[kNumberOfColumns];
+            int64_t minTime;
+            int64_t maxTime;
+            uint64_t minTid;
+            uint64_t maxTid;
+            uint32_t minLine;
+            uint32_t maxLine;
+            int32_t minChannel;
+            int32_t maxChannel;
+            uint8_t minLevel;
+            uint8_t maxLevel;
+            uint8_t reserved[6];
+        };
+
+        /**
+         * @brief Parse a record written by Logger: the time, the thread id,
+         * the level, the message and the " - file:line" suffix. A record
+         * without the header (e.g. from RawLogger) keeps its text as the
+         * message.
+         *
+         * @param msg
+         * @param len
+         * @param parser The parser of the time, it caches the last second.
+         * @param record The file and the channel are left as they are if the
+         * record has no header.
+         * @return false if the record has no header.
+         */
+        static bool parseRecord(const char *msg,
+                                size_t len,
+                                LogLineParser &parser,
+                                Record &record);
+    };
+
+    /**
+     * @brief This class writes a columnar log file, from records or from the
+     * text of Logger. Without startLogging() a row group is encoded by the
+     * thread which fills it, as a converter does. A live output function
+     * calls startLogging(): the row groups are then sealed when they are
+     * full or after the row group interval, and encoded by a thread of the
+     * writer.
+     *
+     * @code
+     * auto writer = std::make_shared<xiaoLog::ColumnarLogWriter>();
+     * writer->open("app.xlc");
+     * writer->startLogging();
+     * xiaoLog::Logger::setRecordFunction(
+     *     [writer](const xiaoLog::LogRecord &record) {
+     *         writer->output(record);
+     *     },
+     *     [writer]() { writer->flush(); });
+     * @endcode
+     */
+    class XIAOLOG_EXPORT ColumnarLogWriter : NonCopyable
+    {
+    public:
+        explicit ColumnarLogWriter(size_t rowGroupSize = 64 * 1024)
+            : rowGroupSize_(rowGroupSize)
+        {
+        }
+        ~ColumnarLogWriter();
+
+        bool open(const std::string &fileName);
+
+        /**
+         * @brief Start the thread which encodes and writes the row groups,
+         * after open(). close() stops it.
+         *
+         */
+        void startLogging();
+
+        /**
+         * @brief Set the max time a row waits before its group is sealed,
+         * when the writer has its own thread. The default is 1 second.
+         *
+         * @param interval
+         */
+        void setRowGroupInterval(std::chrono::microseconds interval)
+        {
+            rowGroupInterval_ = interval;
+        }
+
+        /**
+         * @brief Append a record, thread safe.
+         *
+         * @param record
+         */
+        void append(const ColumnarLog::Record &record);
+
+        /**
+         * @brief Append a record of Logger from its fields.
+         *
+         * @param record
+         */
+        void output(const LogRecord &record);
+
+        /**
+         * @brief Parse and append a record written by Logger.
+         *
+         * @param msg
+         * @param len
+         * @param channel The channel (the index of the output function) the
+         * record was written to.
+         */
+        void output(const char *msg, const uint64_t len, int channel = -1);
+
+        /**
+         * @brief Flush the row groups written so far to the file. The rows
+         * of the open group stay in it.
+         *
+         */
+        void flush();
+
+        /**
+         * @brief Write the last row group and the footer.
+         *
+         */
+        void close();
+
+    private:
+        using Rows = std::vector<ColumnarLog::Record>;
+
+        void appendLocked(const ColumnarLog::Record &record);
+        void sealRows();
+        void writeRowGroup(Rows &rows);
+        void encoderThreadFunc();
+
+        size_t rowGroupSize_;
+        std::chrono::microseconds rowGroupInterval_{std::chrono::seconds(1)};
+        std::mutex mutex_;
+        // Wakes up the encoder thread.
+        std::condition_variable cond_;
+        // The file is written by the encoder thread only while it runs.
+        FILE *fp_{nullptr};
+        uint64_t offset_{0};
+        Rows rows_;
+        std::chrono::steady_clock::time_point rowsStart_;
+        // The sealed groups waiting for the encoder thread.
+        std::vector<Rows> pendingGroups_;
+        bool flushRequested_{false};
+        bool stopFlag_{false};
+        std::unique_ptr<std::thread> threadPtr_;
+        std::vector<ColumnarLog::RowGroup> rowGroups_;
+        LogLineParser parser_;
+        ColumnarLog::Record parsed_;
+        int64_t lastTime_{0};
+    };
+
+    /**
+     * @brief This class reads a columnar log file.
+     *
+     */
+    class XIAOLOG_EXPORT ColumnarLogReader : NonCopyable
+    {
+    public:
+        struct Columns
+        {
+            std::vector<int64_t> times;
+            std::vector<uint8_t> levels;
+            std::vector<uint64_t> tids;
+            std::vector<std::string> files;
+            std::vector<uint32_t> lines;
+            std::vector<int32_t> channels;
+            std::vector<std::string> messages;
+        };
+
+        ~ColumnarLogReader();
+
+        /**
+         * @brief Open a file and load the statistics of its row groups.
+         *
+         * @param fileName
+         * @return false if the file isn't a complete columnar log.
+         */
+        bool open(const std::string &fileName);
+        void close();
+
+        const std::vector<ColumnarLog::RowGroup> &rowGroups() const
+        {
+            return rowGroups_;
+        }
+
+        /**
+         * @brief Read some columns of a row group.
+         *
+         * @param index
+         * @param columns The columns which are not read are left empty.
+         * @param columnMask The bits (1 << ColumnarLog::Column) to read.
+         * @return false if the file is corrupted.
+         */
+        bool read(size_t index,
+                  Columns &columns,
+                  unsigned columnMask = ColumnarLog::kAllColumns);
+
+    private:
+        bool readChunk(uint64_t offset, uint32_t length, std::string &data);
+
+        FILE *fp_{nullptr};
+        std::vector<ColumnarLog::RowGroup> rowGroups_;
+        std::string chunk_;
+    };
+}
@@ -0,0 +1,163 @@
+/**
+ * @file ConsoleLogger.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Logger.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+namespace xiaoLog
+{
+    /**
+     * @brief This class writes logs to the console from its own thread, in
+     * place of the default output function which writes every record to
+     * stdout in the calling thread. When stdout is a pipe which stalls, e.g.
+     * to a container runtime under load, the records queue up in memory and
+     * are dropped past a limit, the logging threads never block on it. The
+     * queued buffers are written with one writev() call. On a terminal the
+     * level of the records is colored. A FATAL record is written before the
+     * output function returns, after the records queued before it. Not
+     * available on Windows.
+     *
+     * @code
+     * xiaoLog::ConsoleLogger console;
+     * console.startLogging();
+     * xiaoLog::Logger::setRecordFunction(
+     *     [&](const xiaoLog::LogRecord &record) { console.output(record); },
+     *     [&]() { console.flush(); });
+     * @endcode
+     */
+    class XIAOLOG_EXPORT ConsoleLogger : NonCopyable
+    {
+    public:
+        /**
+         * @brief Construct a new Console Logger object
+         *
+         * @param fd The console, stdout by default. The level is colored
+         * if it's a terminal.
+         */
+        explicit ConsoleLogger(int fd = 1);
+        ~ConsoleLogger();
+
+        /**
+         * @brief Start the logging thread.
+         *
+         */
+        void startLogging();
+
+        /**
+         * @brief Queue a record, or write it if it's FATAL.
+         *
+         * @param record
+         */
+        void output(const LogRecord &record);
+
+        /**
+         * @brief Queue the text of a record, its level is parsed from it.
+         *
+         * @param msg
+         * @param len
+         */
+        void output(const char *msg, const uint64_t len);
+
+        /**
+         * @brief Records are written as soon as the logging thread is idle,
+         * this only wakes it up, it doesn't wait for the console.
+         *
+         */
+        void flush();
+
+        /**
+         * @brief Color the level of the records with ANSI escape codes, the
+         * default is to color them only on a terminal.
+         *
+         * @param flag
+         */
+        void setColored(bool flag)
+        {
+            colored_ = flag;
+        }
+
+        bool colored() const
+        {
+            return colored_;
+        }
+
+        /**
+         * @brief Set the size of the queued records above which the new
+         * records are dropped, 16MiB by default.
+         *
+         * @param limit
+         */
+        void setMaxPendingBytes(size_t limit)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            maxPendingBytes_ = limit;
+        }
+
+        /**
+         * @brief The number of records dropped because the queue was full.
+         *
+         */
+        uint64_t droppedRecords() const
+        {
+            return droppedRecords_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        using StringPtr = std::shared_ptr<std::string>;
+
+        void logThreadFunc();
+        void outputRecord(const char *msg, size_t len, int level, size_t pos);
+        void appendRecord(const char *msg, size_t len, int level, size_t pos);
+        void swapBuffer();
+        /**
+         * @brief Write the queued records, and then a record which isn't
+         * queued if msg isn't nullptr.
+         *
+         */
+        void writePending(const char *msg = nullptr,
+                          size_t len = 0,
+                          int level = -1,
+                          size_t pos = 0);
+        void writeBuffers(const std::vector<StringPtr> &buffers,
+                          const char *msg,
+                          size_t len);
+
+        int fd_;
+        bool colored_;
+        std::mutex mutex_;
+        // Held while writing, so that a FATAL record isn't written before the
+        // records taken by the logging thread.
+        std::mutex writeMutex_;
+        std::condition_variable cond_;
+        StringPtr logBuffer_;
+        std::vector<StringPtr> pendingBuffers_;
+        std::vector<StringPtr> spareBuffers_;
+        size_t pendingBytes_{0};
+        size_t maxPendingBytes_{16 * 1024 * 1024};
+        uint64_t lostCounter_{0};
+        std::atomic<uint64_t> droppedRecords_{0};
+        bool writerParked_{false};
+        bool stopFlag_{false};
+        std::unique_ptr<std::thread> threadPtr_;
+    };
+}
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file DatagramSink.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/LogSink.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#ifndef _WIN32
+namespace xiaoLog
+{
+    /**
+     * @brief This sink ships the records to a collector over a Unix datagram
+     * or a UDP socket. Records are packed into datagrams up to a size limit,
+     * cut after a newline, and the datagrams of a buffer are sent in batches
+     * with one sendmmsg() each (sendto() where it's missing). The datagrams
+     * point into the buffer, nothing is copied. A line longer than the limit
+     * is split. When the socket buffer is full or nobody listens, the
+     * datagrams are dropped and counted, unless the sink is blocking. Not
+     * available on Windows.
+     *
+     * @code
+     * auto sink = xiaoLog::DatagramSink::openUnix("/run/collector.sock");
+     * asyncFileLogger.setSink(sink);
+     * @endcode
+     */
+    class XIAOLOG_EXPORT DatagramSink : public LogSink
+    {
+    public:
+        /**
+         * @brief Connect to a Unix datagram socket.
+         *
+         * @param path
+         * @param maxDatagramSize
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<DatagramSink> openUnix(
+            const std::string &path,
+            size_t maxDatagramSize = 32 * 1024);
+
+        /**
+         * @brief Connect to a UDP socket.
+         *
+         * @param host An IPv4 or IPv6 address, e.g. 127.0.0.1.
+         * @param port
+         * @param maxDatagramSize
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<DatagramSink> openUdp(
+            const std::string &host,
+            uint16_t port,
+            size_t maxDatagramSize = 8192);
+
+        ~DatagramSink() override;
+
+        void write(const StringPtr &buf) override;
+
+        /**
+         * @brief Wait for space in the socket buffer instead of dropping the
+         * datagrams, up to a timeout for each batch.
+         *
+         */
+        void setBlocking(bool flag = true, int timeoutMs = 100)
+        {
+            blocking_ = flag;
+            blockingTimeoutMs_ = timeoutMs;
+        }
+
+        uint64_t sentDatagrams() const
+        {
+            return sentDatagrams_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t droppedDatagrams() const
+        {
+            return droppedDatagrams_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief The number of lines in the dropped datagrams.
+         *
+         */
+        uint64_t droppedRecords() const
+        {
+            return droppedRecords_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        DatagramSink(int fd, size_t maxDatagramSize)
+            : fd_(fd), maxDatagramSize_(maxDatagramSize)
+        {
+        }
+
+        size_t sendBatch(const char *const *data,
+                         const size_t *lengths,
+                         size_t count);
+        void drop(const char *const *data,
+                  const size_t *lengths,
+                  size_t count);
+
+        int fd_;
+        size_t maxDatagramSize_;
+        bool blocking_{false};
+        int blockingTimeoutMs_{100};
+        std::atomic<uint64_t> sentDatagrams_{0};
+        std::atomic<uint64_t> droppedDatagrams_{0};
+        std::atomic<uint64_t> droppedRecords_{0};
+    };
+}
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file FlightRecorder.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <functional>
+
+#ifndef _WIN32
+namespace xiaoLog
+{
+    /**
+     * @brief This class keeps the last records in a fixed size circular
+     * buffer in a shared file mapping. A writer reserves its space with one
+     * atomic add on a cursor kept in the file and copies the record, no lock
+     * and no syscall. The mapped pages belong to the page cache, so the last
+     * records survive a crash of the process and can be read back with
+     * recover() or the xiaolog-recover tool. Installed with
+     * Logger::setFlightRecorder(), it gets every record of the Logger, even
+     * those still in the memory buffers of an AsyncFileLogger. Not available
+     * on Windows.
+     *
+     * @code
+     * xiaoLog::Logger::setFlightRecorder(
+     *     xiaoLog::FlightRecorder::open("./app.flight", 64 * 1024 * 1024));
+     * @endcode
+     */
+    class XIAOLOG_EXPORT FlightRecorder : NonCopyable
+    {
+    public:
+        /**
+         * @brief Open or create the recorder file. The records of an existing
+         * file of the same size are kept and overwritten as new ones come.
+         *
+         * @param fileName
+         * @param size The size of the circular buffer.
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<FlightRecorder> open(const std::string &fileName,
+                                                    size_t size = 16 * 1024 *
+                                                                  1024);
+        ~FlightRecorder();
+
+        /**
+         * @brief Copy a record into the buffer, overwriting the oldest ones.
+         * Records longer than a quarter of the buffer are truncated.
+         *
+         * @param msg
+         * @param len
+         */
+        void record(const char *msg, uint64_t len);
+
+        /**
+         * @brief Read the complete records of a recorder file, oldest first.
+         * Records which were being written or overwritten when the process
+         * died are skipped.
+         *
+         * @param fileName
+         * @param func Called for each record.
+         * @return false if the file is not a recorder file.
+         */
+        static bool recover(
+            const std::string &fileName,
+            const std::function<void(const char *, uint64_t)> &func);
+
+    private:
+        FlightRecorder() = default;
+
+        char *base_{nullptr};
+        size_t mapSize_{0};
+        uint64_t capacity_{0};
+        char *data_{nullptr};
+    };
+}
+#endif
@@ -0,0 +1,154 @@
+/**
+ * @file FramedLog.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace xiaoLog
+{
+    /**
+     * @brief The frame-compressed log format written with
+     * LoggerFile::WriteMode::kFramed. Every buffer written by the backend is
+     * compressed with deflate into an independent frame, so any part of the
+     * log can be decompressed without the data before it. A seek table and a
+     * footer are appended when the file is closed. A file cut by a crash has
+     * no table, it's rebuilt by walking the frame headers and the cut frame
+     * is dropped. The compression dictionary, if any, is stored in the file
+     * as a frame of its own, so a file can always be read alone.
+     *
+     * Frames are stored uncompressed if xiaoLog was built without zlib or if
+     * the data doesn't compress.
+     *
+     */
+    class XIAOLOG_EXPORT FramedLog
+    {
+    public:
+        /**
+         * @brief Check whether a file starts with a frame.
+         *
+         * @param fileName
+         * @return true
+         * @return false
+         */
+        static bool isFramed(const std::string &fileName);
+
+        /**
+         * @brief Build a compression dictionary from sample logs. The most
+         * frequent words weighted by their length are kept, the most useful
+         * at the end where deflate finds them at the shortest distance.
+         * Dictionaries help small frames, i.e. loggers which flush often.
+         *
+         * @param samples Sample logs, e.g. an old log file.
+         * @param size The max size of the dictionary, deflate uses 32 KiB at
+         * most.
+         * @return std::string
+         */
+        static std::string trainDictionary(const std::string &samples,
+                                           size_t size = 32 * 1024);
+    };
+
+    /**
+     * @brief This class reads a frame-compressed log file at any offset of
+     * the uncompressed log.
+     *
+     * @code
+     * xiaoLog::FramedLogReader reader;
+     * if (reader.open("app.log"))
+     * {
+     *     std::string data(4096, '\0');
+     *     data.resize(reader.pread(&data[0], data.size(), offset));
+     * }
+     * @endcode
+     */
+    class XIAOLOG_EXPORT FramedLogReader : NonCopyable
+    {
+    public:
+        struct Frame
+        {
+            uint64_t fileOffset;
+            uint64_t rawOffset;
+        };
+
+        ~FramedLogReader();
+
+        /**
+         * @brief Open a file. The seek table is loaded or rebuilt and the
+         * dictionaries are read.
+         *
+         * @param fileName
+         * @return false if the file can't be read or isn't framed.
+         */
+        bool open(const std::string &fileName);
+        void close();
+
+        /**
+         * @brief The size of the uncompressed log.
+         *
+         * @return uint64_t
+         */
+        uint64_t rawSize() const
+        {
+            return rawSize_;
+        }
+
+        /**
+         * @brief The size of the file.
+         *
+         * @return uint64_t
+         */
+        uint64_t fileSize() const
+        {
+            return fileSize_;
+        }
+
+        const std::vector<Frame> &frames() const
+        {
+            return frames_;
+        }
+
+        /**
+         * @brief Decompress one frame.
+         *
+         * @param index
+         * @param data
+         * @return false if the frame is corrupted or its dictionary missing.
+         */
+        bool readFrame(size_t index, std::string &data);
+
+        /**
+         * @brief Read the uncompressed log at an offset. Only the frames
+         * holding the range are decompressed, the last one is cached for
+         * sequential reads.
+         *
+         * @param buf
+         * @param len
+         * @param rawOffset
+         * @return The number of bytes read, less than len at the end of the
+         * log or on error.
+         */
+        size_t pread(char *buf, size_t len, uint64_t rawOffset);
+
+    private:
+        int fd_{-1};
+        uint64_t fileSize_{0};
+        uint64_t rawSize_{0};
+        std::vector<Frame> frames_;
+        std::map<uint32_t, std::string> dictionaries_;
+        size_t cachedFrame_{SIZE_MAX};
+        std::string cache_;
+        std::string compressed_;
+    };
+}
@@ -0,0 +1,173 @@
+/**
+ * @file LogBroadcast.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace xiaoLog
+{
+    /**
+     * @brief This class broadcasts records to any number of in-process
+     * subscribers, e.g. an admin endpoint streaming the live log. Records are
+     * copied into a ring of fixed size slots, each guarded by a sequence
+     * lock: a producer reserves a position with one atomic add and marks the
+     * slot as being written while it copies the record. Subscribers follow
+     * the ring on their own, without any lock, and never slow the producers
+     * down; a subscriber which falls behind by more than the ring skips the
+     * overwritten records and counts them as a gap. Installed with
+     * Logger::setLogBroadcast(), it gets every record of the Logger which
+     * passed the level check.
+     *
+     * @code
+     * auto broadcast = std::make_shared<xiaoLog::LogBroadcast>();
+     * xiaoLog::Logger::setLogBroadcast(broadcast);
+     * xiaoLog::LogBroadcast::Subscriber subscriber(broadcast);
+     * subscriber.setLevel(xiaoLog::Logger::kWarn);
+     * subscriber.poll([](const xiaoLog::LogBroadcast::Record &record) {
+     *     send(record.data, record.len);
+     * });
+     * @endcode
+     */
+    class XIAOLOG_EXPORT LogBroadcast : NonCopyable
+    {
+    public:
+        struct Record
+        {
+            const char *data;
+            size_t len;
+            /**
+             * @brief The level, -1 for the records of RawLogger.
+             *
+             */
+            int level;
+            /**
+             * @brief The index of the output function, -1 for the default
+             * one.
+             *
+             */
+            int channel;
+            bool truncated;
+        };
+
+        /**
+         * @brief
+         *
+         * @param slots The number of records in the ring, rounded up to a
+         * power of 2.
+         * @param slotSize The longest record, longer ones are truncated.
+         */
+        explicit LogBroadcast(size_t slots = 4096, size_t slotSize = 512);
+        ~LogBroadcast();
+
+        /**
+         * @brief Copy a record into the ring, overwriting the oldest one.
+         *
+         */
+        void publish(int level, int channel, const char *msg, uint64_t len);
+
+        /**
+         * @brief The number of records published so far.
+         *
+         */
+        uint64_t published() const
+        {
+            return head_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief This class follows a broadcast from the records published
+         * after its creation. It belongs to one thread.
+         *
+         */
+        class XIAOLOG_EXPORT Subscriber : NonCopyable
+        {
+        public:
+            /**
+             * @brief
+             *
+             * @param broadcast
+             * @param backlog Start from the oldest record still in the ring
+             * instead of the next one.
+             */
+            explicit Subscriber(std::shared_ptr<LogBroadcast> broadcast,
+                                bool backlog = false);
+
+            /**
+             * @brief Only deliver the records of this level or above. The
+             * records of RawLogger are delivered only if the level is -1,
+             * the default.
+             *
+             */
+            void setLevel(int level)
+            {
+                level_ = level;
+            }
+
+            /**
+             * @brief Only deliver the records of these channels, all of them
+             * if the list is empty.
+             *
+             */
+            void setChannels(std::vector<int> channels)
+            {
+                channels_ = std::move(channels);
+            }
+
+            /**
+             * @brief Deliver the records published since the last call.
+             *
+             * @param func Called for each record which passes the filters,
+             * the record is valid during the call only.
+             * @param maxRecords
+             * @return The number of records delivered.
+             */
+            size_t poll(const std::function<void(const Record &)> &func,
+                        size_t maxRecords = SIZE_MAX);
+
+            /**
+             * @brief The number of records lost because they were
+             * overwritten before this subscriber read them.
+             *
+             */
+            uint64_t gaps() const
+            {
+                return gaps_;
+            }
+
+        private:
+            std::shared_ptr<LogBroadcast> broadcast_;
+            uint64_t next_;
+            uint64_t gaps_{0};
+            int level_{-1};
+            std::vector<int> channels_;
+            std::string buffer_;
+        };
+
+    private:
+        struct Slot;
+        Slot *slotAt(uint64_t pos) const;
+
+        std::atomic<uint64_t> head_{0};
+        // Keep the producers' cursor apart from the read-only fields.
+        char padding_[64 - sizeof(std::atomic<uint64_t>)];
+        size_t mask_;
+        size_t slotSize_;
+        size_t stride_;
+        char *slots_;
+    };
+}
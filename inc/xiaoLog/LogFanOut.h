@@ -0,0 +1,188 @@
+/**
+ * @file LogFanOut.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Logger.h>
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xiaoLog
+{
+    /**
+     * @brief This class passes the records of a channel to several sinks
+     * which don't slow each other down. A record is copied once into a
+     * chunk shared by all the sinks, each sink has its own queue of chunks,
+     * its own thread calling its output function, a level threshold and an
+     * overflow policy. When a sink stalls, e.g. a network sink, only its
+     * queue fills up and only its records are dropped, unless its policy is
+     * to block. Records without a level (RawLogger) go to every sink.
+     *
+     * @code
+     * xiaoLog::LogFanOut fanOut;
+     * fanOut.addSink(
+     *     [&](const char *msg, const uint64_t len) { file.output(msg, len); },
+     *     [&]() { file.flush(); });
+     * xiaoLog::LogFanOut::SinkOptions options;
+     * options.level = xiaoLog::Logger::kWarn;
+     * fanOut.addSink([&](const char *msg, const uint64_t len) { ... },
+     *                nullptr,
+     *                options);
+     * fanOut.startLogging();
+     * xiaoLog::Logger::setRecordFunction(
+     *     [&](const xiaoLog::LogRecord &record) { fanOut.output(record); },
+     *     [&]() { fanOut.flush(); });
+     * @endcode
+     */
+    class XIAOLOG_EXPORT LogFanOut : NonCopyable
+    {
+    public:
+        /**
+         * @brief What to do with a chunk when the queue of a sink is full.
+         *
+         * - kDropNewest: drop the new chunk.
+         * - kDropOldest: drop the oldest queued chunks.
+         * - kBlock: wait for the sink, the producers handing chunks to it
+         *   wait too. The other sinks get each chunk before the blocking
+         *   ones, and the records keep being appended meanwhile.
+         */
+        enum class OverflowPolicy
+        {
+            kDropNewest = 0,
+            kDropOldest,
+            kBlock
+        };
+
+        struct SinkOptions
+        {
+            // The records below the level aren't passed to the sink.
+            Logger::LogLevel level{Logger::kTrace};
+            // The size of the queued chunks above which the policy applies.
+            size_t maxQueuedBytes{16 * 1024 * 1024};
+            OverflowPolicy policy{OverflowPolicy::kDropNewest};
+        };
+
+        /**
+         * @brief Construct a new Log Fan Out object
+         *
+         * @param chunkSize The records are handed to the sinks when a chunk
+         * of this size is full, or after the flush interval.
+         */
+        explicit LogFanOut(size_t chunkSize = 64 * 1024);
+        ~LogFanOut();
+
+        /**
+         * @brief Add a sink, before startLogging() is called.
+         *
+         * @param outputFunc Called by the thread of the sink for each record.
+         * @param flushFunc Called after an error and when the fan-out is
+         * flushed, may be nullptr.
+         * @param options
+         * @return The index of the sink.
+         */
+        size_t addSink(
+            std::function<void(const char *msg, const uint64_t len)> outputFunc,
+            std::function<void()> flushFunc,
+            const SinkOptions &options);
+
+        size_t addSink(
+            std::function<void(const char *msg, const uint64_t len)> outputFunc,
+            std::function<void()> flushFunc)
+        {
+            return addSink(std::move(outputFunc),
+                           std::move(flushFunc),
+                           SinkOptions());
+        }
+
+        /**
+         * @brief Set the max time a record waits in the chunk before it's
+         * handed to the sinks. The default is 100 milliseconds.
+         *
+         * @param interval
+         */
+        void setFlushInterval(std::chrono::microseconds interval)
+        {
+            flushInterval_ = interval;
+        }
+
+        /**
+         * @brief Start the thread of each sink, and the one handing the
+         * records over after the flush interval.
+         *
+         */
+        void startLogging();
+
+        /**
+         * @brief Pass a record to the sinks.
+         *
+         * @param record
+         */
+        void output(const LogRecord &record)
+        {
+            append(record.data, record.length, record.level);
+        }
+
+        /**
+         * @brief Pass the text of a record, its level is parsed from it.
+         *
+         * @param msg
+         * @param len
+         */
+        void output(const char *msg, const uint64_t len);
+
+        /**
+         * @brief Hand the records to the sinks, which flush them once they
+         * are written.
+         *
+         */
+        void flush();
+
+        /**
+         * @brief The number of records dropped by a sink.
+         *
+         * @param sink
+         */
+        uint64_t droppedRecords(size_t sink) const;
+
+    private:
+        struct Chunk;
+        struct Sink;
+
+        void append(const char *msg, const uint64_t len, int level);
+        // Called with mutex_ held, returns the chunk to dispatch().
+        std::shared_ptr<Chunk> sealChunk(bool flush);
+        // Called without mutex_, a blocking sink may wait for its thread.
+        void dispatch(const std::shared_ptr<Chunk> &chunk);
+        void enqueue(Sink &sink, const std::shared_ptr<Chunk> &chunk);
+        void timerThreadFunc();
+        void sinkThreadFunc(Sink &sink);
+
+        size_t chunkSize_;
+        std::chrono::microseconds flushInterval_{
+            std::chrono::milliseconds(100)};
+        std::mutex mutex_;
+        // Wakes up the timer thread when a chunk gets its first record.
+        std::condition_variable cond_;
+        std::shared_ptr<Chunk> chunk_;
+        uint64_t sealedChunks_{0};
+        std::vector<std::unique_ptr<Sink>> sinks_;
+        bool timerParked_{false};
+        bool stopFlag_{false};
+        std::unique_ptr<std::thread> timerThreadPtr_;
+    };
+}
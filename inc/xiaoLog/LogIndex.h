@@ -0,0 +1,155 @@
+/**
+ * @file LogIndex.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Logger.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace xiaoLog
+{
+    /**
+     * @brief The sparse index of a log file, kept in a sidecar file named
+     * after the log file with the ".idx" extension. Each entry describes a
+     * block of whole lines of roughly the index interval: its byte range, the
+     * time range of its records and the number of records of each level. A
+     * time range query reads only the blocks it overlaps, and counting by
+     * level doesn't read the log at all.
+     *
+     */
+    class XIAOLOG_EXPORT LogIndex
+    {
+    public:
+        static constexpr int kNumberOfLevels{Logger::kNumberOfLogLevels};
+
+        struct Block
+        {
+            uint64_t offset;
+            uint64_t length;
+            // Microseconds since epoch.
+            int64_t minTime;
+            int64_t maxTime;
+            uint32_t counts[kNumberOfLevels];
+            uint32_t reserved;
+        };
+
+        /**
+         * @brief Get the index file name of a log file. The index of a
+         * rotated file compressed with gzip keeps the name it had before the
+         * compression.
+         *
+         * @param logFileName
+         * @return std::string
+         */
+        static std::string indexFileName(const std::string &logFileName);
+
+        /**
+         * @brief Load the blocks of an index file. An entry cut by a crash is
+         * ignored.
+         *
+         * @param indexFileName
+         * @param blocks
+         * @return false if the file doesn't exist or isn't an index.
+         */
+        static bool load(const std::string &indexFileName,
+                         std::vector<Block> &blocks);
+    };
+
+    /**
+     * @brief Parse the time and the level at the start of a line written by
+     * Logger, in local time or in UTC. The conversion of the date is cached
+     * for the last second seen.
+     *
+     */
+    class XIAOLOG_EXPORT LogLineParser
+    {
+    public:
+        /**
+         * @brief Parse a line. A record header of a ShardedFileLogger is
+         * skipped.
+         *
+         * @param line
+         * @param len
+         * @param microSeconds The time of the record.
+         * @param level The level of the record, -1 if it has none (e.g.
+         * records of RawLogger).
+         * @return false if the line doesn't start with a time, i.e. it's the
+         * continuation of a multi-line record.
+         */
+        bool parse(const char *line,
+                   size_t len,
+                   int64_t &microSeconds,
+                   int &level);
+
+    private:
+        char lastSecond_[17]{0};
+        bool lastUtc_{false};
+        int64_t lastSeconds_{0};
+    };
+
+    /**
+     * @brief This class builds the index of a log file from the data written
+     * to it. Blocks end on line boundaries, so they hold whole records
+     * unless a record spans several lines.
+     *
+     */
+    class XIAOLOG_EXPORT LogIndexWriter : NonCopyable
+    {
+    public:
+        explicit LogIndexWriter(uint64_t interval) : interval_(interval)
+        {
+        }
+        ~LogIndexWriter();
+
+        /**
+         * @brief Open the index of a log file, appending to an existing one.
+         *
+         * @param indexFileName
+         * @param offset The current length of the log file.
+         * @return false on failure.
+         */
+        bool open(const std::string &indexFileName, uint64_t offset);
+
+        /**
+         * @brief Index data appended to the log file.
+         *
+         * @param data
+         * @param len
+         */
+        void append(const char *data, size_t len);
+
+        /**
+         * @brief Write the finished blocks to the index file.
+         *
+         */
+        void flush();
+
+        /**
+         * @brief Finish the current block and close the index file.
+         *
+         */
+        void close();
+
+    private:
+        void finishBlock();
+
+        uint64_t interval_;
+        FILE *fp_{nullptr};
+        LogLineParser parser_;
+        LogIndex::Block block_;
+        bool atLineStart_{true};
+        int64_t lastTime_{0};
+    };
+}
@@ -0,0 +1,138 @@
+/**
+ * @file LogRouter.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Logger.h>
+#include <stdint.h>
+#include <vector>
+
+namespace xiaoLog
+{
+    class AsyncFileLogger;
+
+    /**
+     * @brief This class routes the records of the channels to file loggers
+     * by channel and level, e.g. every channel to its own file and the
+     * errors of all of them to one more file. The routes are declared once
+     * at startup, install() turns them into a table of the loggers of each
+     * channel and level, and takes over the record functions of the routed
+     * channels. A record is passed to each of its loggers as it was
+     * formatted, without a copy of its own. Records without a level (e.g.
+     * of RawLogger) follow the routes which cover all the levels.
+     *
+     * @code
+     * xiaoLog::LogRouter router;
+     * router.route(-1, mainLog)
+     *     .route(1, accessLog)
+     *     .routeAllChannels(xiaoLog::Logger::kError,
+     *                       xiaoLog::Logger::kFatal,
+     *                       errorLog);
+     * router.install();
+     * @endcode
+     */
+    class XIAOLOG_EXPORT LogRouter : NonCopyable
+    {
+    public:
+        /**
+         * @brief The channels -1 to kMaxChannels - 2 can be routed.
+         *
+         */
+        static constexpr int kMaxChannels{64};
+
+        /**
+         * @brief The number of distinct loggers a router can hold.
+         *
+         */
+        static constexpr size_t kMaxLoggers{64};
+
+        /**
+         * @brief Route the records of a channel in a range of levels to a
+         * logger.
+         *
+         * @param channel The index of the output function, -1 for the
+         * default one.
+         * @param minLevel
+         * @param maxLevel
+         * @param logger It must outlive the router.
+         */
+        LogRouter &route(int channel,
+                         Logger::LogLevel minLevel,
+                         Logger::LogLevel maxLevel,
+                         AsyncFileLogger &logger);
+
+        LogRouter &route(int channel, AsyncFileLogger &logger)
+        {
+            return route(channel, Logger::kTrace, Logger::kFatal, logger);
+        }
+
+        /**
+         * @brief Route the records of every channel in a range of levels to
+         * a logger. All the channels are taken over by install().
+         *
+         */
+        LogRouter &routeAllChannels(Logger::LogLevel minLevel,
+                                    Logger::LogLevel maxLevel,
+                                    AsyncFileLogger &logger);
+
+        /**
+         * @brief Build the routing table and set the record functions of the
+         * routed channels. Records for which there's no route are dropped.
+         * The routes can't be changed afterwards, the router must outlive
+         * the logging.
+         *
+         */
+        void install();
+
+        /**
+         * @brief Pass a record to the loggers of its channel and level.
+         *
+         * @param record
+         */
+        void output(const LogRecord &record);
+
+        /**
+         * @brief Flush the loggers of a channel.
+         *
+         * @param channel
+         */
+        void flush(int channel);
+
+    private:
+        // The column of the records without a level.
+        static constexpr int kNoLevel{Logger::kNumberOfLogLevels};
+
+        struct Route
+        {
+            int channel;  // kMaxChannels for all the channels.
+            Logger::LogLevel minLevel;
+            Logger::LogLevel maxLevel;
+            size_t logger;
+        };
+
+        static size_t slot(int channel)
+        {
+            return channel >= -1 && channel < kMaxChannels - 1
+                       ? static_cast<size_t>(channel + 1)
+                       : 0;
+        }
+        size_t loggerIndex(AsyncFileLogger &logger);
+
+        std::vector<Route> routes_;
+        std::vector<AsyncFileLogger *> loggers_;
+        // A bit per logger, for each channel and each level.
+        uint64_t table_[kMaxChannels][kNoLevel + 1]{};
+        // The loggers of each channel, to flush.
+        uint64_t channelLoggers_[kMaxChannels]{};
+        bool installed_{false};
+    };
+}
@@ -0,0 +1,252 @@
+/**
+ * @file LogSampler.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Logger.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+namespace xiaoLog
+{
+    /**
+     * @brief This class samples the records of whole requests. A thread sets
+     * the trace id of the request it serves, the id is hashed once, and the
+     * LOG_*_SAMPLED macros keep a record if the hash is below the threshold
+     * of the rate of its level and channel. So every record of a request is
+     * kept or none of them is, and the decision is taken before the Logger
+     * is built, i.e. before any formatting. A request kept at some rate is
+     * also kept at any higher rate, and by every process using the same
+     * trace id and rate. Outside a trace, each record is sampled on its own.
+     * The rates are 1 (keep everything) by default and can be changed at any
+     * time.
+     *
+     * @code
+     * xiaoLog::LogSampler::setRate(xiaoLog::Logger::kDebug, 0.01);
+     * {
+     *     xiaoLog::LogSampler::Scope scope(request.traceId());
+     *     LOG_DEBUG_SAMPLED << "kept for 1% of the requests";
+     * }
+     * @endcode
+     */
+    class XIAOLOG_EXPORT LogSampler
+    {
+    public:
+        /**
+         * @brief The channels -1 to kMaxChannels - 2 have their own rates,
+         * the others share the rates of the default channel (-1).
+         *
+         */
+        static constexpr int kMaxChannels{64};
+
+        /**
+         * @brief Set the rate of a level and a channel.
+         *
+         * @param level
+         * @param rate The fraction of the traces to keep, from 0 to 1.
+         * @param channel The index of the output function, -1 for the
+         * default one.
+         */
+        static void setRate(Logger::LogLevel level,
+                            double rate,
+                            int channel = -1);
+
+        /**
+         * @brief Set the rate of a level for all the channels.
+         *
+         */
+        static void setRateOfAllChannels(Logger::LogLevel level, double rate);
+
+        static double rate(Logger::LogLevel level, int channel = -1);
+
+        /**
+         * @brief Hash a trace id given as a string, e.g. the 32 hex digits
+         * of a W3C trace context.
+         *
+         */
+        static uint64_t hash(const char *traceId, size_t len);
+        static uint64_t hash(uint64_t traceId)
+        {
+            // The finalizer of splitmix64
+            traceId = (traceId ^ (traceId >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            traceId = (traceId ^ (traceId >> 27)) * 0x94d049bb133111ebULL;
+            return traceId ^ (traceId >> 31);
+        }
+
+        /**
+         * @brief This class sets the trace of the current thread during its
+         * life, the previous one is restored when it's destroyed.
+         *
+         */
+        class Scope : NonCopyable
+        {
+        public:
+            explicit Scope(uint64_t traceId)
+            {
+                enter(LogSampler::hash(traceId));
+            }
+            explicit Scope(const std::string &traceId)
+            {
+                enter(LogSampler::hash(traceId.data(), traceId.size()));
+            }
+            Scope(const char *traceId, size_t len)
+            {
+                enter(LogSampler::hash(traceId, len));
+            }
+            ~Scope()
+            {
+                auto &context = context_();
+                context.hash = savedHash_;
+                context.inTrace = savedInTrace_;
+            }
+
+        private:
+            void enter(uint64_t hash)
+            {
+                auto &context = context_();
+                savedHash_ = context.hash;
+                savedInTrace_ = context.inTrace;
+                context.hash = hash;
+                context.inTrace = true;
+            }
+
+            uint64_t savedHash_;
+            bool savedInTrace_;
+        };
+
+        /**
+         * @brief Check whether a record of the current thread is sampled.
+         *
+         */
+        static bool sampled(Logger::LogLevel level, int channel = -1)
+        {
+            auto threshold =
+                thresholds_().values[row(channel)][level].load(
+                    std::memory_order_relaxed);
+            if (threshold == kAlways)
+                return true;
+            auto &context = context_();
+            if (context.inTrace)
+                return context.hash < threshold;
+            // xorshift64, seeded by the address of the context.
+            if (context.random == 0)
+                context.random =
+                    hash(reinterpret_cast<uintptr_t>(&context)) | 1;
+            context.random ^= context.random << 13;
+            context.random ^= context.random >> 7;
+            context.random ^= context.random << 17;
+            return context.random < threshold;
+        }
+
+    private:
+        static constexpr uint64_t kAlways{UINT64_MAX};
+
+        struct Context
+        {
+            uint64_t hash{0};
+            bool inTrace{false};
+            uint64_t random{0};
+        };
+
+        struct Thresholds
+        {
+            Thresholds()
+            {
+                for (auto &channel : values)
+                    for (auto &level : channel)
+                        level.store(kAlways, std::memory_order_relaxed);
+            }
+            std::atomic<uint64_t> values[kMaxChannels]
+                                        [Logger::kNumberOfLogLevels];
+        };
+
+        static Context &context_()
+        {
+            thread_local Context context;
+            return context;
+        }
+        static Thresholds &thresholds_()
+        {
+            static Thresholds thresholds;
+            return thresholds;
+        }
+
+        static int row(int channel)
+        {
+            return channel >= -1 && channel < kMaxChannels - 1 ? channel + 1
+                                                               : 0;
+        }
+    };
+}
+
+#define XIAOLOG_SAMPLED_(level, index)                    \
+    XIAOLOG_IF_(xiaoLog::Logger::logLevel() <= (level) && \
+                xiaoLog::LogSampler::sampled((level), (index)))
+
+#ifdef NDEBUG
+#define LOG_TRACE_SAMPLED                                                  \
+    XIAOLOG_IF_(0)                                                         \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kTrace, __func__) \
+        .stream()
+#define LOG_TRACE_SAMPLED_TO(index)                                        \
+    XIAOLOG_IF_(0)                                                         \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kTrace, __func__) \
+        .setIndex(index)                                                   \
+        .stream()
+#else
+#define LOG_TRACE_SAMPLED                                                  \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kTrace, -1)                          \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kTrace, __func__) \
+        .stream()
+#define LOG_TRACE_SAMPLED_TO(index)                                        \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kTrace, index)                       \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kTrace, __func__) \
+        .setIndex(index)                                                   \
+        .stream()
+#endif
+#define LOG_DEBUG_SAMPLED                                                  \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kDebug, -1)                          \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kDebug, __func__) \
+        .stream()
+#define LOG_DEBUG_SAMPLED_TO(index)                                        \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kDebug, index)                       \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kDebug, __func__) \
+        .setIndex(index)                                                   \
+        .stream()
+#define LOG_INFO_SAMPLED                         \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kInfo, -1) \
+    xiaoLog::Logger(__FILE__, __LINE__).stream()
+#define LOG_INFO_SAMPLED_TO(index)                  \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kInfo, index) \
+    xiaoLog::Logger(__FILE__, __LINE__)             \
+        .setIndex(index)                            \
+        .stream()
+#define LOG_WARN_SAMPLED                                        \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kWarn, -1)                \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kWarn) \
+        .stream()
+#define LOG_WARN_SAMPLED_TO(index)                              \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kWarn, index)             \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kWarn) \
+        .setIndex(index)                                        \
+        .stream()
+#define LOG_ERROR_SAMPLED                                        \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kError, -1)                \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kError) \
+        .stream()
+#define LOG_ERROR_SAMPLED_TO(index)                              \
+    XIAOLOG_SAMPLED_(xiaoLog::Logger::kError, index)             \
+    xiaoLog::Logger(__FILE__, __LINE__, xiaoLog::Logger::kError) \
+        .setIndex(index)                                         \
+        .stream()
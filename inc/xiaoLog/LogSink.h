@@ -0,0 +1,49 @@
+/**
+ * @file LogSink.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <memory>
+#include <string>
+
+namespace xiaoLog
+{
+    using StringPtr = std::shared_ptr<std::string>;
+
+    /**
+     * @brief The destination of the buffers of an AsyncFileLogger, in place
+     * of its log files. A buffer holds whole records, its methods are called
+     * by the logging thread only.
+     *
+     */
+    class XIAOLOG_EXPORT LogSink : NonCopyable
+    {
+    public:
+        virtual ~LogSink() = default;
+
+        /**
+         * @brief Write a buffer. The buffer is reused once the call returns.
+         *
+         * @param buf
+         */
+        virtual void write(const StringPtr &buf) = 0;
+
+        /**
+         * @brief Called after a batch of buffers, and when the logger is
+         * flushed.
+         *
+         */
+        virtual void flush()
+        {
+        }
+    };
+}
@@ -14,6 +14,7 @@
 #include <xiaoLog/Date.h>
 #include <xiaoLog/LogStream.h>
 #include <xiaoLog/exports.h>
+#include <string.h>
 #include <functional>
 #include <vector>
 
@@ -23,11 +24,16 @@ namespace spdlog
 } // namespace spdlog
 
 #include <memory>
+#include <atomic>
 
 #define XIAOLOG_IF_(cond) for (int _r = 0; _r == 0 && (cond); _r = 1)
 
 namespace xiaoLog
 {
+    class FlightRecorder;
+    class LogBroadcast;
+    struct LogRecord;
+
     /**
      * @brief This class implements log functions.
      *
@@ -114,24 +120,29 @@ namespace xiaoLog
          * @param outputFunc The function to output a log message.
          * @param flushFunc The function to flush.
          * @param index The channel index.
-         * @note Logs are output to the standard output by default.
+         * @note Logs are output to the standard output by default. The
+         * function gets the text of the records, it's called by a record
+         * function set in its place, see setRecordFunction().
          */
         static void setOutputFunction(
             std::function<void(const char *msg, const uint64_t len)> outputFunc,
             std::function<void()> flushFunc,
-            int index = -1)
-        {
-            if (index < 0)
-            {
-                outputFunc_() = outputFunc;
-                flushFunc_() = flushFunc;
-            }
-            else
-            {
-                outputFunc_(index) = outputFunc;
-                flushFunc_(index) = flushFunc;
-            }
-        }
+            int index = -1);
+
+        /**
+         * @brief Set the function which gets the records of a channel with
+         * their fields, in place of its output function. The fields are
+         * those the text was formatted from, so a sink can use its own
+         * encoding without parsing the text.
+         *
+         * @param recordFunc The function to output a record.
+         * @param flushFunc The function to flush.
+         * @param index The channel index.
+         */
+        static void setRecordFunction(
+            std::function<void(const LogRecord &record)> recordFunc,
+            std::function<void()> flushFunc,
+            int index = -1);
 
         /**
          * @brief Set the Log Level object
@@ -182,6 +193,26 @@ namespace xiaoLog
          */
         static bool hasSpdLogSupport();
 
+        /**
+         * @brief The 7-character token of a level in the records, e.g.
+         * " INFO  ".
+         *
+         * @param level
+         */
+        static const char *levelString(LogLevel level);
+
+        /**
+         * @brief Find the level token which follows the time and the thread
+         * id at the start of a record.
+         *
+         * @param msg
+         * @param len
+         * @param pos Set to the offset of the token if it's found.
+         * @return The level, or -1 if the record has none, e.g. a record of
+         * RawLogger.
+         */
+        static int parseLevel(const char *msg, uint64_t len, size_t &pos);
+
         /**
          * @brief Enable logging with spdlog for the specified channel.
          *
@@ -218,7 +249,47 @@ namespace xiaoLog
 
         static std::shared_ptr<spdlog::logger> getDefaultSpdLogger(int index);
 
+        /**
+         * @brief Copy every log message of all the channels into a flight
+         * recorder, before it's passed to the output function. A recorder
+         * replaced by another one is released once no thread writes to it.
+         *
+         * @param recorder nullptr to stop recording.
+         */
+        static void setFlightRecorder(std::shared_ptr<FlightRecorder> recorder);
+
+        /**
+         * @brief Publish every log message of all the channels to the
+         * subscribers of a broadcast, before it's passed to the output
+         * function. A broadcast replaced by another one is released once no
+         * thread publishes to it.
+         *
+         * @param broadcast nullptr to stop publishing.
+         */
+        static void setLogBroadcast(std::shared_ptr<LogBroadcast> broadcast);
+
     protected:
+        static std::atomic<FlightRecorder *> &flightRecorder_()
+        {
+            static std::atomic<FlightRecorder *> recorder{nullptr};
+            return recorder;
+        }
+        static void recordFlight(const char *msg, const uint64_t len);
+        static std::atomic<LogBroadcast *> &logBroadcast_()
+        {
+            static std::atomic<LogBroadcast *> broadcast{nullptr};
+            return broadcast;
+        }
+        static void broadcastRecord(int level,
+                                    int index,
+                                    const char *msg,
+                                    const uint64_t len);
+        /**
+         * @brief Pass a record to the record function of its channel, and
+         * flush it after an error.
+         *
+         */
+        static void outputRecord(const LogRecord &record);
         static void defaultOutputFunction(const char *msg, const uint64_t len)
         {
             fwrite(msg, 1, static_cast<size_t>(len), stdout);
@@ -243,32 +314,14 @@ namespace xiaoLog
 #endif
             return logLevel;
         }
-        static std::function<void(const char *msg, const uint64_t len)> &outputFunc_()
-        {
-            static std::function<void(const char *msg, const uint64_t len)>
-                outputFunc = Logger::defaultOutputFunction;
-            return outputFunc;
-        }
+        static std::function<void(const LogRecord &record)> &recordFunc_();
         static std::function<void()> &flushFunc_()
         {
             static std::function<void()> flushFunc = Logger::defaultFlushFunction;
             return flushFunc;
         }
-        static std::function<void(const char *msg, const uint64_t len)> &outputFunc_(size_t index)
-        {
-            static std::vector<
-                std::function<void(const char *msg, const uint64_t len)>>
-                outputFuncs;
-            if (index < outputFuncs.size())
-            {
-                return outputFuncs[index];
-            }
-            while (index >= outputFuncs.size())
-            {
-                outputFuncs.emplace_back(outputFunc_());
-            }
-            return outputFuncs[index];
-        }
+        static std::function<void(const LogRecord &record)> &recordFunc_(
+            size_t index);
         static std::function<void()> &flushFunc_(size_t index)
         {
             static std::vector<std::function<void()>> flushFuncs;
@@ -284,6 +337,7 @@ namespace xiaoLog
         }
 
         friend class RawLogger;
+        friend class RequestLogScope;
         LogStream logStream_;
         Date date_{Date::now()};
         SourceFile sourceFile_;
@@ -291,8 +345,54 @@ namespace xiaoLog
         LogLevel level_;
         int index_{-1};
         const char *func_{nullptr};
+        // The offset of the message, after the time, the thread id, the
+        // level and the function.
         std::size_t spdLogMessageOffset_{0};
     };
+
+    /**
+     * @brief A record passed to a record function, with the fields its text
+     * was formatted from. The text and the strings are only valid during the
+     * call.
+     *
+     * The text of a record of Logger is made of:
+     * - the header, up to bodyOffset: time, thread id, level and function;
+     * - the body, bodyLength bytes: the message;
+     * - the trailer: the source file and line, and a newline.
+     *
+     * A record of RawLogger has no level, no time and no source, its text is
+     * all body.
+     */
+    struct LogRecord
+    {
+        Date date;
+        // -1 for the records of RawLogger.
+        int level{-1};
+        uint64_t threadId{0};
+        Logger::SourceFile sourceFile;
+        int line{0};
+        // The function, nullptr unless the macro passes it (LOG_TRACE and
+        // LOG_DEBUG).
+        const char *func{nullptr};
+        // The index of the output function, -1 for the default one.
+        int channel{-1};
+        const char *data{nullptr};
+        uint64_t length{0};
+        size_t bodyOffset{0};
+        size_t bodyLength{0};
+
+        const char *body() const
+        {
+            return data + bodyOffset;
+        }
+
+        // The offset of the level token (see Logger::levelString()) in the
+        // text, for the records which have a level.
+        size_t levelOffset() const
+        {
+            return bodyOffset - 7 - (func ? strlen(func) + 3 : 0);
+        }
+    };
     class XIAOLOG_EXPORT RawLogger : public NonCopyable
     {
     public:
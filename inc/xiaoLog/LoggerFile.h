@@ -0,0 +1,308 @@
+/**
+ * @file LoggerFile.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/Date.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace xiaoLog
+{
+    using StringPtr = std::shared_ptr<std::string>;
+
+    class LogFileWriter;
+    class LogIndexWriter;
+
+    /**
+     * @brief This class represents the log file currently written by an
+     * AsyncFileLogger. It names, rotates and deletes the log files, the
+     * actual I/O is done by a LogFileWriter selected by the write mode.
+     *
+     */
+    class XIAOLOG_EXPORT LoggerFile : NonCopyable
+    {
+    public:
+        /**
+         * @brief The way the buffers are written to the file.
+         *
+         * - kStdio: buffered stdio, one fwrite per buffer.
+         * - kMmap: the file is grown in large preallocated extents and the
+         *   buffers are copied into a shared mapping of a sliding window.
+         *   Data accepted by the writer is in the page cache at once, so it
+         *   survives a crash of the process.
+         * - kDirect: the file is opened with O_DIRECT and written in whole
+         *   4 KiB blocks, bypassing the page cache. The unaligned tail is
+         *   carried into the next write and the file is truncated to the
+         *   real length when it is closed. Extents are preallocated with
+         *   FALLOC_FL_KEEP_SIZE. Only available on Linux.
+         * - kFramed: each buffer is compressed into an independent frame of
+         *   the FramedLog format, which can be read at any offset with
+         *   FramedLogReader or the xiaolog-frame tool. The size limit applies
+         *   to the compressed file and rotated files aren't compressed again.
+         */
+        enum class WriteMode
+        {
+            kStdio = 0,
+            kMmap,
+            kDirect,
+            kFramed
+        };
+
+        /**
+         * @brief The wall-clock period after which the log is switched.
+         *
+         */
+        enum class RotationPeriod
+        {
+            kNone = 0,
+            kHourly,
+            kDaily
+        };
+
+        /**
+         * @brief When the written data is forced to the disk.
+         *
+         * - kNone: the kernel writes the page cache back when it likes.
+         * - kPeriodic: fdatasync after a given number of bytes or a given
+         *   time, checked when the file is flushed. Without thresholds every
+         *   flush is synced. The file is also synced before it's rotated.
+         * - kWriteBehind: each flush starts the write back of the new data
+         *   with sync_file_range and waits for the previous range, which
+         *   keeps the dirty pages bounded without blocking on the disk for
+         *   the latest data.
+         */
+        enum class SyncPolicy
+        {
+            kNone = 0,
+            kPeriodic,
+            kWriteBehind
+        };
+
+        LoggerFile(const std::string &filePath,
+                   const std::string &fileBaseName,
+                   const std::string &fileExtName,
+                   bool switchOnLimitOnly = false,
+                   size_t maxFiles = 0,
+                   WriteMode writeMode = WriteMode::kStdio);
+        ~LoggerFile();
+        void writeLog(const StringPtr buf);
+        void open();
+        void switchLog(bool openNewOne);
+        uint64_t getLength();
+        explicit operator bool() const;
+        void flush();
+
+        /**
+         * @brief Flush and wait until the data is on the disk.
+         *
+         */
+        void sync();
+
+        /**
+         * @brief Set the sync policy.
+         *
+         * @param policy
+         * @param syncBytes For kPeriodic, sync after this many bytes, 0 means
+         * no byte threshold.
+         * @param syncInterval For kPeriodic, sync when the last sync is older
+         * than this, 0 means no time threshold.
+         */
+        void setSyncPolicy(SyncPolicy policy,
+                           uint64_t syncBytes = 0,
+                           std::chrono::milliseconds syncInterval =
+                               std::chrono::milliseconds(0))
+        {
+            syncPolicy_ = policy;
+            syncBytes_ = syncBytes;
+            syncInterval_ = syncInterval;
+        }
+
+        /**
+         * @brief Set the max total size of the rotated log files. When the
+         * total size exceeds the limit, the oldest log files are deleted.
+         *
+         * @param bytes 0 means no limit.
+         */
+        void setMaxTotalSize(uint64_t bytes)
+        {
+            maxTotalSize_ = bytes;
+        }
+
+        /**
+         * @brief Set the max age of the rotated log files. Older log files
+         * are deleted when the log is switched.
+         *
+         * @param age 0 means no limit.
+         */
+        void setMaxAge(std::chrono::seconds age)
+        {
+            maxAge_ = age;
+        }
+
+        /**
+         * @brief Set whether the rotated log files are compressed with gzip.
+         * It has no effect if xiaoLog was built without zlib.
+         *
+         * @param flag
+         */
+        void setCompressRotatedFiles(bool flag)
+        {
+            compress_ = flag && hasCompressionSupport();
+        }
+
+        /**
+         * @brief Run closing, compressing and deleting rotated files and
+         * opening the next file in a housekeeping thread. The next file is
+         * opened in advance, so switching the log only renames two files.
+         *
+         * @param flag
+         */
+        void setAsyncHousekeeping(bool flag);
+
+        /**
+         * @brief Switch the log at hourly or daily wall-clock boundaries, in
+         * addition to the size limit.
+         *
+         * @param period
+         * @param localTime Whether the boundaries are in the local time zone
+         * or in UTC.
+         */
+        void setRotationPeriod(RotationPeriod period, bool localTime = false);
+
+        /**
+         * @brief Check whether the rotation boundary of the current file has
+         * passed. It's one comparison, the boundary is computed when the file
+         * is opened.
+         *
+         * @param microSecondsSinceEpoch
+         * @return true
+         * @return false
+         */
+        bool timeToSwitch(int64_t microSecondsSinceEpoch) const
+        {
+            return microSecondsSinceEpoch >= nextRotationTime_;
+        }
+
+        /**
+         * @brief Move rotated files into one directory per day (YYYYMMDD)
+         * under the log path. The retention limits are then applied to whole
+         * days: the max number of files counts directories and a day is
+         * deleted at once.
+         *
+         * @param flag
+         */
+        void setDirectoryPerDay(bool flag);
+
+        /**
+         * @brief Keep a sparse index of the log file in a sidecar file (see
+         * LogIndex), with an entry every given number of bytes. The index
+         * follows the file when it's rotated and is deleted with it.
+         *
+         * @param bytes 0 disables the index.
+         */
+        void setIndexInterval(uint64_t bytes);
+
+        /**
+         * @brief Set the compression dictionary of the kFramed write mode, see
+         * FramedLog::trainDictionary(). It's stored in each file using it.
+         *
+         * @param dictionary
+         */
+        void setFrameDictionary(const std::string &dictionary);
+
+        /**
+         * @brief Check whether xiaoLog was built with zlib support.
+         *
+         * @return true
+         * @return false
+         */
+        static bool hasCompressionSupport();
+
+    protected:
+        struct ArchivedFile
+        {
+            std::string name;
+            uint64_t size;
+            int64_t mtime;
+        };
+
+        void initFilenameQueue();
+        // Whether name is a rotated file of this logger, or its index if
+        // withIndex is set.
+        bool isArchiveName(const std::string &name, bool withIndex) const;
+        void deleteOldFiles();
+        bool retentionEnabled() const
+        {
+            return maxFiles_ > 0 || maxTotalSize_ > 0 || maxAge_.count() > 0;
+        }
+        void archive(std::unique_ptr<LogFileWriter> writer,
+                     const std::string &fileName);
+        bool compressFile(const std::string &fileName,
+                          const std::string &gzName);
+        void housekeepingThreadFunc();
+        void stopHousekeeping();
+        void updateRotationTime();
+        void openIndex();
+        std::string formatDate(const char *fmt) const;
+        std::string archiveName();
+
+        std::unique_ptr<LogFileWriter> writer_;
+        Date creationDate_;
+        std::string fileFullName_;
+        std::string filePath_;
+        std::string fileBaseName_;
+        std::string fileExtName_;
+        static uint64_t fileSeq_;
+        bool switchOnLimitOnly_{false};
+
+        WriteMode writeMode_{WriteMode::kStdio};
+
+        size_t maxFiles_{0};
+        uint64_t maxTotalSize_{0};
+        std::chrono::seconds maxAge_{0};
+        bool compress_{false};
+        RotationPeriod rotationPeriod_{RotationPeriod::kNone};
+        bool rotateInLocalTime_{false};
+        int64_t nextRotationTime_{INT64_MAX};
+        bool directoryPerDay_{false};
+        std::string lastDayDirectory_;
+        SyncPolicy syncPolicy_{SyncPolicy::kNone};
+        uint64_t syncBytes_{0};
+        std::chrono::milliseconds syncInterval_{0};
+        uint64_t unsyncedBytes_{0};
+        std::chrono::steady_clock::time_point lastSyncTime_{
+            std::chrono::steady_clock::now()};
+        bool filenameQueueInited_{false};
+        uint64_t totalSize_{0};
+        std::deque<ArchivedFile> filenameQueue_;
+
+        std::unique_ptr<std::thread> housekeepingThreadPtr_;
+        std::mutex housekeepingMutex_;
+        std::condition_variable housekeepingCond_;
+        std::vector<std::pair<std::unique_ptr<LogFileWriter>, std::string>>
+            rotatedFiles_;
+        std::unique_ptr<LogFileWriter> nextWriter_;
+        std::string nextFileName_;
+        bool housekeepingStop_{false};
+        uint64_t indexInterval_{0};
+        std::unique_ptr<LogIndexWriter> indexWriter_;
+        std::shared_ptr<const std::string> frameDictionary_;
+    };
+}
@@ -0,0 +1,82 @@
+/**
+ * @file PipeSink.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/LogSink.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#ifdef __linux__
+namespace xiaoLog
+{
+    /**
+     * @brief This sink writes the buffers of an AsyncFileLogger to a pipe,
+     * e.g. to a shipper which splice()s them on to a file or a socket. The
+     * buffers are written with write() and reused by the logger at once; a
+     * larger pipe (F_SETPIPE_SZ) lets a slow reader lag further behind
+     * before the logging thread blocks. Only available on Linux.
+     *
+     * @code
+     * auto sink = xiaoLog::PipeSink::open(STDOUT_FILENO);
+     * asyncFileLogger.setSink(sink);
+     * @endcode
+     */
+    class XIAOLOG_EXPORT PipeSink : public LogSink
+    {
+    public:
+        /**
+         * @brief Write to an open pipe, which stays open when the sink is
+         * destroyed.
+         *
+         * @param fd
+         * @param pipeSize Resize the pipe (F_SETPIPE_SZ) if not 0.
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<PipeSink> open(int fd, size_t pipeSize = 0);
+
+        /**
+         * @brief Open a named pipe, it waits for the reader.
+         *
+         * @param path
+         * @param pipeSize Resize the pipe (F_SETPIPE_SZ) if not 0.
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<PipeSink> openFifo(const std::string &path,
+                                                  size_t pipeSize = 0);
+
+        ~PipeSink() override;
+
+        void write(const StringPtr &buf) override;
+
+        /**
+         * @brief The bytes written to the pipe.
+         *
+         */
+        uint64_t writtenBytes() const
+        {
+            return writtenBytes_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        PipeSink(int fd, bool ownFd);
+        void setPipeSize(size_t pipeSize);
+        void writeAll(const char *data, size_t len);
+
+        int fd_;
+        bool ownFd_;
+        bool isPipe_{false};
+        bool failed_{false};
+        std::atomic<uint64_t> writtenBytes_{0};
+    };
+}
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file RequestLogScope.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+
+namespace xiaoLog
+{
+    struct LogRecord;
+
+    /**
+     * @brief This class holds back the records of the current thread during
+     * a request and decides at its end whether to keep them, so the details
+     * of the failed or slow requests are logged and the others cost no I/O.
+     * Records are copied into a buffer of the thread which is reused by the
+     * next requests. At the end of the scope they are passed to the output
+     * functions of their channels if the request failed (fail() was called
+     * or an error was logged) or lasted longer than the threshold, otherwise
+     * they are dropped by resetting the end of the buffer. A FATAL record is
+     * output at once, with the records held before it. The flight recorder
+     * and the broadcast still get every record when it's logged. Scopes
+     * nested in another one on the same thread belong to the outer one.
+     *
+     * @code
+     * {
+     *     xiaoLog::RequestLogScope scope(std::chrono::milliseconds(200));
+     *     LOG_DEBUG << "details kept for slow or failed requests only";
+     *     if (!handle(request))
+     *         scope.fail();
+     * }
+     * @endcode
+     */
+    class XIAOLOG_EXPORT RequestLogScope : NonCopyable
+    {
+    public:
+        /**
+         * @brief
+         *
+         * @param latencyThreshold Requests lasting longer are logged.
+         * @param maxBufferSize The records which don't fit in the buffer of
+         * the thread are dropped and counted, except the errors, which
+         * commit the held records and are output at once.
+         */
+        explicit RequestLogScope(
+            std::chrono::microseconds latencyThreshold =
+                std::chrono::microseconds::max(),
+            size_t maxBufferSize = 1024 * 1024);
+        ~RequestLogScope();
+
+        /**
+         * @brief Mark the request as failed, its records will be logged.
+         *
+         */
+        void fail()
+        {
+            failed_ = true;
+        }
+
+        /**
+         * @brief Output the records held so far now and the next ones at
+         * the end of the scope.
+         *
+         */
+        void commit();
+
+        /**
+         * @brief Drop the records held so far, the next ones are still held
+         * and kept if the request fails.
+         *
+         */
+        void discard();
+
+        /**
+         * @brief The number of records dropped because the buffer was full.
+         *
+         */
+        static uint64_t droppedRecords();
+
+        /**
+         * @brief Hold a record if a scope is active on the current thread,
+         * with its fields. Called by the loggers.
+         *
+         * @return false if the record must be output now.
+         */
+        static bool capture(const LogRecord &record);
+
+    private:
+        std::chrono::steady_clock::time_point start_;
+        std::chrono::microseconds latencyThreshold_;
+        bool active_{false};
+        bool failed_{false};
+    };
+}
@@ -0,0 +1,120 @@
+/**
+ * @file ShardedFileLogger.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <string>
+
+namespace xiaoLog
+{
+    /**
+     * @brief This class spreads the logs over several AsyncFileLogger shards,
+     * each with its own buffers, logging thread and files, so the logging
+     * throughput grows with the number of cores. Every record is prefixed
+     * with a number from one sequence shared by all the shards (see
+     * AsyncFileLogger::setRecordSequence()), the xiaolog-merge tool merges
+     * the shard files, including the rotated ones, back into one stream.
+     *
+     * @code
+     * xiaoLog::ShardedFileLogger logger(4);
+     * logger.setFileName("app");  // app.0.log ... app.3.log
+     * logger.startLogging();
+     * xiaoLog::Logger::setOutputFunction(
+     *     [&](const char *msg, const uint64_t len) { logger.output(msg, len); },
+     *     [&]() { logger.flush(); });
+     * @endcode
+     */
+    class XIAOLOG_EXPORT ShardedFileLogger : NonCopyable
+    {
+    public:
+        /**
+         * @brief How a message is assigned to a shard.
+         *
+         * - kThread: each thread writes to one shard, the threads are spread
+         *   over the shards in the order they first log.
+         * - kCpu: the shard of the CPU the thread is running on. Falls back
+         *   to kThread on systems other than Linux.
+         */
+        enum class ShardBy
+        {
+            kThread = 0,
+            kCpu
+        };
+
+        /**
+         * @brief Construct a new ShardedFileLogger object
+         *
+         * @param shardNum The number of shards, 0 means one per hardware
+         * thread.
+         * @param shardBy
+         */
+        explicit ShardedFileLogger(size_t shardNum = 0,
+                                   ShardBy shardBy = ShardBy::kThread);
+
+        void output(const char *msg, const uint64_t len);
+        void flush();
+        void flushAndWait(bool sync = false);
+        void startLogging();
+
+        /**
+         * @brief Set the file names of the shards, shard i writes
+         * <path><baseName>.<i><extName>. It must be called before
+         * startLogging().
+         *
+         * @param baseName
+         * @param extName
+         * @param path
+         */
+        void setFileName(const std::string &baseName,
+                         const std::string &extName = ".log",
+                         const std::string &path = "./");
+
+        size_t shardNum() const
+        {
+            return shards_.size();
+        }
+
+        /**
+         * @brief Get a shard to change its settings before startLogging().
+         *
+         * @param index
+         * @return AsyncFileLogger&
+         */
+        AsyncFileLogger &shard(size_t index)
+        {
+            return *shards_[index];
+        }
+
+        /**
+         * @brief Parse the header of a sequenced record.
+         *
+         * @param data At least AsyncFileLogger::kRecordHeaderLength bytes.
+         * @param seq The sequence number of the record.
+         * @param len The length of the message after the header.
+         * @return true if data starts with a valid header.
+         */
+        static bool parseRecordHeader(const char *data,
+                                      uint64_t &seq,
+                                      uint64_t &len);
+
+    private:
+        size_t shardIndex() const;
+
+        std::vector<std::unique_ptr<AsyncFileLogger>> shards_;
+        std::shared_ptr<std::atomic<uint64_t>> sequence_;
+        ShardBy shardBy_;
+    };
+}
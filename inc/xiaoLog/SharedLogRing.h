@@ -0,0 +1,164 @@
+/**
+ * @file SharedLogRing.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/exports.h>
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <memory>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#ifndef _WIN32
+namespace xiaoLog
+{
+    /**
+     * @brief This class is a log ring in shared memory written by many
+     * processes, e.g. the workers of a prefork server, and drained by one
+     * SharedLogCollector. Each process gets its own single-producer ring in
+     * the segment, so writing a record takes no lock across processes and no
+     * syscall. A record becomes visible when the write cursor of the ring is
+     * published after the copy, so a producer which dies in the middle of a
+     * write leaves nothing half-written. The rings of dead processes are
+     * drained and reclaimed by the collector. A forked child takes its own
+     * ring on its first write. Not available on Windows.
+     *
+     * @code
+     * // In the master, before forking the workers.
+     * auto ring = xiaoLog::SharedLogRing::create("");
+     * xiaoLog::SharedLogCollector collector(ring);
+     * collector.fileLogger().setFileName("workers");
+     * collector.startCollecting();
+     * // In every worker.
+     * xiaoLog::Logger::setOutputFunction(
+     *     [ring](const char *msg, const uint64_t len) { ring->output(msg, len); },
+     *     []() {});
+     * @endcode
+     */
+    class XIAOLOG_EXPORT SharedLogRing : NonCopyable
+    {
+    public:
+        /**
+         * @brief Create a ring.
+         *
+         * @param name The POSIX shared memory name (e.g. "/app-log") other
+         * processes can attach to. An empty name creates an anonymous memfd
+         * segment which is shared with forked children only.
+         * @param ringSize The size of the ring of each process.
+         * @param ringNum The max number of processes writing at the same time.
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<SharedLogRing> create(
+            const std::string &name,
+            size_t ringSize = 1024 * 1024,
+            size_t ringNum = 64);
+
+        /**
+         * @brief Attach to a ring created by another process.
+         *
+         * @param name
+         * @return nullptr on failure.
+         */
+        static std::shared_ptr<SharedLogRing> attach(const std::string &name);
+
+        /**
+         * @brief Remove the name of a shared memory ring, the processes which
+         * attached to it keep using it.
+         *
+         * @param name
+         */
+        static void unlink(const std::string &name);
+
+        ~SharedLogRing();
+
+        /**
+         * @brief Write a record to the ring of the calling process. The
+         * record is dropped and counted if the ring is full. Threads of one
+         * process serialize on a mutex local to the process.
+         *
+         * @param msg
+         * @param len
+         */
+        void output(const char *msg, const uint64_t len);
+
+        /**
+         * @brief Read all the published records, reclaiming the rings of dead
+         * processes. Only the collector may call it.
+         *
+         * @param func Called for each record.
+         * @return The number of records.
+         */
+        size_t drain(const std::function<void(const char *, uint64_t)> &func);
+
+        /**
+         * @brief Become the collector if there is none or it's dead.
+         *
+         * @return true if the calling process is the collector.
+         */
+        bool tryBecomeCollector();
+        void releaseCollector();
+
+    private:
+        SharedLogRing() = default;
+        bool map(int fd, bool init, size_t ringSize, size_t ringNum);
+        int ownRing();
+
+        int fd_{-1};
+        char *base_{nullptr};
+        size_t mapSize_{0};
+        std::mutex mutex_;
+        int ring_{-1};
+        int pid_{0};
+        std::string tmpRecord_;
+        std::chrono::steady_clock::time_point lastOwnerCheck_;
+    };
+
+    /**
+     * @brief This class drains a SharedLogRing into an AsyncFileLogger, with
+     * its usual rotation and retention. Several processes may run one, they
+     * elect a single active collector through the ring and another one takes
+     * over if it dies. Records the dead collector had read but not written
+     * may then be written twice.
+     *
+     */
+    class XIAOLOG_EXPORT SharedLogCollector : NonCopyable
+    {
+    public:
+        explicit SharedLogCollector(std::shared_ptr<SharedLogRing> ring);
+        ~SharedLogCollector();
+
+        /**
+         * @brief Get the logger which writes the files, to change its
+         * settings before startCollecting().
+         *
+         * @return AsyncFileLogger&
+         */
+        AsyncFileLogger &fileLogger()
+        {
+            return fileLogger_;
+        }
+
+        void startCollecting();
+
+    private:
+        void collectThreadFunc();
+
+        std::shared_ptr<SharedLogRing> ring_;
+        AsyncFileLogger fileLogger_;
+        std::unique_ptr<std::thread> threadPtr_;
+        std::atomic<bool> stopFlag_{false};
+    };
+}
+#endif
@@ -9,12 +9,16 @@
  */
 
 #include <xiaoLog/AsyncFileLogger.h>
+#include <xiaoLog/AsyncLogExecutor.h>
 #if !defined(_WIN32) || defined(__MINGW32__)
 #include <unistd.h>
-#include <dirent.h>
-#include <sys/stat.h>
 #ifdef __linux__
 #include <sys/prctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/mempolicy.h>
 #endif
 #else
 #include <windows.h>
@@ -24,16 +28,52 @@
 #include <iostream>
 #include <functional>
 #include <chrono>
+#include <fstream>
 
 namespace xiaoLog
 {
-    static constexpr std::chrono::seconds kLogFlushTimeout{1};
     static constexpr size_t kMemBufferSize{4 * 1024 * 1024};
+    // Iterations of the adaptive wait strategy before yielding and parking.
+    static constexpr uint64_t kSpinCount{4000};
+    static constexpr uint64_t kYieldCount{200};
     extern const char *strerror_tl(int savedErrno);
 } // namespace xiaoLog
 
 using namespace xiaoLog;
 
+#ifdef __linux__
+// Parse a cpu list like "0-3,8,10-11" as found in sysfs.
+static std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        auto dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = dash == std::string::npos ? first
+                                             : atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+        pos = end + 1;
+    }
+    return cpus;
+}
+#endif
+
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
 AsyncFileLogger::AsyncFileLogger()
     : logBufferPtr_(new std::string), nextBufferPtr_(new std::string)
 {
@@ -43,7 +83,14 @@ AsyncFileLogger::AsyncFileLogger()
 
 AsyncFileLogger::~AsyncFileLogger()
 {
-    stopFlag_ = true;
+    if (executor_)
+        executor_->unregisterLogger(this);
+    {
+        // The logging thread may sleep without a timeout, so the flag must not
+        // be set between its check and its wait.
+        std::lock_guard<std::mutex> guard_(mutex_);
+        stopFlag_ = true;
+    }
     if (threadPtr_)
     {
         cond_.notify_all();
@@ -61,7 +108,9 @@ AsyncFileLogger::~AsyncFileLogger()
             writerBuffers_.pop();
             writeLogToFile(tmpPtr);
         }
+        flushOutput(false);
     }
+    completeFlushWaiters(true);
 }
 
 void AsyncFileLogger::output(const char *msg, const uint64_t len)
@@ -70,14 +119,12 @@ void AsyncFileLogger::output(const char *msg, const uint64_t len)
     if (len > kMemBufferSize)
         return;
     if (!logBufferPtr_)
-    {
-        logBufferPtr_ = std::make_shared<std::string>();
-        logBufferPtr_->reserve(kMemBufferSize);
-    }
-    if (logBufferPtr_->capacity() - logBufferPtr_->length() < len)
+        logBufferPtr_ = newBuffer();
+    uint64_t recordLen = len + (recordSequence_ ? kRecordHeaderLength : 0);
+    if (logBufferPtr_->capacity() - logBufferPtr_->length() < recordLen)
     {
         swapBuffer();
-        cond_.notify_one();
+        notifyWriter();
     }
     if (writerBuffers_.size() > 25) // 100M bytes logs in buffer
     {
@@ -85,6 +132,14 @@ void AsyncFileLogger::output(const char *msg, const uint64_t len)
         return;
     }
 
+    if (logBufferPtr_->empty())
+    {
+        // Arm the flush timer of an idle backend.
+        if (executor_)
+            executor_->scheduleFlush(this, flushInterval_);
+        else if (backendParked_)
+            cond_.notify_one();
+    }
     if (lostCounter_ > 0)
     {
         char logErr[128];
@@ -94,275 +149,477 @@ void AsyncFileLogger::output(const char *msg, const uint64_t len)
                      "%llu log information is lost\n",
                      static_cast<long long unsigned int>(lostCounter_));
         lostCounter_ = 0;
-        logBufferPtr_->append(logErr, strlen);
+        appendRecord(logErr, strlen);
+    }
+    appendRecord(msg, len);
+}
+
+void AsyncFileLogger::appendRecord(const char *msg, uint64_t len)
+{
+    if (recordSequence_)
+    {
+        char header[kRecordHeaderLength + 1];
+        snprintf(header,
+                 sizeof(header),
+                 "%016llx %08llx ",
+                 static_cast<long long unsigned int>(
+                     recordSequence_->fetch_add(1, std::memory_order_relaxed)),
+                 static_cast<long long unsigned int>(len));
+        logBufferPtr_->append(header, kRecordHeaderLength);
     }
     logBufferPtr_->append(msg, len);
 }
 
 void AsyncFileLogger::flush()
 {
+    if (syncOnFlush_)
+    {
+        flushAndWait(true);
+        return;
+    }
     std::lock_guard<std::mutex> guard_(mutex_);
+    if (!started_)
+    {
+        if (logBufferPtr_->length() > 0)
+            swapBuffer();
+        return;
+    }
     if (logBufferPtr_->length() > 0)
     {
-        swapBuffer();
-        cond_.notify_one();
+        requestFlush();
     }
 }
 
-void AsyncFileLogger::writeLogToFile(const StringPtr buf)
+void AsyncFileLogger::requestFlush()
 {
-    if (!loggerFilePtr_)
+    // Swapping here would queue a small buffer per ERROR message, the logging
+    // thread swaps once for all the requests made before the deadline.
+    if (flushDeadline_.load(std::memory_order_relaxed) != INT64_MAX)
+        return;
+    auto deadline = std::chrono::steady_clock::now() + flushCoalesceDelay_;
+    flushDeadline_.store(
+        static_cast<int64_t>(deadline.time_since_epoch().count()),
+        std::memory_order_release);
+    if (executor_)
     {
-        loggerFilePtr_ =
-            std::unique_ptr<LoggerFile>(new LoggerFile(filePath_,
-                                                       fileBaseName_,
-                                                       fileExtName_,
-                                                       switchOnLimitOnly_,
-                                                       maxFiles_));
+        if (flushCoalesceDelay_.count() == 0)
+            executor_->notify(this);
+        else
+            executor_->scheduleFlush(this, flushCoalesceDelay_, true);
     }
-    loggerFilePtr_->writeLog(buf);
-    if (loggerFilePtr_->getLength() > sizeLimit_)
+    else if (backendParked_)
     {
-        loggerFilePtr_->switchLog(true);
+        cond_.notify_one();
     }
 }
 
-void AsyncFileLogger::logThreadFunc()
+std::future<void> AsyncFileLogger::flushAsync(bool sync)
 {
-#ifdef __linux__
-    prctl(PR_SET_NAME, "AsyncFileLogger");
-#endif
-    while (!stopFlag_)
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!started_)
     {
+        // Nobody else writes the log file yet.
+        if (logBufferPtr_->length() > 0)
         {
-            std::unique_lock<std::mutex> lock(mutex_);
-            while (writerBuffers_.size() == 0 && !stopFlag_)
-            {
-                if (cond_.wait_for(lock, kLogFlushTimeout) ==
-                    std::cv_status::timeout)
-                {
-                    if (logBufferPtr_->length() > 0)
-                    {
-                        swapBuffer();
-                    }
-                    break;
-                }
-            }
-            tmpBuffers_.swap(writerBuffers_);
+            swapBuffer();
         }
-
-        while (!tmpBuffers_.empty())
+        while (!writerBuffers_.empty())
         {
-            StringPtr tmpPtr = (StringPtr &&)tmpBuffers_.front();
-            tmpBuffers_.pop();
+            StringPtr tmpPtr = (StringPtr &&)writerBuffers_.front();
+            writerBuffers_.pop();
             writeLogToFile(tmpPtr);
             tmpPtr->clear();
+            nextBufferPtr_ = tmpPtr;
+            ++writtenCount_;
+        }
+        flushOutput(sync);
+        flushedCount_ = writtenCount_;
+        lock.unlock();
+        promise.set_value();
+        return future;
+    }
+    auto swapCount = swapCount_.load(std::memory_order_relaxed);
+    if (logBufferPtr_->length() > 0)
+    {
+        // The messages go out with the next swap, merged with other flushes.
+        requestFlush();
+        ++swapCount;
+    }
+    else if (swapCount <= flushedCount_)
+    {
+        if (!sync)
+        {
+            lock.unlock();
+            promise.set_value();
+            return future;
+        }
+        syncRequested_.store(true, std::memory_order_release);
+        notifyWriter();
+    }
+    flushWaiters_.push_back({swapCount, sync, std::move(promise)});
+    return future;
+}
+
+void AsyncFileLogger::completeFlushWaiters(bool all)
+{
+    std::vector<FlushWaiter> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flushWaiters_.empty())
+            return;
+        auto iter = flushWaiters_.begin();
+        while (iter != flushWaiters_.end())
+        {
+            if (all || iter->swapCount <= flushedCount_)
+            {
+                done.push_back(std::move(*iter));
+                iter = flushWaiters_.erase(iter);
+            }
+            else
             {
-                std::unique_lock<std::mutex> lock(mutex_);
-                nextBufferPtr_ = tmpPtr;
+                ++iter;
             }
         }
-        if (loggerFilePtr_)
-            loggerFilePtr_->flush();
+        syncRequested_.store(false, std::memory_order_relaxed);
+    }
+    bool sync = std::any_of(done.begin(),
+                            done.end(),
+                            [](const FlushWaiter &waiter) {
+                                return waiter.sync;
+                            });
+    if (sync)
+        flushOutput(true);
+    for (auto &waiter : done)
+    {
+        waiter.promise.set_value();
     }
 }
 
-void AsyncFileLogger::startLogging()
+void AsyncFileLogger::notifyWriter()
 {
-    threadPtr_ = std::unique_ptr<std::thread>(
-        new std::thread(std::bind(&AsyncFileLogger::logThreadFunc, this)));
+    if (executor_)
+        executor_->notify(this);
+    else if (backendParked_)
+        cond_.notify_one();
 }
 
-AsyncFileLogger::LoggerFile::LoggerFile(const std::string &filePath,
-                                        const std::string &fileBaseName,
-                                        const std::string &fileExtName,
-                                        bool switchOnLimitOnly,
-                                        size_t maxFiles)
-    : creationDate_(Date::date()),
-      filePath_(filePath),
-      fileBaseName_(fileBaseName),
-      fileExtName_(fileExtName),
-      switchOnLimitOnly_(switchOnLimitOnly),
-      maxFiles_(maxFiles)
+void AsyncFileLogger::flushOutput(bool sync)
 {
-    open();
+    if (sink_)
+        sink_->flush();
+    else if (loggerFilePtr_)
+        sync ? loggerFilePtr_->sync() : loggerFilePtr_->flush();
+}
 
-    if (maxFiles_ > 0)
+void AsyncFileLogger::writeLogToFile(const StringPtr buf)
+{
+    if (sink_)
+    {
+        sink_->write(buf);
+        return;
+    }
+    if (!loggerFilePtr_)
+    {
+        loggerFilePtr_ =
+            std::unique_ptr<LoggerFile>(new LoggerFile(filePath_,
+                                                       fileBaseName_,
+                                                       fileExtName_,
+                                                       switchOnLimitOnly_,
+                                                       maxFiles_,
+                                                       writeMode_));
+        loggerFilePtr_->setMaxTotalSize(maxTotalSize_);
+        loggerFilePtr_->setMaxAge(maxFileAge_);
+        loggerFilePtr_->setCompressRotatedFiles(compressRotatedFiles_);
+        loggerFilePtr_->setRotationPeriod(rotationPeriod_, rotateInLocalTime_);
+        loggerFilePtr_->setDirectoryPerDay(directoryPerDay_);
+        loggerFilePtr_->setSyncPolicy(syncPolicy_, syncBytes_, syncInterval_);
+        loggerFilePtr_->setIndexInterval(indexInterval_);
+        if (!frameDictionary_.empty())
+            loggerFilePtr_->setFrameDictionary(frameDictionary_);
+        loggerFilePtr_->setAsyncHousekeeping(asyncHousekeeping_);
+    }
+    if (loggerFilePtr_->timeToSwitch(Date::now().microSecondsSinceEpoch()))
     {
-        initFilenameQueue();
+        loggerFilePtr_->switchLog(true);
+    }
+    loggerFilePtr_->writeLog(buf);
+    if (loggerFilePtr_->getLength() > sizeLimit_)
+    {
+        loggerFilePtr_->switchLog(true);
     }
 }
 
-void AsyncFileLogger::LoggerFile::open()
+void AsyncFileLogger::logThreadFunc()
 {
-    fileFullName_ = filePath_ + fileBaseName_ + fileExtName_;
-#ifndef _MSC_VER
-    fp_ = fopen(fileFullName_.c_str(), "a");
-#else
+#ifdef __linux__
+    prctl(PR_SET_NAME, "AsyncFileLogger");
 #endif
-    if (fp_ == nullptr)
+    applyThreadPlacement();
+    while (!stopFlag_)
     {
-        std::cout << strerror_tl(errno) << std::endl;
+        waitForBuffers();
+        writeTmpBuffers();
     }
 }
 
-uint64_t AsyncFileLogger::LoggerFile::fileSeq_{0};
-void AsyncFileLogger::LoggerFile::writeLog(const StringPtr buf)
+bool AsyncFileLogger::spinForBuffers(
+    std::chrono::steady_clock::time_point deadline)
 {
-    if (fp_)
+    for (uint64_t i = 0; !stopFlag_; ++i)
     {
-        fwrite(buf->c_str(), 1, buf->length(), fp_);
+        if (swapCount_.load(std::memory_order_acquire) != lastSwapCount_ ||
+            syncRequested_.load(std::memory_order_acquire))
+            return true;
+        // Spinning reads the clock now and then, each yield may take a
+        // whole time slice though.
+        bool yielding = waitStrategy_ != WaitStrategy::kBusyPoll &&
+                        i >= kSpinCount;
+        if (yielding || (i & 63) == 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline || flushDue(now))
+                return true;
+        }
+        if (waitStrategy_ == WaitStrategy::kBusyPoll || i < kSpinCount)
+            cpuRelax();
+        else if (i < kSpinCount + kYieldCount)
+            std::this_thread::yield();
+        else
+            return false;
     }
+    return true;
 }
 
-void AsyncFileLogger::LoggerFile::flush()
+void AsyncFileLogger::waitForBuffers()
 {
-    if (fp_)
+    auto deadline = std::chrono::steady_clock::now() + flushInterval_;
+    if (waitStrategy_ != WaitStrategy::kBlocking && spinForBuffers(deadline))
     {
-        fflush(fp_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writerBuffers_.empty() && logBufferPtr_->length() > 0)
+        {
+            swapBuffer();
+        }
+        lastSwapCount_ = swapCount_.load(std::memory_order_relaxed);
+        tmpBuffers_.swap(writerBuffers_);
+        return;
     }
-}
-
-uint64_t AsyncFileLogger::LoggerFile::getLength()
-{
-    if (fp_)
-        return ftell(fp_);
-    return 0;
-}
-
-void AsyncFileLogger::LoggerFile::switchLog(bool openNewOne)
-{
-    if (fp_)
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (writerBuffers_.size() == 0 && !syncRequested_ && !stopFlag_)
     {
-        fclose(fp_);
-        fp_ = nullptr;
-
-        char seq[12];
-        snprintf(seq,
-                 sizeof(seq),
-                 ".%06llu",
-                 static_cast<long long unsigned int>(fileSeq_ % 1000000));
-        ++fileSeq_;
-
-        std::string newName =
-            filePath_ + fileBaseName_ + "." +
-            creationDate_.toCustomFormattedStringLocal("%y%m%d-%H%M%S") +
-            std::string(seq) + fileExtName_;
-#if !defined(_WIN32) || defined(__MINGW32__)
-        rename(fileFullName_.c_str(), newName.c_str());
-#else
-#endif
-        if (maxFiles_ > 0)
+        backendParked_ = true;
+        if (logBufferPtr_->empty())
+        {
+            // Nothing to flush, sleep until a producer arms the timer.
+            cond_.wait(lock);
+            deadline = std::chrono::steady_clock::now() + flushInterval_;
+            continue;
+        }
+        auto wakeUpTime = deadline;
+        auto flushDeadline = flushDeadline_.load(std::memory_order_relaxed);
+        if (flushDeadline != INT64_MAX)
         {
-            filenameQueue_.push_back(newName);
-            if (filenameQueue_.size() > maxFiles_)
+            wakeUpTime = std::min(
+                wakeUpTime,
+                std::chrono::steady_clock::time_point(
+                    std::chrono::steady_clock::duration(flushDeadline)));
+        }
+        if (cond_.wait_until(lock, wakeUpTime) == std::cv_status::timeout)
+        {
+            if (logBufferPtr_->length() > 0)
             {
-                deleteOldFiles();
+                swapBuffer();
             }
+            break;
         }
-        if (openNewOne)
-            open();
     }
+    backendParked_ = false;
+    lastSwapCount_ = swapCount_.load(std::memory_order_relaxed);
+    tmpBuffers_.swap(writerBuffers_);
 }
 
-AsyncFileLogger::LoggerFile::~LoggerFile()
+void AsyncFileLogger::writeTmpBuffers()
 {
-    if (!switchOnLimitOnly_)
-        switchLog(false);
-    if (fp_)
-        fclose(fp_);
+    uint64_t written = 0;
+    while (!tmpBuffers_.empty())
+    {
+        StringPtr tmpPtr = (StringPtr &&)tmpBuffers_.front();
+        tmpBuffers_.pop();
+        writeLogToFile(tmpPtr);
+        tmpPtr->clear();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            nextBufferPtr_ = tmpPtr;
+            written = ++writtenCount_;
+        }
+    }
+    flushOutput(false);
+    if (written > 0)
+    {
+        // The barriers resolve once the buffers have left the process.
+        std::lock_guard<std::mutex> lock(mutex_);
+        flushedCount_ = written;
+    }
+    completeFlushWaiters(false);
 }
 
-void AsyncFileLogger::LoggerFile::initFilenameQueue()
+void AsyncFileLogger::writeBuffersInExecutor(bool flushLogBuffer)
 {
-    if (maxFiles_ <= 0)
     {
-        return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ((flushLogBuffer || flushDue(std::chrono::steady_clock::now())) &&
+            logBufferPtr_->length() > 0)
+        {
+            swapBuffer();
+        }
+        tmpBuffers_.swap(writerBuffers_);
     }
-#if !defined(_WIN32) || defined(__MINGW32__)
-    DIR *dp;
-    struct dirent *dirp;
-    struct stat st;
+    writeTmpBuffers();
+}
 
-    if ((dp = opendir(filePath_.c_str())) == nullptr)
+void AsyncFileLogger::applyThreadPlacement()
+{
+#ifdef __linux__
+    std::vector<int> cpus = cpuAffinity_;
+    if (cpus.empty() && numaNode_ >= 0)
     {
-        fprintf(stderr,
-                "Can't open dir %s: %s\n",
-                filePath_.c_str(),
-                strerror_tl(errno));
-        return;
+        std::ifstream in("/sys/devices/system/node/node" +
+                         std::to_string(numaNode_) + "/cpulist");
+        std::string list;
+        if (std::getline(in, list))
+            cpus = parseCpuList(list);
     }
-
-    while ((dirp = readdir(dp)) != nullptr)
-    {
-        std::string name = dirp->d_name;
-        if (name.size() != fileBaseName_.size() + 21 + fileExtName_.size() ||
-            name.compare(0, fileBaseName_.size(), fileBaseName_) != 0 ||
-            name.compare(name.size() - fileExtName_.size(),
-                         fileExtName_.size(),
-                         fileExtName_) != 0)
+    if (!cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus)
         {
-            continue;
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
         }
-        std::string fullname = filePath_ + name;
-        if (stat(fullname.c_str(), &st) == -1)
+        int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (r != 0)
         {
             fprintf(stderr,
-                    "Can't stat file %s: %s\n",
-                    fullname.c_str(),
-                    strerror_tl(errno));
-            continue;
+                    "Failed to set the affinity of the log thread: %s\n",
+                    strerror_tl(r));
         }
-        if (!S_ISREG(st.st_mode))
+    }
+    if (schedPolicy_ >= 0)
+    {
+        struct sched_param param;
+        param.sched_priority = schedPriority_;
+        int r = pthread_setschedparam(pthread_self(), schedPolicy_, &param);
+        if (r != 0)
         {
-            continue;
+            fprintf(stderr,
+                    "Failed to set the scheduling of the log thread: %s\n",
+                    strerror_tl(r));
         }
-        filenameQueue_.push_back(fullname);
-        std::push_heap(filenameQueue_.begin(),
-                       filenameQueue_.end(),
-                       std::greater<>());
-        if (filenameQueue_.size() > maxFiles_)
+    }
+#endif
+}
+
+void AsyncFileLogger::placeBuffer(const StringPtr &buf)
+{
+#ifdef __linux__
+    if (numaNode_ < 0 && !hugePageBuffers_)
+        return;
+    static const uintptr_t pageSize =
+        static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto data = reinterpret_cast<uintptr_t>(&(*buf)[0]);
+    uintptr_t begin = (data + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t end = (data + buf->capacity()) & ~(pageSize - 1);
+    if (end <= begin)
+        return;
+    void *addr = reinterpret_cast<void *>(begin);
+    size_t len = end - begin;
+    if (numaNode_ >= 0)
+    {
+        // Without libnuma, the node mask is a plain bit array.
+        constexpr size_t kMaxNodes{1024};
+        unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {0};
+        if (static_cast<size_t>(numaNode_) < kMaxNodes)
         {
-            std::pop_heap(filenameQueue_.begin(),
-                          filenameQueue_.end(),
-                          std::greater<>());
-            auto fileToRemove = std::move(filenameQueue_.back());
-            filenameQueue_.pop_back();
-            remove(fileToRemove.c_str());
+            mask[numaNode_ / (8 * sizeof(unsigned long))] |=
+                1UL << (numaNode_ % (8 * sizeof(unsigned long)));
+            if (syscall(SYS_mbind,
+                        addr,
+                        len,
+                        MPOL_PREFERRED,
+                        mask,
+                        kMaxNodes,
+                        MPOL_MF_MOVE) != 0)
+            {
+                fprintf(stderr,
+                        "Failed to bind log buffers to node %d: %s\n",
+                        numaNode_,
+                        strerror_tl(errno));
+            }
         }
     }
-    closedir(dp);
+    if (hugePageBuffers_)
+        madvise(addr, len, MADV_HUGEPAGE);
 #else
+    (void)buf;
 #endif
-    std::sort(filenameQueue_.begin(), filenameQueue_.end(), std::less<>());
 }
 
-void AsyncFileLogger::LoggerFile::deleteOldFiles()
+void AsyncFileLogger::prefaultBuffer(const StringPtr &buf)
 {
-    while (filenameQueue_.size() > maxFiles_)
+    placeBuffer(buf);
+    // Touch every page now, not on the first bursts of logs. The buffer may
+    // already hold messages logged before startLogging().
+    auto len = buf->length();
+    buf->resize(buf->capacity());
+    buf->resize(len);
+#ifdef __linux__
+    if (lockBuffers_ && mlock(buf->data(), buf->capacity()) != 0)
     {
-        std::string filename = std::move(filenameQueue_.front());
-        filenameQueue_.pop_front();
-#if !defined(_WIN32) || defined(__MINGW32__)
-        int r = remove(filename.c_str());
-#else
-        // Convert UTF-8 file to UCS-2
-        auto wName{utils::toNativePath(filename)};
-        int r = _wremove(wName.c_str());
+        fprintf(stderr,
+                "Failed to lock log buffers: %s\n",
+                strerror_tl(errno));
+    }
 #endif
-        if (r != 0)
-        {
-            fprintf(stderr,
-                    "Failed to remove file %s: %s\n",
-                    filename.c_str(),
-                    strerror_tl(errno));
-        }
+}
+
+StringPtr AsyncFileLogger::newBuffer()
+{
+    auto buf = std::make_shared<std::string>();
+    buf->reserve(kMemBufferSize);
+    // Before startLogging() the placement may not be set yet, it prefaults
+    // the buffers in use then.
+    if (started_)
+        prefaultBuffer(buf);
+    return buf;
+}
+
+void AsyncFileLogger::startLogging()
+{
+    {
+        std::lock_guard<std::mutex> guard_(mutex_);
+        prefaultBuffer(logBufferPtr_);
+        if (nextBufferPtr_)
+            prefaultBuffer(nextBufferPtr_);
+        started_ = true;
     }
+    if (executor_)
+    {
+        executor_->registerLogger(this);
+        return;
+    }
+    threadPtr_ = std::unique_ptr<std::thread>(
+        new std::thread(std::bind(&AsyncFileLogger::logThreadFunc, this)));
 }
 
 void AsyncFileLogger::swapBuffer()
 {
     writerBuffers_.push(logBufferPtr_);
+    swapCount_.fetch_add(1, std::memory_order_release);
+    flushDeadline_.store(INT64_MAX, std::memory_order_relaxed);
     if (nextBufferPtr_)
     {
         logBufferPtr_ = nextBufferPtr_;
@@ -371,7 +628,6 @@ void AsyncFileLogger::swapBuffer()
     }
     else
     {
-        logBufferPtr_ = std::make_shared<std::string>();
-        logBufferPtr_->reserve(kMemBufferSize);
+        logBufferPtr_ = newBuffer();
     }
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+/**
+ * @file AsyncLogExecutor.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/AsyncLogExecutor.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <algorithm>
+
+namespace xiaoLog
+{
+    static constexpr std::chrono::milliseconds kWheelTick{50};
+    static constexpr size_t kWheelSlots{64};
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+AsyncLogExecutor::AsyncLogExecutor(size_t threadNum)
+    : wheel_(kWheelSlots), nextTick_(Clock::now() + kWheelTick)
+{
+    threadNum = std::max<size_t>(threadNum, 1);
+    for (size_t i = 0; i < threadNum; ++i)
+    {
+        threads_.emplace_back(&AsyncLogExecutor::threadFunc, this);
+    }
+}
+
+AsyncLogExecutor::~AsyncLogExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void AsyncLogExecutor::registerLogger(AsyncFileLogger *logger)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    loggers_[logger];
+}
+
+void AsyncLogExecutor::unregisterLogger(AsyncFileLogger *logger)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (loggers_.find(logger) == loggers_.end())
+        return;
+    idleCond_.wait(lock, [this, logger]() {
+        return !loggers_[logger].running;
+    });
+    loggers_.erase(logger);
+    readyQueue_.erase(
+        std::remove(readyQueue_.begin(), readyQueue_.end(), logger),
+        readyQueue_.end());
+    // Drop the timers of the logger, they would fire for another logger
+    // registered at the same address later.
+    for (auto &slot : wheel_)
+    {
+        auto end = std::remove_if(slot.begin(),
+                                  slot.end(),
+                                  [logger](const TimerEntry &entry) {
+                                      return entry.logger == logger;
+                                  });
+        timerCount_ -= static_cast<size_t>(slot.end() - end);
+        slot.erase(end, slot.end());
+    }
+}
+
+void AsyncLogExecutor::enqueue(AsyncFileLogger *logger, LoggerState &state)
+{
+    if (state.running)
+    {
+        state.pending = true;
+        return;
+    }
+    if (!state.queued)
+    {
+        state.queued = true;
+        readyQueue_.push_back(logger);
+        cond_.notify_one();
+    }
+}
+
+void AsyncLogExecutor::notify(AsyncFileLogger *logger)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = loggers_.find(logger);
+    if (iter != loggers_.end())
+        enqueue(logger, iter->second);
+}
+
+void AsyncLogExecutor::scheduleFlush(AsyncFileLogger *logger,
+                                     std::chrono::microseconds delay,
+                                     bool force)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = loggers_.find(logger);
+    if (iter == loggers_.end() || (iter->second.scheduled && !force))
+        return;
+    auto now = Clock::now();
+    bool wasIdle = timerCount_ == 0;
+    if (wasIdle)
+        nextTick_ = now + kWheelTick;
+    size_t ticks = 0;
+    if (now + delay > nextTick_)
+    {
+        ticks = static_cast<size_t>((now + delay - nextTick_ + kWheelTick -
+                                     std::chrono::microseconds(1)) /
+                                    kWheelTick);
+    }
+    wheel_[(currentSlot_ + ticks) % kWheelSlots].push_back(
+        {logger, ticks / kWheelSlots});
+    ++timerCount_;
+    iter->second.scheduled = true;
+    // A thread waiting without a deadline has to pick up the new one.
+    if (wasIdle)
+        cond_.notify_one();
+}
+
+void AsyncLogExecutor::advanceWheel(Clock::time_point now)
+{
+    while (timerCount_ > 0 && now >= nextTick_)
+    {
+        auto &slot = wheel_[currentSlot_];
+        for (size_t i = 0; i < slot.size();)
+        {
+            if (slot[i].rounds > 0)
+            {
+                --slot[i].rounds;
+                ++i;
+                continue;
+            }
+            auto logger = slot[i].logger;
+            slot[i] = slot.back();
+            slot.pop_back();
+            --timerCount_;
+            auto iter = loggers_.find(logger);
+            if (iter != loggers_.end())
+            {
+                iter->second.scheduled = false;
+                iter->second.flushPending = true;
+                enqueue(logger, iter->second);
+            }
+        }
+        currentSlot_ = (currentSlot_ + 1) % kWheelSlots;
+        nextTick_ += kWheelTick;
+    }
+}
+
+void AsyncLogExecutor::threadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "LogExecutor");
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        advanceWheel(Clock::now());
+        if (!readyQueue_.empty())
+        {
+            auto logger = readyQueue_.front();
+            readyQueue_.pop_front();
+            auto iter = loggers_.find(logger);
+            if (iter == loggers_.end())
+                continue;
+            // The state is not erased while it's running, references into an
+            // unordered_map survive rehashing.
+            auto &state = iter->second;
+            state.queued = false;
+            state.running = true;
+            state.pending = false;
+            bool flushLogBuffer = state.flushPending;
+            state.flushPending = false;
+            lock.unlock();
+            logger->writeBuffersInExecutor(flushLogBuffer);
+            lock.lock();
+            state.running = false;
+            if (state.pending)
+            {
+                state.pending = false;
+                enqueue(logger, state);
+            }
+            idleCond_.notify_all();
+            continue;
+        }
+        if (stop_)
+            break;
+        if (timerCount_ > 0)
+            cond_.wait_until(lock, nextTick_);
+        else
+            cond_.wait(lock);
+    }
+}
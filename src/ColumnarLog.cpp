@@ -0,0 +1,889 @@
+/**
+ * @file ColumnarLog.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/ColumnarLog.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <xiaoLog/ShardedFileLogger.h>
+#include <xiaoLog/Date.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#ifdef XIAOLOG_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace xiaoLog
+{
+    extern const char *strerror_tl(int savedErrno);
+
+    static constexpr uint32_t kFileMagic{0x31434c58};  // "XLC1"
+    static constexpr uint32_t kGroupMagic{0x31474c58}; // "XLG1"
+    static constexpr uint32_t kTableMagic{0x31524c58}; // "XLR1"
+    static constexpr uint32_t kEndMagic{0x31444c58};   // "XLD1"
+    static constexpr uint32_t kVersion{1};
+
+    enum ChunkCodec : uint8_t
+    {
+        kChunkStored = 0,
+        kChunkDeflate = 1
+    };
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct Trailer
+    {
+        uint64_t tableOffset;
+        uint32_t rowGroups;
+        uint32_t magic;
+    };
+
+    static_assert(sizeof(ColumnarLog::RowGroup) == 96,
+                  "The row group is a part of the file format");
+    static_assert(sizeof(Trailer) == 16,
+                  "The trailer is a part of the file format");
+
+    static void putVarint(std::string &buf, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            buf += static_cast<char>((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        buf += static_cast<char>(v);
+    }
+
+    static bool getVarint(const char *&p, const char *end, uint64_t &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            auto byte = static_cast<uint8_t>(*p++);
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static uint64_t zigzag(int64_t v)
+    {
+        return (static_cast<uint64_t>(v) << 1) ^
+               static_cast<uint64_t>(v >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t v)
+    {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    /**
+     * @brief Dictionary encode a column: the distinct values in the order
+     * of their first row, then the index of every row.
+     *
+     */
+    template <typename T, typename Put>
+    static void encodeDictionary(std::string &buf,
+                                 const std::vector<ColumnarLog::Record> &rows,
+                                 T ColumnarLog::Record::*member,
+                                 Put put)
+    {
+        std::unordered_map<T, uint64_t> ids;
+        std::vector<const T *> values;
+        std::string indexes;
+        for (auto &row : rows)
+        {
+            auto it = ids.emplace(row.*member, values.size());
+            if (it.second)
+                values.push_back(&(row.*member));
+            putVarint(indexes, it.first->second);
+        }
+        putVarint(buf, values.size());
+        for (auto value : values)
+            put(buf, *value);
+        buf += indexes;
+    }
+
+    template <typename T, typename Get>
+    static bool decodeDictionary(const char *p,
+                                 const char *end,
+                                 size_t rows,
+                                 std::vector<T> &column,
+                                 Get get)
+    {
+        uint64_t count;
+        if (!getVarint(p, end, count) ||
+            count > static_cast<uint64_t>(end - p))
+            return false;
+        std::vector<T> values(static_cast<size_t>(count));
+        for (auto &value : values)
+        {
+            if (!get(p, end, value))
+                return false;
+        }
+        column.resize(rows);
+        for (auto &value : column)
+        {
+            uint64_t id;
+            if (!getVarint(p, end, id) || id >= count)
+                return false;
+            value = values[static_cast<size_t>(id)];
+        }
+        return true;
+    }
+
+    static void putString(std::string &buf, const std::string &str)
+    {
+        putVarint(buf, str.size());
+        buf += str;
+    }
+
+    static bool getString(const char *&p, const char *end, std::string &str)
+    {
+        uint64_t len;
+        if (!getVarint(p, end, len) || len > static_cast<uint64_t>(end - p))
+            return false;
+        str.assign(p, static_cast<size_t>(len));
+        p += len;
+        return true;
+    }
+
+    static void encodeColumn(std::string &buf,
+                             const std::vector<ColumnarLog::Record> &rows,
+                             int column)
+    {
+        switch (column)
+        {
+            case ColumnarLog::kTime:
+            {
+                int64_t last = 0;
+                for (auto &row : rows)
+                {
+                    putVarint(buf, zigzag(row.time - last));
+                    last = row.time;
+                }
+                break;
+            }
+            case ColumnarLog::kLevel:
+                // Runs of (level, count)
+                for (size_t i = 0; i < rows.size();)
+                {
+                    size_t j = i + 1;
+                    while (j < rows.size() && rows[j].level == rows[i].level)
+                        ++j;
+                    buf += static_cast<char>(rows[i].level);
+                    putVarint(buf, j - i);
+                    i = j;
+                }
+                break;
+            case ColumnarLog::kTid:
+                encodeDictionary(buf,
+                                 rows,
+                                 &ColumnarLog::Record::tid,
+                                 [](std::string &b, uint64_t v) {
+                                     putVarint(b, v);
+                                 });
+                break;
+            case ColumnarLog::kFile:
+                encodeDictionary(buf,
+                                 rows,
+                                 &ColumnarLog::Record::file,
+                                 putString);
+                break;
+            case ColumnarLog::kLine:
+                for (auto &row : rows)
+                    putVarint(buf, row.line);
+                break;
+            case ColumnarLog::kChannel:
+                encodeDictionary(buf,
+                                 rows,
+                                 &ColumnarLog::Record::channel,
+                                 [](std::string &b, int32_t v) {
+                                     putVarint(b, zigzag(v));
+                                 });
+                break;
+            case ColumnarLog::kMessage:
+                // The lengths first, so they compress well apart from the
+                // text.
+                for (auto &row : rows)
+                    putVarint(buf, row.message.size());
+                for (auto &row : rows)
+                    buf += row.message;
+                break;
+        }
+    }
+
+    static bool decodeColumn(const std::string &data,
+                             size_t rows,
+                             int column,
+                             ColumnarLogReader::Columns &columns)
+    {
+        auto p = data.data();
+        auto end = p + data.size();
+        uint64_t v;
+        switch (column)
+        {
+            case ColumnarLog::kTime:
+            {
+                columns.times.resize(rows);
+                int64_t last = 0;
+                for (auto &time : columns.times)
+                {
+                    if (!getVarint(p, end, v))
+                        return false;
+                    last += unzigzag(v);
+                    time = last;
+                }
+                return true;
+            }
+            case ColumnarLog::kLevel:
+                columns.levels.clear();
+                columns.levels.reserve(rows);
+                while (p < end)
+                {
+                    auto level = static_cast<uint8_t>(*p++);
+                    if (!getVarint(p, end, v) ||
+                        v > rows - columns.levels.size())
+                        return false;
+                    columns.levels.insert(columns.levels.end(),
+                                          static_cast<size_t>(v),
+                                          level);
+                }
+                return columns.levels.size() == rows;
+            case ColumnarLog::kTid:
+                return decodeDictionary(
+                    p,
+                    end,
+                    rows,
+                    columns.tids,
+                    [](const char *&q, const char *e, uint64_t &tid) {
+                        return getVarint(q, e, tid);
+                    });
+            case ColumnarLog::kFile:
+                return decodeDictionary(p, end, rows, columns.files, getString);
+            case ColumnarLog::kLine:
+                columns.lines.resize(rows);
+                for (auto &line : columns.lines)
+                {
+                    if (!getVarint(p, end, v))
+                        return false;
+                    line = static_cast<uint32_t>(v);
+                }
+                return true;
+            case ColumnarLog::kChannel:
+                return decodeDictionary(
+                    p,
+                    end,
+                    rows,
+                    columns.channels,
+                    [](const char *&q, const char *e, int32_t &channel) {
+                        uint64_t u;
+                        if (!getVarint(q, e, u))
+                            return false;
+                        channel = static_cast<int32_t>(unzigzag(u));
+                        return true;
+                    });
+            case ColumnarLog::kMessage:
+            {
+                columns.messages.resize(rows);
+                std::vector<uint64_t> lengths(rows);
+                uint64_t total = 0;
+                for (auto &len : lengths)
+                {
+                    if (!getVarint(p, end, len))
+                        return false;
+                    total += len;
+                }
+                if (total != static_cast<uint64_t>(end - p))
+                    return false;
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    columns.messages[i].assign(p,
+                                               static_cast<size_t>(lengths[i]));
+                    p += lengths[i];
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief A chunk is a codec byte and the raw length, followed by the
+     * stored or the deflated column.
+     *
+     */
+    static void compressChunk(const std::string &raw, std::string &chunk)
+    {
+        chunk.clear();
+#ifdef XIAOLOG_ZLIB_SUPPORT
+        uLongf bound = compressBound(static_cast<uLong>(raw.size()));
+        std::string compressed(bound, '\0');
+        if (compress2(reinterpret_cast<Bytef *>(&compressed[0]),
+                      &bound,
+                      reinterpret_cast<const Bytef *>(raw.data()),
+                      static_cast<uLong>(raw.size()),
+                      Z_BEST_SPEED) == Z_OK &&
+            bound < raw.size())
+        {
+            chunk += static_cast<char>(kChunkDeflate);
+            putVarint(chunk, raw.size());
+            chunk.append(compressed.data(), bound);
+            return;
+        }
+#endif
+        chunk += static_cast<char>(kChunkStored);
+        putVarint(chunk, raw.size());
+        chunk += raw;
+    }
+
+    static bool decompressChunk(const std::string &chunk, std::string &raw)
+    {
+        if (chunk.empty())
+            return false;
+        auto p = chunk.data() + 1;
+        auto end = chunk.data() + chunk.size();
+        uint64_t rawLen;
+        if (!getVarint(p, end, rawLen))
+            return false;
+        switch (static_cast<uint8_t>(chunk[0]))
+        {
+            case kChunkStored:
+                if (rawLen != static_cast<uint64_t>(end - p))
+                    return false;
+                raw.assign(p, end);
+                return true;
+#ifdef XIAOLOG_ZLIB_SUPPORT
+            case kChunkDeflate:
+            {
+                raw.resize(static_cast<size_t>(rawLen));
+                uLongf len = static_cast<uLongf>(rawLen);
+                return uncompress(reinterpret_cast<Bytef *>(&raw[0]),
+                                  &len,
+                                  reinterpret_cast<const Bytef *>(p),
+                                  static_cast<uLong>(end - p)) == Z_OK &&
+                       len == rawLen;
+            }
+#endif
+            default:
+                return false;
+        }
+    }
+
+    static uint64_t groupEnd(const ColumnarLog::RowGroup &group)
+    {
+        uint64_t end = group.offset + sizeof(kGroupMagic) + sizeof(group);
+        for (auto len : group.columnLengths)
+            end += len;
+        return end;
+    }
+
+    /**
+     * @brief Load the row groups from the table at the end of a file, or by
+     * walking the group headers if the file wasn't closed.
+     *
+     * @return The end of the last complete row group, 0 if the file isn't a
+     * columnar log.
+     */
+    static uint64_t loadRowGroups(FILE *fp,
+                                  std::vector<ColumnarLog::RowGroup> &groups,
+                                  bool &complete)
+    {
+        groups.clear();
+        complete = false;
+        FileHeader header;
+        if (fseek(fp, 0, SEEK_SET) != 0 ||
+            fread(&header, sizeof(header), 1, fp) != 1 ||
+            header.magic != kFileMagic || header.version != kVersion)
+            return 0;
+        Trailer trailer;
+        if (fseek(fp, -static_cast<long>(sizeof(trailer)), SEEK_END) == 0 &&
+            fread(&trailer, sizeof(trailer), 1, fp) == 1 &&
+            trailer.magic == kEndMagic)
+        {
+            uint32_t magic;
+            groups.resize(trailer.rowGroups);
+            if (fseek(fp, static_cast<long>(trailer.tableOffset), SEEK_SET) ==
+                    0 &&
+                fread(&magic, sizeof(magic), 1, fp) == 1 &&
+                magic == kTableMagic &&
+                (groups.empty() ||
+                 fread(groups.data(),
+                       sizeof(ColumnarLog::RowGroup),
+                       groups.size(),
+                       fp) == groups.size()))
+            {
+                complete = true;
+                return trailer.tableOffset;
+            }
+            groups.clear();
+        }
+        if (fseek(fp, 0, SEEK_END) != 0)
+            return 0;
+        auto fileSize = static_cast<uint64_t>(ftell(fp));
+        uint64_t offset = sizeof(header);
+        for (;;)
+        {
+            uint32_t magic;
+            ColumnarLog::RowGroup group;
+            if (fseek(fp, static_cast<long>(offset), SEEK_SET) != 0 ||
+                fread(&magic, sizeof(magic), 1, fp) != 1 ||
+                magic != kGroupMagic ||
+                fread(&group, sizeof(group), 1, fp) != 1 ||
+                group.offset != offset)
+                break;
+            auto end = groupEnd(group);
+            if (end > fileSize)
+                break;
+            groups.push_back(group);
+            offset = end;
+        }
+        return offset;
+    }
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+constexpr unsigned ColumnarLog::kAllColumns;
+constexpr uint8_t ColumnarLog::kNoLevel;
+
+bool ColumnarLog::parseRecord(const char *msg,
+                              size_t len,
+                              LogLineParser &parser,
+                              Record &record)
+{
+    if (len > 0 && msg[len - 1] == '\n')
+        --len;
+    uint64_t seq, recordLen;
+    if (len > AsyncFileLogger::kRecordHeaderLength &&
+        ShardedFileLogger::parseRecordHeader(msg, seq, recordLen))
+    {
+        msg += AsyncFileLogger::kRecordHeaderLength;
+        len -= AsyncFileLogger::kRecordHeaderLength;
+    }
+    int level;
+    if (!parser.parse(msg, len, record.time, level))
+    {
+        record.level = kNoLevel;
+        record.tid = 0;
+        record.line = 0;
+        record.message.assign(msg, len);
+        return false;
+    }
+    record.level = level < 0 ? kNoLevel : static_cast<uint8_t>(level);
+    size_t pos = len >= 29 && memcmp(msg + 24, " UTC ", 5) == 0 ? 29 : 25;
+    record.tid = 0;
+    while (pos < len && msg[pos] >= '0' && msg[pos] <= '9')
+        record.tid = record.tid * 10 + static_cast<uint64_t>(msg[pos++] - '0');
+    if (level >= 0)
+        pos += 7;
+    else if (pos < len && msg[pos] == ' ')
+        ++pos;
+    // The " - file:line" suffix, if the record has one.
+    size_t end = len;
+    record.file.clear();
+    record.line = 0;
+    size_t colon = len;
+    while (colon > pos && msg[colon - 1] >= '0' && msg[colon - 1] <= '9')
+        --colon;
+    if (colon < len && colon > pos && msg[colon - 1] == ':')
+    {
+        --colon;
+        for (size_t dash = colon; dash >= pos + 3; --dash)
+        {
+            if (memcmp(msg + dash - 3, " - ", 3) == 0)
+            {
+                record.file.assign(msg + dash, colon - dash);
+                record.line = static_cast<uint32_t>(
+                    strtoul(std::string(msg + colon + 1, len - colon - 1)
+                                .c_str(),
+                            nullptr,
+                            10));
+                end = dash - 3;
+                break;
+            }
+        }
+    }
+    record.message.assign(msg + pos, end > pos ? end - pos : 0);
+    return true;
+}
+
+ColumnarLogWriter::~ColumnarLogWriter()
+{
+    close();
+}
+
+bool ColumnarLogWriter::open(const std::string &fileName)
+{
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    fp_ = fopen(fileName.c_str(), "r+b");
+    if (fp_)
+    {
+        // Append to the row groups of the file.
+        bool complete;
+        offset_ = loadRowGroups(fp_, rowGroups_, complete);
+        if (offset_ > 0)
+        {
+            fflush(fp_);
+#ifndef _WIN32
+            if (ftruncate(fileno(fp_), static_cast<off_t>(offset_)) != 0)
+#else
+            if (_chsize_s(_fileno(fp_), static_cast<__int64>(offset_)) != 0)
+#endif
+            {
+                fprintf(stderr,
+                        "Failed to truncate %s: %s\n",
+                        fileName.c_str(),
+                        strerror_tl(errno));
+                fclose(fp_);
+                fp_ = nullptr;
+                return false;
+            }
+            fseek(fp_, static_cast<long>(offset_), SEEK_SET);
+            if (!rowGroups_.empty())
+                lastTime_ = rowGroups_.back().maxTime;
+            return true;
+        }
+        fclose(fp_);
+    }
+    fp_ = fopen(fileName.c_str(), "w+b");
+    if (!fp_)
+    {
+        fprintf(stderr,
+                "Failed to open %s: %s\n",
+                fileName.c_str(),
+                strerror_tl(errno));
+        return false;
+    }
+    FileHeader header{kFileMagic, kVersion};
+    fwrite(&header, sizeof(header), 1, fp_);
+    offset_ = sizeof(header);
+    rowGroups_.clear();
+    return true;
+}
+
+void ColumnarLogWriter::startLogging()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (threadPtr_ || !fp_)
+        return;
+    threadPtr_.reset(new std::thread([this]() { encoderThreadFunc(); }));
+}
+
+void ColumnarLogWriter::append(const ColumnarLog::Record &record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    appendLocked(record);
+}
+
+void ColumnarLogWriter::output(const char *msg,
+                               const uint64_t len,
+                               int channel)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ColumnarLog::parseRecord(msg,
+                                  static_cast<size_t>(len),
+                                  parser_,
+                                  parsed_))
+    {
+        // A record of RawLogger, it takes the time of the last one.
+        parsed_.time =
+            lastTime_ ? lastTime_ : Date::now().microSecondsSinceEpoch();
+        parsed_.file.clear();
+    }
+    parsed_.channel = channel;
+    appendLocked(parsed_);
+}
+
+void ColumnarLogWriter::output(const LogRecord &record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (record.level < 0)
+    {
+        // A record of RawLogger, it takes the time of the last one.
+        parsed_.time =
+            lastTime_ ? lastTime_ : Date::now().microSecondsSinceEpoch();
+        parsed_.level = ColumnarLog::kNoLevel;
+        parsed_.file.clear();
+        parsed_.line = 0;
+    }
+    else
+    {
+        parsed_.time = record.date.microSecondsSinceEpoch();
+        parsed_.level = static_cast<uint8_t>(record.level);
+        if (record.sourceFile.data_)
+            parsed_.file.assign(record.sourceFile.data_,
+                                static_cast<size_t>(record.sourceFile.size_));
+        else
+            parsed_.file.clear();
+        parsed_.line = static_cast<uint32_t>(record.line);
+    }
+    parsed_.tid = record.threadId;
+    parsed_.channel = record.channel;
+    size_t len = record.bodyLength;
+    if (len > 0 && record.body()[len - 1] == '\n')
+        --len;
+    parsed_.message.assign(record.body(), len);
+    appendLocked(parsed_);
+}
+
+void ColumnarLogWriter::appendLocked(const ColumnarLog::Record &record)
+{
+    if (!fp_)
+        return;
+    if (rows_.empty())
+    {
+        rowsStart_ = std::chrono::steady_clock::now();
+        // The encoder thread seals the group after the interval.
+        if (threadPtr_)
+            cond_.notify_one();
+    }
+    rows_.push_back(record);
+    lastTime_ = record.time;
+    if (rows_.size() >= rowGroupSize_)
+        sealRows();
+}
+
+void ColumnarLogWriter::sealRows()
+{
+    if (rows_.empty())
+        return;
+    if (!threadPtr_)
+    {
+        writeRowGroup(rows_);
+        return;
+    }
+    pendingGroups_.push_back(std::move(rows_));
+    rows_.clear();
+    cond_.notify_one();
+}
+
+void ColumnarLogWriter::encoderThreadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "ColumnarLog");
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        if (!rows_.empty() &&
+            std::chrono::steady_clock::now() >= rowsStart_ + rowGroupInterval_)
+            sealRows();
+        if (pendingGroups_.empty() && !flushRequested_)
+        {
+            if (stopFlag_)
+                break;
+            if (rows_.empty())
+                cond_.wait(lock);
+            else
+                cond_.wait_until(lock, rowsStart_ + rowGroupInterval_);
+            continue;
+        }
+        std::vector<Rows> groups;
+        groups.swap(pendingGroups_);
+        bool flush = flushRequested_;
+        flushRequested_ = false;
+        // The producers only wait for the mutex while the groups are
+        // handed over, not while they are encoded.
+        lock.unlock();
+        for (auto &rows : groups)
+            writeRowGroup(rows);
+        if (flush)
+            fflush(fp_);
+        lock.lock();
+    }
+}
+
+void ColumnarLogWriter::writeRowGroup(Rows &rows)
+{
+    if (rows.empty())
+        return;
+    ColumnarLog::RowGroup group;
+    memset(&group, 0, sizeof(group));
+    group.offset = offset_;
+    group.rows = static_cast<uint32_t>(rows.size());
+    auto &first = rows.front();
+    group.minTime = group.maxTime = first.time;
+    group.minTid = group.maxTid = first.tid;
+    group.minLine = group.maxLine = first.line;
+    group.minChannel = group.maxChannel = first.channel;
+    group.minLevel = group.maxLevel = first.level;
+    for (auto &row : rows)
+    {
+        group.minTime = (std::min)(group.minTime, row.time);
+        group.maxTime = (std::max)(group.maxTime, row.time);
+        group.minTid = (std::min)(group.minTid, row.tid);
+        group.maxTid = (std::max)(group.maxTid, row.tid);
+        group.minLine = (std::min)(group.minLine, row.line);
+        group.maxLine = (std::max)(group.maxLine, row.line);
+        group.minChannel = (std::min)(group.minChannel, row.channel);
+        group.maxChannel = (std::max)(group.maxChannel, row.channel);
+        group.minLevel = (std::min)(group.minLevel, row.level);
+        group.maxLevel = (std::max)(group.maxLevel, row.level);
+    }
+    std::string chunks;
+    std::string raw;
+    std::string chunk;
+    for (int i = 0; i < ColumnarLog::kNumberOfColumns; ++i)
+    {
+        raw.clear();
+        encodeColumn(raw, rows, i);
+        compressChunk(raw, chunk);
+        group.columnLengths[i] = static_cast<uint32_t>(chunk.size());
+        chunks += chunk;
+    }
+    rows.clear();
+    if (fwrite(&kGroupMagic, sizeof(kGroupMagic), 1, fp_) != 1 ||
+        fwrite(&group, sizeof(group), 1, fp_) != 1 ||
+        fwrite(chunks.data(), 1, chunks.size(), fp_) != chunks.size())
+    {
+        fprintf(stderr,
+                "Failed to write a row group: %s\n",
+                strerror_tl(errno));
+        // Write the next group over the partial one.
+        fseek(fp_, static_cast<long>(offset_), SEEK_SET);
+        return;
+    }
+    offset_ = groupEnd(group);
+    rowGroups_.push_back(group);
+}
+
+void ColumnarLogWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!fp_)
+        return;
+    if (threadPtr_)
+    {
+        // Called after every error, it doesn't cut the open group short.
+        flushRequested_ = true;
+        cond_.notify_one();
+    }
+    else
+    {
+        fflush(fp_);
+    }
+}
+
+void ColumnarLogWriter::close()
+{
+    if (threadPtr_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopFlag_ = true;
+        }
+        cond_.notify_all();
+        threadPtr_->join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (threadPtr_)
+    {
+        threadPtr_.reset();
+        stopFlag_ = false;
+        // The groups sealed after the thread stopped.
+        for (auto &rows : pendingGroups_)
+            writeRowGroup(rows);
+        pendingGroups_.clear();
+    }
+    if (!fp_)
+        return;
+    sealRows();
+    Trailer trailer{offset_,
+                    static_cast<uint32_t>(rowGroups_.size()),
+                    kEndMagic};
+    fwrite(&kTableMagic, sizeof(kTableMagic), 1, fp_);
+    if (!rowGroups_.empty())
+        fwrite(rowGroups_.data(),
+               sizeof(ColumnarLog::RowGroup),
+               rowGroups_.size(),
+               fp_);
+    fwrite(&trailer, sizeof(trailer), 1, fp_);
+    fclose(fp_);
+    fp_ = nullptr;
+    rowGroups_.clear();
+    lastTime_ = 0;
+}
+
+ColumnarLogReader::~ColumnarLogReader()
+{
+    close();
+}
+
+bool ColumnarLogReader::open(const std::string &fileName)
+{
+    close();
+    fp_ = fopen(fileName.c_str(), "rb");
+    if (!fp_)
+        return false;
+    bool complete;
+    if (loadRowGroups(fp_, rowGroups_, complete) == 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ColumnarLogReader::close()
+{
+    if (fp_)
+    {
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+    rowGroups_.clear();
+}
+
+bool ColumnarLogReader::readChunk(uint64_t offset,
+                                  uint32_t length,
+                                  std::string &data)
+{
+    chunk_.resize(length);
+    return fseek(fp_, static_cast<long>(offset), SEEK_SET) == 0 &&
+           fread(&chunk_[0], 1, length, fp_) == length &&
+           decompressChunk(chunk_, data);
+}
+
+bool ColumnarLogReader::read(size_t index,
+                             Columns &columns,
+                             unsigned columnMask)
+{
+    if (!fp_ || index >= rowGroups_.size())
+        return false;
+    auto &group = rowGroups_[index];
+    columns = Columns();
+    uint64_t offset = group.offset + sizeof(kGroupMagic) + sizeof(group);
+    std::string data;
+    for (int i = 0; i < ColumnarLog::kNumberOfColumns; ++i)
+    {
+        if (columnMask & (1u << i))
+        {
+            if (!readChunk(offset, group.columnLengths[i], data) ||
+                !decodeColumn(data, group.rows, i, columns))
+                return false;
+        }
+        offset += group.columnLengths[i];
+    }
+    return true;
+}
@@ -0,0 +1,298 @@
+/**
+ * @file ConsoleLogger.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/ConsoleLogger.h>
+#ifndef _WIN32
+#include <xiaoLog/Logger.h>
+#include <unistd.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace xiaoLog
+{
+    extern const char *strerror_tl(int savedErrno);
+
+    static constexpr size_t kBufferSize{64 * 1024};
+    // Buffers kept for reuse by the producers.
+    static constexpr size_t kSpareBuffers{2};
+#ifdef IOV_MAX
+    static constexpr size_t kMaxIovecs{IOV_MAX};
+#else
+    static constexpr size_t kMaxIovecs{1024};
+#endif
+    static constexpr const char *kLevelColors[Logger::kNumberOfLogLevels] = {
+        "\033[90m",    // TRACE, grey
+        "\033[36m",    // DEBUG, cyan
+        "\033[32m",    // INFO, green
+        "\033[33m",    // WARN, yellow
+        "\033[31m",    // ERROR, red
+        "\033[1;31m",  // FATAL, bold red
+    };
+
+    // The level tokens of the records wrapped in their color.
+    static const std::string &coloredLevel(int level)
+    {
+        static const std::vector<std::string> levels = []() {
+            std::vector<std::string> v;
+            for (int i = 0; i < Logger::kNumberOfLogLevels; ++i)
+                v.push_back(std::string(kLevelColors[i]) +
+                            Logger::levelString(
+                                static_cast<Logger::LogLevel>(i)) +
+                            "\033[0m");
+            return v;
+        }();
+        return levels[level];
+    }
+
+    static void appendTo(std::string &buf,
+                         const char *msg,
+                         size_t len,
+                         int level,
+                         size_t pos)
+    {
+        if (level < 0)
+        {
+            buf.append(msg, len);
+            return;
+        }
+        buf.append(msg, pos);
+        buf.append(coloredLevel(level));
+        buf.append(msg + pos + 7, len - pos - 7);
+    }
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+ConsoleLogger::ConsoleLogger(int fd)
+    : fd_(fd), colored_(isatty(fd) == 1), logBuffer_(new std::string)
+{
+    logBuffer_->reserve(kBufferSize);
+}
+
+ConsoleLogger::~ConsoleLogger()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopFlag_ = true;
+    }
+    if (threadPtr_)
+    {
+        cond_.notify_all();
+        threadPtr_->join();
+    }
+    writePending();
+}
+
+void ConsoleLogger::startLogging()
+{
+    threadPtr_.reset(new std::thread([this]() { logThreadFunc(); }));
+}
+
+void ConsoleLogger::output(const LogRecord &record)
+{
+    outputRecord(record.data,
+                 static_cast<size_t>(record.length),
+                 record.level,
+                 record.level < 0 ? 0 : record.levelOffset());
+}
+
+void ConsoleLogger::output(const char *msg, const uint64_t len)
+{
+    size_t pos = 0;
+    int level = Logger::parseLevel(msg, len, pos);
+    outputRecord(msg, static_cast<size_t>(len), level, pos);
+}
+
+void ConsoleLogger::outputRecord(const char *msg,
+                                 size_t len,
+                                 int level,
+                                 size_t pos)
+{
+    if (level == Logger::kFatal)
+    {
+        writePending(msg, len, level, pos);
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (pendingBytes_ + len > maxPendingBytes_)
+    {
+        ++lostCounter_;
+        droppedRecords_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (lostCounter_ > 0)
+    {
+        char logErr[128];
+        auto strlen =
+            snprintf(logErr,
+                     sizeof(logErr),
+                     "%llu log information is lost\n",
+                     static_cast<long long unsigned int>(lostCounter_));
+        lostCounter_ = 0;
+        appendRecord(logErr, static_cast<size_t>(strlen), -1, 0);
+    }
+    appendRecord(msg, len, colored_ ? level : -1, pos);
+    if (writerParked_)
+        cond_.notify_one();
+}
+
+void ConsoleLogger::flush()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (writerParked_ && !logBuffer_->empty())
+        cond_.notify_one();
+}
+
+void ConsoleLogger::appendRecord(const char *msg,
+                                 size_t len,
+                                 int level,
+                                 size_t pos)
+{
+    // The colors take 16 bytes at most.
+    if (!logBuffer_->empty() &&
+        logBuffer_->capacity() - logBuffer_->size() < len + 16)
+        swapBuffer();
+    size_t size = logBuffer_->size();
+    appendTo(*logBuffer_, msg, len, level, pos);
+    pendingBytes_ += logBuffer_->size() - size;
+}
+
+void ConsoleLogger::swapBuffer()
+{
+    pendingBuffers_.push_back(std::move(logBuffer_));
+    if (spareBuffers_.empty())
+    {
+        logBuffer_ = std::make_shared<std::string>();
+        logBuffer_->reserve(kBufferSize);
+    }
+    else
+    {
+        logBuffer_ = std::move(spareBuffers_.back());
+        spareBuffers_.pop_back();
+    }
+}
+
+void ConsoleLogger::logThreadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "ConsoleLogger");
+#endif
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Records queued while the console is written are taken with the
+            // next writev() call, a producer wakes the thread only if it's
+            // idle.
+            while (!stopFlag_ && pendingBuffers_.empty() &&
+                   logBuffer_->empty())
+            {
+                writerParked_ = true;
+                cond_.wait(lock);
+            }
+            writerParked_ = false;
+            if (stopFlag_)
+                break;
+        }
+        writePending();
+    }
+}
+
+void ConsoleLogger::writePending(const char *msg,
+                                 size_t len,
+                                 int level,
+                                 size_t pos)
+{
+    std::lock_guard<std::mutex> writeGuard(writeMutex_);
+    std::vector<StringPtr> buffers;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!logBuffer_->empty())
+            swapBuffer();
+        buffers.swap(pendingBuffers_);
+        pendingBytes_ = 0;
+    }
+    if (msg)
+    {
+        std::string record;
+        appendTo(record, msg, len, colored_ ? level : -1, pos);
+        writeBuffers(buffers, record.data(), record.size());
+    }
+    else if (!buffers.empty())
+    {
+        writeBuffers(buffers, nullptr, 0);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &buf : buffers)
+    {
+        if (spareBuffers_.size() >= kSpareBuffers)
+            break;
+        buf->clear();
+        spareBuffers_.push_back(std::move(buf));
+    }
+}
+
+void ConsoleLogger::writeBuffers(const std::vector<StringPtr> &buffers,
+                                 const char *msg,
+                                 size_t len)
+{
+    std::vector<struct iovec> iovs;
+    iovs.reserve(buffers.size() + 1);
+    for (auto &buf : buffers)
+    {
+        iovs.push_back({const_cast<char *>(buf->data()), buf->size()});
+    }
+    if (msg)
+        iovs.push_back({const_cast<char *>(msg), len});
+    size_t i = 0;
+    while (i < iovs.size())
+    {
+        int count = static_cast<int>((std::min)(iovs.size() - i, kMaxIovecs));
+        ssize_t n = writev(fd_, &iovs[i], count);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // The console was made non-blocking by someone else.
+                struct pollfd pfd;
+                pfd.fd = fd_;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            fprintf(stderr,
+                    "Failed to write to the console: %s\n",
+                    strerror_tl(errno));
+            return;
+        }
+        // Skip what was written, a partial write stops in any iovec.
+        auto written = static_cast<size_t>(n);
+        while (i < iovs.size() && written >= iovs[i].iov_len)
+        {
+            written -= iovs[i].iov_len;
+            ++i;
+        }
+        if (i < iovs.size())
+        {
+            iovs[i].iov_base = static_cast<char *>(iovs[i].iov_base) + written;
+            iovs[i].iov_len -= written;
+        }
+    }
+}
+#endif
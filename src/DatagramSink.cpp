@@ -0,0 +1,218 @@
+/**
+ * @file DatagramSink.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/DatagramSink.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace xiaoLog
+{
+    extern const char *strerror_tl(int savedErrno);
+
+    // The datagrams of one sendmmsg() call.
+    static constexpr size_t kBatchSize{64};
+
+    static int datagramSocket(int family)
+    {
+        int fd = socket(family, SOCK_DGRAM, 0);
+        if (fd >= 0)
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        return fd;
+    }
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+std::shared_ptr<DatagramSink> DatagramSink::openUnix(const std::string &path,
+                                                     size_t maxDatagramSize)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "The socket path %s is too long\n", path.c_str());
+        return nullptr;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.data(), path.size());
+    int fd = datagramSocket(AF_UNIX);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to create a socket: %s\n", strerror_tl(errno));
+        return nullptr;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) <
+        0)
+    {
+        fprintf(stderr,
+                "Failed to connect to %s: %s\n",
+                path.c_str(),
+                strerror_tl(errno));
+        ::close(fd);
+        return nullptr;
+    }
+    return std::shared_ptr<DatagramSink>(
+        new DatagramSink(fd, (std::max)(maxDatagramSize, size_t(1))));
+}
+
+std::shared_ptr<DatagramSink> DatagramSink::openUdp(const std::string &host,
+                                                    uint16_t port,
+                                                    size_t maxDatagramSize)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    struct addrinfo *result = nullptr;
+    auto service = std::to_string(port);
+    int err = getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
+    if (err != 0)
+    {
+        fprintf(stderr,
+                "Wrong address %s: %s\n",
+                host.c_str(),
+                gai_strerror(err));
+        return nullptr;
+    }
+    int fd = datagramSocket(result->ai_family);
+    if (fd < 0 || connect(fd, result->ai_addr, result->ai_addrlen) < 0)
+    {
+        fprintf(stderr,
+                "Failed to connect to %s:%u: %s\n",
+                host.c_str(),
+                port,
+                strerror_tl(errno));
+        if (fd >= 0)
+            ::close(fd);
+        freeaddrinfo(result);
+        return nullptr;
+    }
+    freeaddrinfo(result);
+    return std::shared_ptr<DatagramSink>(
+        new DatagramSink(fd, (std::max)(maxDatagramSize, size_t(1))));
+}
+
+DatagramSink::~DatagramSink()
+{
+    ::close(fd_);
+}
+
+void DatagramSink::write(const StringPtr &buf)
+{
+    const char *data[kBatchSize];
+    size_t lengths[kBatchSize];
+    size_t count = 0;
+    auto p = buf->data();
+    auto end = p + buf->size();
+    while (p < end)
+    {
+        size_t len =
+            (std::min)(static_cast<size_t>(end - p), maxDatagramSize_);
+        if (p + len < end)
+        {
+            // Cut after the last whole line which fits.
+            size_t cut = len;
+            while (cut > 0 && p[cut - 1] != '\n')
+                --cut;
+            if (cut > 0)
+                len = cut;
+        }
+        data[count] = p;
+        lengths[count] = len;
+        p += len;
+        if (++count == kBatchSize || p == end)
+        {
+            size_t sent = sendBatch(data, lengths, count);
+            if (sent < count)
+                drop(data + sent, lengths + sent, count - sent);
+            count = 0;
+        }
+    }
+}
+
+size_t DatagramSink::sendBatch(const char *const *data,
+                               const size_t *lengths,
+                               size_t count)
+{
+    size_t sent = 0;
+    while (sent < count)
+    {
+#ifdef __linux__
+        struct mmsghdr msgs[kBatchSize];
+        struct iovec iovs[kBatchSize];
+        memset(msgs, 0, sizeof(struct mmsghdr) * (count - sent));
+        for (size_t i = 0; i < count - sent; ++i)
+        {
+            iovs[i].iov_base = const_cast<char *>(data[sent + i]);
+            iovs[i].iov_len = lengths[sent + i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = sendmmsg(fd_,
+                         msgs,
+                         static_cast<unsigned int>(count - sent),
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+        int n = 0;
+        while (sent + static_cast<size_t>(n) < count &&
+               send(fd_,
+                    data[sent + n],
+                    lengths[sent + n],
+                    MSG_DONTWAIT | MSG_NOSIGNAL) >= 0)
+            ++n;
+        if (n == 0)
+            n = -1;
+#endif
+        if (n > 0)
+        {
+            sent += static_cast<size_t>(n);
+            sentDatagrams_.fetch_add(n, std::memory_order_relaxed);
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (blocking_ && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                          errno == ENOBUFS))
+        {
+            struct pollfd pfd;
+            pfd.fd = fd_;
+            pfd.events = POLLOUT;
+            if (poll(&pfd, 1, blockingTimeoutMs_) > 0)
+                continue;
+        }
+        // A full socket buffer, or no collector (ECONNREFUSED): the rest of
+        // the batch is dropped.
+        break;
+    }
+    return sent;
+}
+
+void DatagramSink::drop(const char *const *data,
+                        const size_t *lengths,
+                        size_t count)
+{
+    uint64_t records = 0;
+    for (size_t i = 0; i < count; ++i)
+        records += std::count(data[i], data[i] + lengths[i], '\n');
+    droppedDatagrams_.fetch_add(count, std::memory_order_relaxed);
+    droppedRecords_.fetch_add(records, std::memory_order_relaxed);
+}
+#endif
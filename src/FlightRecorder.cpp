@@ -0,0 +1,219 @@
+/**
+ * @file FlightRecorder.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/FlightRecorder.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <atomic>
+
+namespace xiaoLog
+{
+    static constexpr uint64_t kRecorderMagic{0x78696167466c7431ULL};
+    static constexpr size_t kRecorderHeaderSize{4096};
+    // Records start on 16 byte boundaries, so a record header never wraps.
+    static constexpr uint64_t kRecordAlign{16};
+    static constexpr uint32_t kCommitMagic{0x5eed1e57};
+
+    struct RecorderHeader
+    {
+        uint64_t magic;
+        uint64_t capacity;
+        std::atomic<uint64_t> cursor;
+    };
+
+    /**
+     * @brief The header of a record. The position is the absolute position
+     * the record was written at, the commit word is stored last, so a record
+     * whose header doesn't match its place is stale or incomplete.
+     *
+     */
+    struct RecordHeader
+    {
+        uint64_t pos;
+        uint32_t len;
+        std::atomic<uint32_t> commit;
+    };
+
+    static_assert(sizeof(RecordHeader) == kRecordAlign, "");
+    extern const char *strerror_tl(int savedErrno);
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+static uint32_t commitWord(uint64_t pos, uint32_t len)
+{
+    return kCommitMagic ^ static_cast<uint32_t>(pos) ^
+           static_cast<uint32_t>(pos >> 32) ^ len;
+}
+
+static uint64_t recordSize(uint64_t len)
+{
+    return (sizeof(RecordHeader) + len + kRecordAlign - 1) / kRecordAlign *
+           kRecordAlign;
+}
+
+std::shared_ptr<FlightRecorder> FlightRecorder::open(
+    const std::string &fileName,
+    size_t size)
+{
+    uint64_t capacity = std::max<uint64_t>(size, 64 * kRecordAlign);
+    capacity = (capacity + kRecordAlign - 1) / kRecordAlign * kRecordAlign;
+    size_t mapSize = kRecorderHeaderSize + capacity;
+    int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr,
+                "Failed to open the flight recorder: %s\n",
+                strerror_tl(errno));
+        return nullptr;
+    }
+    struct stat st;
+    bool reuse = fstat(fd, &st) == 0 &&
+                 static_cast<size_t>(st.st_size) == mapSize;
+    if (!reuse && (ftruncate(fd, 0) != 0 ||
+                   ftruncate(fd, static_cast<off_t>(mapSize)) != 0))
+    {
+        fprintf(stderr,
+                "Failed to size the flight recorder: %s\n",
+                strerror_tl(errno));
+        ::close(fd);
+        return nullptr;
+    }
+    int flags = MAP_SHARED;
+#ifdef __linux__
+    // Fault the pages in now, not in the middle of logging.
+    flags |= MAP_POPULATE;
+#endif
+    void *addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, flags, fd, 0);
+    // The mapping keeps the file.
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        fprintf(stderr,
+                "Failed to map the flight recorder: %s\n",
+                strerror_tl(errno));
+        return nullptr;
+    }
+    std::shared_ptr<FlightRecorder> recorder(new FlightRecorder);
+    recorder->base_ = static_cast<char *>(addr);
+    recorder->mapSize_ = mapSize;
+    recorder->capacity_ = capacity;
+    recorder->data_ = recorder->base_ + kRecorderHeaderSize;
+    auto header = reinterpret_cast<RecorderHeader *>(recorder->base_);
+    if (header->magic != kRecorderMagic || header->capacity != capacity)
+    {
+        memset(recorder->base_, 0, kRecorderHeaderSize);
+        header->capacity = capacity;
+        header->magic = kRecorderMagic;
+    }
+    return recorder;
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if (base_)
+        munmap(base_, mapSize_);
+}
+
+void FlightRecorder::record(const char *msg, uint64_t len)
+{
+    len = std::min<uint64_t>(len, capacity_ / 4);
+    uint64_t need = recordSize(len);
+    auto header = reinterpret_cast<RecorderHeader *>(base_);
+    uint64_t pos = header->cursor.fetch_add(need, std::memory_order_relaxed);
+    auto record = reinterpret_cast<RecordHeader *>(data_ + pos % capacity_);
+    // Invalidate the old record here first, the new header matches its place
+    // only when it's complete.
+    record->commit.store(0, std::memory_order_relaxed);
+    record->pos = pos;
+    record->len = static_cast<uint32_t>(len);
+    uint64_t offset = (pos + sizeof(RecordHeader)) % capacity_;
+    uint64_t first = std::min<uint64_t>(len, capacity_ - offset);
+    memcpy(data_ + offset, msg, first);
+    memcpy(data_, msg + first, len - first);
+    record->commit.store(commitWord(pos, static_cast<uint32_t>(len)),
+                         std::memory_order_release);
+}
+
+bool FlightRecorder::recover(
+    const std::string &fileName,
+    const std::function<void(const char *, uint64_t)> &func)
+{
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    RecorderHeader *header{nullptr};
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 &&
+        static_cast<size_t>(st.st_size) > kRecorderHeaderSize)
+    {
+        addr = mmap(nullptr,
+                    static_cast<size_t>(st.st_size),
+                    PROT_READ,
+                    MAP_SHARED,
+                    fd,
+                    0);
+    }
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    auto base = static_cast<const char *>(addr);
+    header = reinterpret_cast<RecorderHeader *>(addr);
+    uint64_t capacity = header->capacity;
+    if (header->magic != kRecorderMagic ||
+        kRecorderHeaderSize + capacity != static_cast<uint64_t>(st.st_size))
+    {
+        munmap(addr, static_cast<size_t>(st.st_size));
+        return false;
+    }
+    auto data = base + kRecorderHeaderSize;
+    uint64_t cursor = header->cursor.load(std::memory_order_acquire);
+    uint64_t pos = cursor > capacity ? cursor - capacity : 0;
+    pos = (pos + kRecordAlign - 1) / kRecordAlign * kRecordAlign;
+    std::string record;
+    while (pos < cursor)
+    {
+        auto recordHeader =
+            reinterpret_cast<const RecordHeader *>(data + pos % capacity);
+        uint32_t len = recordHeader->len;
+        uint64_t need = recordSize(len);
+        if (recordHeader->pos != pos ||
+            recordHeader->commit.load(std::memory_order_acquire) !=
+                commitWord(pos, len) ||
+            pos + need > cursor)
+        {
+            // Not the start of a complete record, look further.
+            pos += kRecordAlign;
+            continue;
+        }
+        uint64_t offset = (pos + sizeof(RecordHeader)) % capacity;
+        if (offset + len <= capacity)
+        {
+            func(data + offset, len);
+        }
+        else
+        {
+            record.assign(data + offset, capacity - offset);
+            record.append(data, len - (capacity - offset));
+            func(record.data(), len);
+        }
+        pos += need;
+    }
+    munmap(addr, static_cast<size_t>(st.st_size));
+    return true;
+}
+#endif
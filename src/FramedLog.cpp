@@ -0,0 +1,596 @@
+/**
+ * @file FramedLog.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/FramedLog.h>
+#include "LogFileWriter.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace xiaoLog
+{
+    static constexpr uint32_t kFrameMagic{0x31464c58};  // "XLF1"
+    static constexpr uint32_t kTableMagic{0x31544c58};  // "XLT1"
+    static constexpr uint32_t kFooterMagic{0x31454c58}; // "XLE1"
+
+    enum FrameCodec : uint8_t
+    {
+        kCodecStored = 0,
+        kCodecDeflate = 1,
+        kCodecDictionary = 2
+    };
+
+    struct FrameHeader
+    {
+        uint32_t magic;
+        uint8_t codec;
+        uint8_t reserved[3];
+        uint32_t dictId;
+        uint32_t compressedLen;
+        uint32_t rawLen;
+    };
+
+    /**
+     * @brief The seek table is followed by the frames, then the dictionaries
+     * of the file.
+     *
+     */
+    struct TableHeader
+    {
+        uint32_t magic;
+        uint32_t frameCount;
+        uint32_t dictCount;
+        uint32_t reserved;
+    };
+
+    struct Footer
+    {
+        uint64_t tableOffset;
+        uint64_t rawSize;
+        uint32_t magic;
+        uint32_t reserved;
+    };
+
+    struct FramedIndex
+    {
+        std::vector<FramedLogReader::Frame> frames;
+        std::vector<FramedDictionary> dictionaries;
+        uint64_t rawSize{0};
+        // The end of the last complete frame.
+        uint64_t end{0};
+    };
+
+    static_assert(sizeof(FrameHeader) == 20, "");
+    static_assert(sizeof(FramedLogReader::Frame) == 16, "");
+    static_assert(sizeof(FramedDictionary) == 16, "");
+    extern const char *strerror_tl(int savedErrno);
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+static bool readAt(int fd, void *buf, size_t len, uint64_t offset)
+{
+    auto data = static_cast<char *>(buf);
+    while (len > 0)
+    {
+#ifndef _WIN32
+        auto n = ::pread(fd, data, len, static_cast<off_t>(offset));
+#else
+        _lseeki64(fd, static_cast<__int64>(offset), SEEK_SET);
+        auto n = _read(fd, data, static_cast<unsigned>(len));
+#endif
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+static int openForRead(const std::string &fileName)
+{
+#ifndef _WIN32
+    return ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+#else
+    return _open(fileName.c_str(), _O_RDONLY | _O_BINARY);
+#endif
+}
+
+static void closeFd(int fd)
+{
+#ifndef _WIN32
+    ::close(fd);
+#else
+    _close(fd);
+#endif
+}
+
+static uint64_t fileSizeOf(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return 0;
+    return static_cast<uint64_t>(st.st_size);
+}
+
+static bool loadTable(int fd, uint64_t fileSize, FramedIndex &index)
+{
+    Footer footer;
+    TableHeader table;
+    if (fileSize < sizeof(TableHeader) + sizeof(Footer) ||
+        !readAt(fd, &footer, sizeof(footer), fileSize - sizeof(footer)) ||
+        footer.magic != kFooterMagic ||
+        footer.tableOffset > fileSize - sizeof(TableHeader) - sizeof(Footer) ||
+        !readAt(fd, &table, sizeof(table), footer.tableOffset) ||
+        table.magic != kTableMagic ||
+        footer.tableOffset + sizeof(TableHeader) +
+                (static_cast<uint64_t>(table.frameCount) + table.dictCount) *
+                    16 +
+                sizeof(Footer) !=
+            fileSize)
+        return false;
+    index.frames.resize(table.frameCount);
+    index.dictionaries.resize(table.dictCount);
+    uint64_t pos = footer.tableOffset + sizeof(table);
+    if ((table.frameCount > 0 &&
+         !readAt(fd,
+                 index.frames.data(),
+                 table.frameCount * sizeof(FramedLogReader::Frame),
+                 pos)) ||
+        (table.dictCount > 0 &&
+         !readAt(fd,
+                 index.dictionaries.data(),
+                 table.dictCount * sizeof(FramedDictionary),
+                 pos + table.frameCount * sizeof(FramedLogReader::Frame))))
+        return false;
+    index.rawSize = footer.rawSize;
+    index.end = footer.tableOffset;
+    return true;
+}
+
+/**
+ * @brief Load the seek table, or rebuild it from the frame headers if the
+ * file wasn't closed.
+ *
+ * @return false if the file isn't framed.
+ */
+static bool loadIndex(int fd, uint64_t fileSize, FramedIndex &index)
+{
+    index = FramedIndex();
+    if (loadTable(fd, fileSize, index))
+        return true;
+    index = FramedIndex();
+    uint64_t pos = 0;
+    FrameHeader header;
+    while (pos + sizeof(header) <= fileSize &&
+           readAt(fd, &header, sizeof(header), pos) &&
+           header.magic == kFrameMagic &&
+           pos + sizeof(header) + header.compressedLen <= fileSize)
+    {
+        if (header.codec == kCodecDictionary)
+        {
+            index.dictionaries.push_back({pos, header.dictId, 0});
+        }
+        else
+        {
+            index.frames.push_back({pos, index.rawSize});
+            index.rawSize += header.rawLen;
+        }
+        pos += sizeof(header) + header.compressedLen;
+    }
+    index.end = pos;
+    if (pos > 0 || fileSize == 0)
+        return true;
+    // No complete frame, a file which starts like one had its first frame
+    // cut by a crash and is empty.
+    uint32_t magic{0};
+    auto len =
+        static_cast<size_t>((std::min)(uint64_t(sizeof(magic)), fileSize));
+    return readAt(fd, &magic, len, 0) && memcmp(&magic, &kFrameMagic, len) == 0;
+}
+
+bool FramedLog::isFramed(const std::string &fileName)
+{
+    int fd = openForRead(fileName);
+    if (fd < 0)
+        return false;
+    uint32_t magic{0};
+    bool framed = readAt(fd, &magic, sizeof(magic), 0) && magic == kFrameMagic;
+    closeFd(fd);
+    return framed;
+}
+
+std::string FramedLog::trainDictionary(const std::string &samples, size_t size)
+{
+    // Words keep the separator after them, so the strings look like logs.
+    std::unordered_map<std::string, uint64_t> counts;
+    size_t pos = 0;
+    while (pos < samples.size())
+    {
+        size_t end = samples.find_first_of(" \n", pos);
+        end = end == std::string::npos ? samples.size() : end + 1;
+        if (end - pos >= 4 && end - pos <= 64)
+            ++counts[samples.substr(pos, end - pos)];
+        pos = end;
+    }
+    std::vector<std::pair<uint64_t, const std::string *>> words;
+    for (auto &count : counts)
+    {
+        if (count.second >= 2)
+            words.emplace_back(count.second * count.first.size(),
+                               &count.first);
+    }
+    std::sort(words.begin(),
+              words.end(),
+              [](const std::pair<uint64_t, const std::string *> &a,
+                 const std::pair<uint64_t, const std::string *> &b) {
+                  return a.first != b.first ? a.first > b.first
+                                            : *a.second < *b.second;
+              });
+    std::vector<const std::string *> chosen;
+    size_t total = 0;
+    for (auto &word : words)
+    {
+        if (total + word.second->size() > size)
+            continue;
+        chosen.push_back(word.second);
+        total += word.second->size();
+    }
+    std::string dictionary;
+    dictionary.reserve(total);
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        dictionary += **it;
+    return dictionary;
+}
+
+FramedLogReader::~FramedLogReader()
+{
+    close();
+}
+
+bool FramedLogReader::open(const std::string &fileName)
+{
+    close();
+    fd_ = openForRead(fileName);
+    if (fd_ < 0)
+        return false;
+    fileSize_ = fileSizeOf(fd_);
+    FramedIndex index;
+    if (!loadIndex(fd_, fileSize_, index))
+    {
+        close();
+        return false;
+    }
+    frames_ = std::move(index.frames);
+    rawSize_ = index.rawSize;
+    for (auto &entry : index.dictionaries)
+    {
+        FrameHeader header;
+        std::string dictionary;
+        if (!readAt(fd_, &header, sizeof(header), entry.fileOffset))
+            continue;
+        dictionary.resize(header.compressedLen);
+        if (readAt(fd_,
+                   &dictionary[0],
+                   dictionary.size(),
+                   entry.fileOffset + sizeof(header)))
+            dictionaries_[header.dictId] = std::move(dictionary);
+    }
+    return true;
+}
+
+void FramedLogReader::close()
+{
+    if (fd_ >= 0)
+    {
+        closeFd(fd_);
+        fd_ = -1;
+    }
+    frames_.clear();
+    dictionaries_.clear();
+    fileSize_ = 0;
+    rawSize_ = 0;
+    cachedFrame_ = SIZE_MAX;
+    cache_.clear();
+}
+
+bool FramedLogReader::readFrame(size_t index, std::string &data)
+{
+    if (index >= frames_.size())
+        return false;
+    FrameHeader header;
+    uint64_t offset = frames_[index].fileOffset;
+    if (!readAt(fd_, &header, sizeof(header), offset) ||
+        header.magic != kFrameMagic)
+        return false;
+    compressed_.resize(header.compressedLen);
+    if (header.compressedLen > 0 &&
+        !readAt(fd_, &compressed_[0], compressed_.size(), offset + sizeof(header)))
+        return false;
+    if (header.codec == kCodecStored)
+    {
+        data = compressed_;
+        return true;
+    }
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    if (header.codec != kCodecDeflate)
+        return false;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return false;
+    bool ok = true;
+    if (header.dictId != 0)
+    {
+        auto it = dictionaries_.find(header.dictId);
+        ok = it != dictionaries_.end() &&
+             inflateSetDictionary(
+                 &stream,
+                 reinterpret_cast<const Bytef *>(it->second.data()),
+                 static_cast<uInt>(it->second.size())) == Z_OK;
+    }
+    data.resize(header.rawLen);
+    if (ok)
+    {
+        stream.next_in = reinterpret_cast<Bytef *>(&compressed_[0]);
+        stream.avail_in = header.compressedLen;
+        stream.next_out = reinterpret_cast<Bytef *>(&data[0]);
+        stream.avail_out = header.rawLen;
+        ok = inflate(&stream, Z_FINISH) == Z_STREAM_END &&
+             stream.total_out == header.rawLen;
+    }
+    inflateEnd(&stream);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+size_t FramedLogReader::pread(char *buf, size_t len, uint64_t rawOffset)
+{
+    size_t done = 0;
+    while (done < len && rawOffset < rawSize_)
+    {
+        auto it = std::upper_bound(frames_.begin(),
+                                   frames_.end(),
+                                   rawOffset,
+                                   [](uint64_t offset, const Frame &frame) {
+                                       return offset < frame.rawOffset;
+                                   });
+        if (it == frames_.begin())
+            break;
+        size_t index = static_cast<size_t>(it - frames_.begin()) - 1;
+        if (cachedFrame_ != index)
+        {
+            cachedFrame_ = SIZE_MAX;
+            if (!readFrame(index, cache_))
+                break;
+            cachedFrame_ = index;
+        }
+        uint64_t inFrame = rawOffset - frames_[index].rawOffset;
+        if (inFrame >= cache_.size())
+            break;
+        size_t n = static_cast<size_t>(
+            std::min<uint64_t>(len - done, cache_.size() - inFrame));
+        memcpy(buf + done, cache_.data() + inFrame, n);
+        done += n;
+        rawOffset += n;
+    }
+    return done;
+}
+
+FramedFileWriter::~FramedFileWriter()
+{
+    close();
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    if (streamInited_)
+        deflateEnd(&stream_);
+#endif
+}
+
+bool FramedFileWriter::open(const std::string &fileName)
+{
+    FramedIndex index;
+    int fd = openForRead(fileName);
+    if (fd >= 0)
+    {
+        uint64_t size = fileSizeOf(fd);
+        bool framed = loadIndex(fd, size, index);
+        closeFd(fd);
+        if (!framed)
+        {
+            fprintf(stderr,
+                    "%s is not a framed log file, not appending to it\n",
+                    fileName.c_str());
+            return false;
+        }
+#ifndef _WIN32
+        // Drop the seek table or a frame cut by a crash, the table is written
+        // again on close.
+        if (index.end < size &&
+            truncate(fileName.c_str(), static_cast<off_t>(index.end)) != 0)
+        {
+            fprintf(stderr,
+                    "Failed to truncate %s: %s\n",
+                    fileName.c_str(),
+                    strerror_tl(errno));
+            return false;
+        }
+#endif
+    }
+    fp_ = fopen(fileName.c_str(), "ab");
+    if (!fp_)
+        return false;
+    length_ = index.end;
+    rawLength_ = index.rawSize;
+    frames_ = std::move(index.frames);
+    dictionaries_ = std::move(index.dictionaries);
+    return true;
+}
+
+void FramedFileWriter::setDictionary(
+    std::shared_ptr<const std::string> dictionary)
+{
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    if (dictionary && !dictionary->empty())
+    {
+        dictionary_ = std::move(dictionary);
+        dictId_ = static_cast<uint32_t>(
+            adler32(adler32(0L, Z_NULL, 0),
+                    reinterpret_cast<const Bytef *>(dictionary_->data()),
+                    static_cast<uInt>(dictionary_->size())));
+        return;
+    }
+#endif
+    (void)dictionary;
+    dictionary_.reset();
+    dictId_ = 0;
+}
+
+void FramedFileWriter::writeFrame(uint8_t codec,
+                                  uint32_t dictId,
+                                  const char *data,
+                                  size_t len,
+                                  size_t rawLen)
+{
+    FrameHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kFrameMagic;
+    header.codec = codec;
+    header.dictId = dictId;
+    header.compressedLen = static_cast<uint32_t>(len);
+    header.rawLen = static_cast<uint32_t>(rawLen);
+    fwrite(&header, 1, sizeof(header), fp_);
+    fwrite(data, 1, len, fp_);
+    length_ += sizeof(header) + len;
+}
+
+bool FramedFileWriter::compress(const char *data, size_t len, size_t &outLen)
+{
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    if (!streamInited_)
+    {
+        memset(&stream_, 0, sizeof(stream_));
+        // Raw deflate, the frame header has the lengths.
+        if (deflateInit2(&stream_,
+                         Z_BEST_SPEED,
+                         Z_DEFLATED,
+                         -MAX_WBITS,
+                         8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        streamInited_ = true;
+    }
+    else
+    {
+        deflateReset(&stream_);
+    }
+    if (dictId_ != 0)
+    {
+        deflateSetDictionary(&stream_,
+                             reinterpret_cast<const Bytef *>(
+                                 dictionary_->data()),
+                             static_cast<uInt>(dictionary_->size()));
+    }
+    compressed_.resize(deflateBound(&stream_, static_cast<uLong>(len)));
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_.avail_in = static_cast<uInt>(len);
+    stream_.next_out = reinterpret_cast<Bytef *>(&compressed_[0]);
+    stream_.avail_out = static_cast<uInt>(compressed_.size());
+    if (deflate(&stream_, Z_FINISH) != Z_STREAM_END)
+        return false;
+    outLen = static_cast<size_t>(stream_.total_out);
+    return outLen < len;
+#else
+    (void)data;
+    (void)len;
+    (void)outLen;
+    return false;
+#endif
+}
+
+void FramedFileWriter::write(const char *data, size_t len)
+{
+    if (!fp_ || len == 0)
+        return;
+    if (dictId_ != 0 &&
+        std::none_of(dictionaries_.begin(),
+                     dictionaries_.end(),
+                     [this](const FramedDictionary &entry) {
+                         return entry.dictId == dictId_;
+                     }))
+    {
+        // The file carries the dictionaries its frames need.
+        dictionaries_.push_back({length_, dictId_, 0});
+        writeFrame(kCodecDictionary,
+                   dictId_,
+                   dictionary_->data(),
+                   dictionary_->size(),
+                   dictionary_->size());
+    }
+    frames_.push_back({length_, rawLength_});
+    size_t compressedLen;
+    if (compress(data, len, compressedLen))
+        writeFrame(kCodecDeflate, dictId_, compressed_.data(), compressedLen, len);
+    else
+        writeFrame(kCodecStored, 0, data, len, len);
+    rawLength_ += len;
+}
+
+void FramedFileWriter::flush()
+{
+    if (fp_)
+        fflush(fp_);
+}
+
+void FramedFileWriter::close()
+{
+    if (!fp_)
+        return;
+    TableHeader table;
+    memset(&table, 0, sizeof(table));
+    table.magic = kTableMagic;
+    table.frameCount = static_cast<uint32_t>(frames_.size());
+    table.dictCount = static_cast<uint32_t>(dictionaries_.size());
+    Footer footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.tableOffset = length_;
+    footer.rawSize = rawLength_;
+    footer.magic = kFooterMagic;
+    fwrite(&table, 1, sizeof(table), fp_);
+    fwrite(frames_.data(), sizeof(FramedLogReader::Frame), frames_.size(), fp_);
+    fwrite(dictionaries_.data(),
+           sizeof(FramedDictionary),
+           dictionaries_.size(),
+           fp_);
+    fwrite(&footer, 1, sizeof(footer), fp_);
+    fclose(fp_);
+    fp_ = nullptr;
+    length_ += sizeof(table) + frames_.size() * sizeof(FramedLogReader::Frame) +
+               dictionaries_.size() * sizeof(FramedDictionary) + sizeof(footer);
+    frames_.clear();
+    dictionaries_.clear();
+}
+
+int FramedFileWriter::fileDescriptor() const
+{
+    if (fp_)
+        return fileno(fp_);
+    return -1;
+}
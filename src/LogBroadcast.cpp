@@ -0,0 +1,163 @@
+/**
+ * @file LogBroadcast.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogBroadcast.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+
+using namespace xiaoLog;
+
+/**
+ * @brief The sequence of a slot is 2 * pos + 1 while the record of the
+ * position pos is written and 2 * pos + 2 once it's complete, so it also
+ * tells which lap of the ring the slot holds.
+ *
+ */
+struct LogBroadcast::Slot
+{
+    std::atomic<uint64_t> seq;
+    int32_t level;
+    int32_t channel;
+    uint32_t len;
+    uint32_t truncated;
+
+    char *data()
+    {
+        return reinterpret_cast<char *>(this + 1);
+    }
+};
+
+LogBroadcast::LogBroadcast(size_t slots, size_t slotSize)
+    : slotSize_(slotSize)
+{
+    size_t n = 1;
+    while (n < slots)
+        n <<= 1;
+    mask_ = n - 1;
+    // Slots start on cache lines, so producers of neighbouring positions
+    // don't share one.
+    stride_ = (sizeof(Slot) + slotSize_ + 63) & ~static_cast<size_t>(63);
+    slots_ = static_cast<char *>(calloc(n, stride_));
+    if (!slots_)
+        throw std::bad_alloc();
+    for (size_t i = 0; i < n; ++i)
+        new (slotAt(i)) Slot{{0}, 0, 0, 0, 0};
+}
+
+LogBroadcast::~LogBroadcast()
+{
+    free(slots_);
+}
+
+LogBroadcast::Slot *LogBroadcast::slotAt(uint64_t pos) const
+{
+    return reinterpret_cast<Slot *>(slots_ +
+                                    static_cast<size_t>(pos & mask_) * stride_);
+}
+
+void LogBroadcast::publish(int level,
+                           int channel,
+                           const char *msg,
+                           uint64_t len)
+{
+    auto pos = head_.fetch_add(1, std::memory_order_acq_rel);
+    auto slot = slotAt(pos);
+    auto seq = slot->seq.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        // A producer a lap ahead took the slot, the record is lost for
+        // everyone, which the subscribers see as a gap.
+        if (seq >= 2 * pos + 1)
+            return;
+        // A producer a lap behind is still copying, it's a bounded memcpy.
+        if (seq & 1)
+        {
+            std::this_thread::yield();
+            seq = slot->seq.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (slot->seq.compare_exchange_weak(seq,
+                                            2 * pos + 1,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+            break;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    auto n = static_cast<size_t>((std::min)(len, uint64_t(slotSize_)));
+    slot->level = level;
+    slot->channel = channel;
+    slot->len = static_cast<uint32_t>(n);
+    slot->truncated = n < len;
+    memcpy(slot->data(), msg, n);
+    slot->seq.store(2 * pos + 2, std::memory_order_release);
+}
+
+LogBroadcast::Subscriber::Subscriber(std::shared_ptr<LogBroadcast> broadcast,
+                                     bool backlog)
+    : broadcast_(std::move(broadcast))
+{
+    next_ = broadcast_->published();
+    if (backlog)
+        next_ = next_ > broadcast_->mask_ ? next_ - broadcast_->mask_ - 1 : 0;
+    buffer_.resize(broadcast_->slotSize_);
+}
+
+size_t LogBroadcast::Subscriber::poll(
+    const std::function<void(const Record &)> &func,
+    size_t maxRecords)
+{
+    size_t delivered = 0;
+    uint64_t ringSize = broadcast_->mask_ + 1;
+    while (delivered < maxRecords)
+    {
+        auto head = broadcast_->published();
+        if (next_ >= head)
+            break;
+        if (head - next_ > ringSize)
+        {
+            gaps_ += head - ringSize - next_;
+            next_ = head - ringSize;
+        }
+        auto slot = broadcast_->slotAt(next_);
+        auto seq = slot->seq.load(std::memory_order_acquire);
+        if (seq < 2 * next_ + 2)
+        {
+            // Still being written, try again on the next poll.
+            break;
+        }
+        Record record;
+        record.level = slot->level;
+        record.channel = slot->channel;
+        record.len = (std::min)(static_cast<size_t>(slot->len), buffer_.size());
+        record.truncated = slot->truncated != 0;
+        memcpy(&buffer_[0], slot->data(), record.len);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq != 2 * next_ + 2 ||
+            slot->seq.load(std::memory_order_relaxed) != seq)
+        {
+            // Overwritten by a later lap, before or while it was copied.
+            ++gaps_;
+            ++next_;
+            continue;
+        }
+        ++next_;
+        if (record.level < level_ ||
+            (!channels_.empty() &&
+             std::find(channels_.begin(), channels_.end(), record.channel) ==
+                 channels_.end()))
+            continue;
+        record.data = buffer_.data();
+        func(record);
+        ++delivered;
+    }
+    return delivered;
+}
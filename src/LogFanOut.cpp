@@ -0,0 +1,344 @@
+/**
+ * @file LogFanOut.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogFanOut.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <string>
+
+namespace xiaoLog
+{
+    struct LogFanOut::Chunk
+    {
+        struct Record
+        {
+            uint32_t offset;
+            uint32_t len;
+            // -1 if the record has no level.
+            int level;
+        };
+
+        std::string data;
+        std::vector<Record> records;
+        // The highest level of the records, kFatal if one has no level.
+        int maxLevel{-1};
+        bool flush{false};
+        // The sinks queue the chunks in this order.
+        uint64_t seq{0};
+        std::chrono::steady_clock::time_point start;
+
+        bool passes(const Record &record, Logger::LogLevel level) const
+        {
+            return record.level < 0 || record.level >= level;
+        }
+        uint64_t count(Logger::LogLevel level) const
+        {
+            uint64_t n = 0;
+            for (auto &record : records)
+            {
+                if (passes(record, level))
+                    ++n;
+            }
+            return n;
+        }
+    };
+
+    struct LogFanOut::Sink
+    {
+        std::function<void(const char *msg, const uint64_t len)> outputFunc;
+        std::function<void()> flushFunc;
+        SinkOptions options;
+        std::mutex mutex;
+        std::condition_variable cond;
+        // Wakes up the producers blocked by a full queue, or waiting for the
+        // chunks sealed before theirs.
+        std::condition_variable spaceCond;
+        std::deque<std::shared_ptr<Chunk>> queue;
+        size_t queuedBytes{0};
+        uint64_t nextSeq{0};
+        bool parked{false};
+        bool stop{false};
+        std::atomic<uint64_t> droppedRecords{0};
+        std::unique_ptr<std::thread> threadPtr;
+    };
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+LogFanOut::LogFanOut(size_t chunkSize) : chunkSize_(chunkSize)
+{
+}
+
+LogFanOut::~LogFanOut()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopFlag_ = true;
+    }
+    if (timerThreadPtr_)
+    {
+        cond_.notify_all();
+        timerThreadPtr_->join();
+    }
+    std::shared_ptr<Chunk> chunk;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        chunk = sealChunk(false);
+    }
+    if (chunk)
+        dispatch(chunk);
+    for (auto &sink : sinks_)
+    {
+        {
+            std::lock_guard<std::mutex> guard(sink->mutex);
+            sink->stop = true;
+        }
+        sink->cond.notify_all();
+        // The queue is drained before the thread exits.
+        if (sink->threadPtr)
+            sink->threadPtr->join();
+        else
+            sinkThreadFunc(*sink);
+    }
+}
+
+size_t LogFanOut::addSink(
+    std::function<void(const char *msg, const uint64_t len)> outputFunc,
+    std::function<void()> flushFunc,
+    const SinkOptions &options)
+{
+    assert(outputFunc);
+    assert(!timerThreadPtr_);
+    std::unique_ptr<Sink> sink(new Sink);
+    sink->outputFunc = std::move(outputFunc);
+    sink->flushFunc = std::move(flushFunc);
+    sink->options = options;
+    sinks_.push_back(std::move(sink));
+    return sinks_.size() - 1;
+}
+
+void LogFanOut::startLogging()
+{
+    for (auto &sink : sinks_)
+    {
+        auto *s = sink.get();
+        s->threadPtr.reset(new std::thread([this, s]() {
+#ifdef __linux__
+            prctl(PR_SET_NAME, "LogFanOutSink");
+#endif
+            sinkThreadFunc(*s);
+        }));
+    }
+    timerThreadPtr_.reset(new std::thread([this]() { timerThreadFunc(); }));
+}
+
+void LogFanOut::output(const char *msg, const uint64_t len)
+{
+    size_t pos;
+    append(msg, len, Logger::parseLevel(msg, len, pos));
+}
+
+void LogFanOut::append(const char *msg, const uint64_t len, int level)
+{
+    std::shared_ptr<Chunk> sealed;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!chunk_)
+        {
+            chunk_ = std::make_shared<Chunk>();
+            chunk_->data.reserve(chunkSize_);
+        }
+        if (chunk_->records.empty())
+        {
+            chunk_->start = std::chrono::steady_clock::now();
+            if (timerParked_)
+                cond_.notify_one();
+        }
+        chunk_->records.push_back(
+            {static_cast<uint32_t>(chunk_->data.size()),
+             static_cast<uint32_t>(len),
+             level});
+        chunk_->data.append(msg, static_cast<size_t>(len));
+        chunk_->maxLevel = (std::max)(chunk_->maxLevel,
+                                      level < 0 ? int(Logger::kFatal) : level);
+        if (chunk_->data.size() >= chunkSize_)
+            sealed = sealChunk(false);
+    }
+    if (sealed)
+        dispatch(sealed);
+}
+
+void LogFanOut::flush()
+{
+    std::shared_ptr<Chunk> sealed;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        sealed = sealChunk(true);
+    }
+    if (sealed)
+        dispatch(sealed);
+}
+
+uint64_t LogFanOut::droppedRecords(size_t sink) const
+{
+    return sinks_[sink]->droppedRecords.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<LogFanOut::Chunk> LogFanOut::sealChunk(bool flush)
+{
+    if (!chunk_ || chunk_->records.empty())
+        return nullptr;
+    std::shared_ptr<Chunk> chunk = std::move(chunk_);
+    chunk->flush = flush;
+    chunk->seq = sealedChunks_++;
+    return chunk;
+}
+
+void LogFanOut::dispatch(const std::shared_ptr<Chunk> &chunk)
+{
+    // A blocking sink which stalls mustn't hold the chunk back from the
+    // others, it gets the chunk last.
+    for (auto &sink : sinks_)
+    {
+        if (sink->options.policy != OverflowPolicy::kBlock)
+            enqueue(*sink, chunk);
+    }
+    for (auto &sink : sinks_)
+    {
+        if (sink->options.policy == OverflowPolicy::kBlock)
+            enqueue(*sink, chunk);
+    }
+}
+
+void LogFanOut::enqueue(Sink &sink, const std::shared_ptr<Chunk> &chunk)
+{
+    auto level = sink.options.level;
+    size_t size = chunk->data.size();
+    std::unique_lock<std::mutex> lock(sink.mutex);
+    // The chunks are dispatched without mutex_, so a chunk sealed later may
+    // get here first.
+    sink.spaceCond.wait(lock, [&sink, &chunk]() {
+        return sink.nextSeq == chunk->seq;
+    });
+    if (chunk->maxLevel < level && !chunk->flush)
+    {
+        ++sink.nextSeq;
+        lock.unlock();
+        sink.spaceCond.notify_all();
+        return;
+    }
+    auto full = [&sink, size]() {
+        return !sink.queue.empty() &&
+               sink.queuedBytes + size > sink.options.maxQueuedBytes;
+    };
+    if (full())
+    {
+        switch (sink.options.policy)
+        {
+            case OverflowPolicy::kDropNewest:
+                sink.droppedRecords.fetch_add(chunk->count(level),
+                                              std::memory_order_relaxed);
+                ++sink.nextSeq;
+                lock.unlock();
+                sink.spaceCond.notify_all();
+                return;
+            case OverflowPolicy::kDropOldest:
+                while (full())
+                {
+                    auto &oldest = sink.queue.front();
+                    sink.droppedRecords.fetch_add(oldest->count(level),
+                                                  std::memory_order_relaxed);
+                    sink.queuedBytes -= oldest->data.size();
+                    sink.queue.pop_front();
+                }
+                break;
+            case OverflowPolicy::kBlock:
+                sink.spaceCond.wait(lock, [&sink, &full]() {
+                    return !full() || sink.stop;
+                });
+                break;
+        }
+    }
+    ++sink.nextSeq;
+    sink.queue.push_back(chunk);
+    sink.queuedBytes += size;
+    if (sink.parked)
+        sink.cond.notify_one();
+    lock.unlock();
+    sink.spaceCond.notify_all();
+}
+
+void LogFanOut::timerThreadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "LogFanOut");
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopFlag_)
+    {
+        if (!chunk_ || chunk_->records.empty())
+        {
+            // Nothing to hand over, sleep until a producer adds a record.
+            timerParked_ = true;
+            cond_.wait(lock);
+            timerParked_ = false;
+            continue;
+        }
+        auto deadline = chunk_->start + flushInterval_;
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            auto chunk = sealChunk(false);
+            lock.unlock();
+            dispatch(chunk);
+            lock.lock();
+            continue;
+        }
+        cond_.wait_until(lock, deadline);
+    }
+}
+
+void LogFanOut::sinkThreadFunc(Sink &sink)
+{
+    while (true)
+    {
+        std::shared_ptr<Chunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(sink.mutex);
+            while (sink.queue.empty() && !sink.stop)
+            {
+                sink.parked = true;
+                sink.cond.wait(lock);
+                sink.parked = false;
+            }
+            if (sink.queue.empty())
+                break;
+            chunk = std::move(sink.queue.front());
+            sink.queue.pop_front();
+            sink.queuedBytes -= chunk->data.size();
+        }
+        sink.spaceCond.notify_all();
+        bool error = false;
+        for (auto &record : chunk->records)
+        {
+            if (!chunk->passes(record, sink.options.level))
+                continue;
+            sink.outputFunc(chunk->data.data() + record.offset, record.len);
+            if (record.level >= Logger::kError)
+                error = true;
+        }
+        if ((error || chunk->flush) && sink.flushFunc)
+            sink.flushFunc();
+    }
+}
@@ -0,0 +1,529 @@
+/**
+ * @file LogFileWriter.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include "LogFileWriter.h"
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+namespace xiaoLog
+{
+#ifndef _WIN32
+    // The file grows by kExtentSize and kWindowSize bytes of it are mapped at
+    // a time, kExtentSize must be a multiple of kWindowSize.
+    static constexpr uint64_t kExtentSize{32 * 1024 * 1024};
+    static constexpr uint64_t kWindowSize{8 * 1024 * 1024};
+#endif
+#ifdef __linux__
+    static constexpr size_t kBlockSize{4096};
+    static constexpr size_t kStagingSize{1024 * 1024};
+    static constexpr uint64_t kPreallocSize{32 * 1024 * 1024};
+#endif
+    extern const char *strerror_tl(int savedErrno);
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+std::unique_ptr<LogFileWriter> LogFileWriter::newWriter(
+    LoggerFile::WriteMode mode)
+{
+    switch (mode)
+    {
+    case LoggerFile::WriteMode::kMmap:
+#ifndef _WIN32
+        return std::unique_ptr<LogFileWriter>(new MmapFileWriter);
+#else
+        break;
+#endif
+    case LoggerFile::WriteMode::kDirect:
+#ifdef __linux__
+        return std::unique_ptr<LogFileWriter>(new DirectFileWriter);
+#else
+        break;
+#endif
+    case LoggerFile::WriteMode::kFramed:
+        return std::unique_ptr<LogFileWriter>(new FramedFileWriter);
+    default:
+        break;
+    }
+    return std::unique_ptr<LogFileWriter>(new StdioFileWriter);
+}
+
+void LogFileWriter::sync()
+{
+    flush();
+#ifndef _WIN32
+    int fd = fileDescriptor();
+    if (fd < 0)
+        return;
+#ifdef __linux__
+    int r = fdatasync(fd);
+#else
+    int r = fsync(fd);
+#endif
+    if (r != 0)
+    {
+        fprintf(stderr, "Failed to sync log file: %s\n", strerror_tl(errno));
+    }
+#endif
+}
+
+void LogFileWriter::writeBehind()
+{
+#ifdef __linux__
+    int fd = fileDescriptor();
+    uint64_t end = length();
+    if (fd < 0)
+        return;
+    if (end < writeBehindTo_)
+    {
+        // The writer was reopened on a new file.
+        writeBehindFrom_ = 0;
+        writeBehindTo_ = 0;
+    }
+    if (end == writeBehindTo_)
+        return;
+    if (writeBehindTo_ > writeBehindFrom_)
+    {
+        sync_file_range(fd,
+                        static_cast<off_t>(writeBehindFrom_),
+                        static_cast<off_t>(writeBehindTo_ - writeBehindFrom_),
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                            SYNC_FILE_RANGE_WAIT_AFTER);
+    }
+    sync_file_range(fd,
+                    static_cast<off_t>(writeBehindTo_),
+                    static_cast<off_t>(end - writeBehindTo_),
+                    SYNC_FILE_RANGE_WRITE);
+    writeBehindFrom_ = writeBehindTo_;
+    writeBehindTo_ = end;
+#endif
+}
+
+StdioFileWriter::~StdioFileWriter()
+{
+    close();
+}
+
+bool StdioFileWriter::open(const std::string &fileName)
+{
+#ifndef _MSC_VER
+    fp_ = fopen(fileName.c_str(), "a");
+#else
+#endif
+    return fp_ != nullptr;
+}
+
+void StdioFileWriter::write(const char *data, size_t len)
+{
+    if (fp_)
+    {
+        fwrite(data, 1, len, fp_);
+    }
+}
+
+void StdioFileWriter::flush()
+{
+    if (fp_)
+    {
+        fflush(fp_);
+    }
+}
+
+void StdioFileWriter::close()
+{
+    if (fp_)
+    {
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+int StdioFileWriter::fileDescriptor() const
+{
+    if (fp_)
+        return fileno(fp_);
+    return -1;
+}
+
+uint64_t StdioFileWriter::length() const
+{
+    if (fp_)
+        return ftell(fp_);
+    return 0;
+}
+
+#ifndef _WIN32
+MmapFileWriter::~MmapFileWriter()
+{
+    close();
+}
+
+bool MmapFileWriter::open(const std::string &fileName)
+{
+    fd_ = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    allocated_ = static_cast<uint64_t>(st.st_size);
+    // A file which was not closed properly still has its preallocated tail.
+    length_ = trimTrailingZeros(allocated_);
+    syncedTo_ = length_;
+    return true;
+}
+
+uint64_t MmapFileWriter::trimTrailingZeros(uint64_t size)
+{
+    // Only a file left by a crash ends exactly on an extent boundary.
+    if (size == 0 || size % kExtentSize != 0)
+        return size;
+    constexpr size_t kChunkSize{64 * 1024};
+    std::unique_ptr<char[]> buf(new char[kChunkSize]);
+    uint64_t limit = size - kExtentSize;
+    uint64_t end = size;
+    while (end > limit)
+    {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(kChunkSize, end - limit));
+        uint64_t offset = end - n;
+        if (pread(fd_, buf.get(), n, static_cast<off_t>(offset)) !=
+            static_cast<ssize_t>(n))
+            return size;
+        for (size_t i = n; i > 0; --i)
+        {
+            if (buf[i - 1] != '\0')
+                return offset + i;
+        }
+        end = offset;
+    }
+    return limit;
+}
+
+bool MmapFileWriter::reserve(uint64_t size)
+{
+    if (size <= allocated_)
+        return true;
+    uint64_t newSize = (size + kExtentSize - 1) / kExtentSize * kExtentSize;
+#ifdef __linux__
+    if (fallocate(fd_,
+                  0,
+                  static_cast<off_t>(allocated_),
+                  static_cast<off_t>(newSize - allocated_)) == 0)
+    {
+        allocated_ = newSize;
+        return true;
+    }
+    if (errno != EOPNOTSUPP)
+        return false;
+#endif
+    // The file system can't preallocate, a sparse file is good enough.
+    if (ftruncate(fd_, static_cast<off_t>(newSize)) != 0)
+        return false;
+    allocated_ = newSize;
+    return true;
+}
+
+bool MmapFileWriter::mapWindow(uint64_t offset)
+{
+    unmapWindow();
+    uint64_t start = offset / kWindowSize * kWindowSize;
+    if (!reserve(start + kWindowSize))
+        return false;
+    void *addr = mmap(nullptr,
+                      kWindowSize,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED,
+                      fd_,
+                      static_cast<off_t>(start));
+    if (addr == MAP_FAILED)
+        return false;
+    madvise(addr, kWindowSize, MADV_SEQUENTIAL);
+    window_ = static_cast<char *>(addr);
+    windowStart_ = start;
+    windowSize_ = kWindowSize;
+    return true;
+}
+
+void MmapFileWriter::unmapWindow()
+{
+    if (!window_)
+        return;
+    // The pages stay in the page cache and are written back by the kernel,
+    // drop them from our address space so the window doesn't pin them.
+    msync(window_, windowSize_, MS_ASYNC);
+    madvise(window_, windowSize_, MADV_DONTNEED);
+    munmap(window_, windowSize_);
+    window_ = nullptr;
+    windowStart_ = 0;
+    windowSize_ = 0;
+}
+
+void MmapFileWriter::write(const char *data, size_t len)
+{
+    if (fd_ < 0)
+        return;
+    while (len > 0)
+    {
+        if (!window_ || length_ < windowStart_ ||
+            length_ >= windowStart_ + windowSize_)
+        {
+            if (!mapWindow(length_))
+            {
+                fprintf(stderr,
+                        "Failed to map log file: %s\n",
+                        strerror_tl(errno));
+                ssize_t n = pwrite(fd_, data, len, static_cast<off_t>(length_));
+                if (n > 0)
+                    length_ += static_cast<uint64_t>(n);
+                return;
+            }
+        }
+        size_t n = static_cast<size_t>(
+            std::min<uint64_t>(len, windowStart_ + windowSize_ - length_));
+        memcpy(window_ + (length_ - windowStart_), data, n);
+        length_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void MmapFileWriter::flush()
+{
+    if (!window_ || syncedTo_ >= length_)
+        return;
+    static const uint64_t pageSize =
+        static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t from = std::max(syncedTo_, windowStart_) / pageSize * pageSize;
+    if (from < length_)
+        msync(window_ + (from - windowStart_), length_ - from, MS_ASYNC);
+    syncedTo_ = length_;
+}
+
+void MmapFileWriter::sync()
+{
+    flush();
+    // fdatasync covers dirty shared mappings on Linux, not everywhere else.
+    if (window_ && length_ > windowStart_)
+        msync(window_, length_ - windowStart_, MS_SYNC);
+    LogFileWriter::sync();
+}
+
+void MmapFileWriter::close()
+{
+    if (fd_ < 0)
+        return;
+    unmapWindow();
+    if (allocated_ != length_ &&
+        ftruncate(fd_, static_cast<off_t>(length_)) != 0)
+    {
+        fprintf(stderr,
+                "Failed to truncate log file: %s\n",
+                strerror_tl(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    length_ = 0;
+    allocated_ = 0;
+    syncedTo_ = 0;
+}
+#endif
+
+#ifdef __linux__
+DirectFileWriter::~DirectFileWriter()
+{
+    close();
+}
+
+bool DirectFileWriter::open(const std::string &fileName)
+{
+    fd_ = ::open(fileName.c_str(),
+                 O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT,
+                 0644);
+    if (fd_ < 0 && errno == EINVAL)
+    {
+        // The file system doesn't support O_DIRECT (e.g. tmpfs), the block
+        // aligned writes still work through the page cache.
+        fd_ = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    if (fd_ < 0)
+        return false;
+    void *buf{nullptr};
+    struct stat st;
+    if (posix_memalign(&buf, kBlockSize, kStagingSize) != 0 ||
+        fstat(fd_, &st) != 0)
+    {
+        free(buf);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    buf_ = static_cast<char *>(buf);
+    allocated_ = static_cast<uint64_t>(st.st_size);
+    if (!loadTail(static_cast<uint64_t>(st.st_size)))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool DirectFileWriter::loadTail(uint64_t size)
+{
+    offset_ = size / kBlockSize * kBlockSize;
+    bufLen_ = static_cast<size_t>(size - offset_);
+    bool padded = false;
+    if (bufLen_ == 0 && size > 0)
+    {
+        // A file which was not closed properly ends with a padded block.
+        offset_ -= kBlockSize;
+        bufLen_ = kBlockSize;
+        padded = true;
+    }
+    if (bufLen_ == 0)
+        return true;
+    if (pread(fd_, buf_, kBlockSize, static_cast<off_t>(offset_)) !=
+        static_cast<ssize_t>(bufLen_))
+        return false;
+    if (padded)
+    {
+        while (bufLen_ > 0 && buf_[bufLen_ - 1] == '\0')
+            --bufLen_;
+    }
+    return true;
+}
+
+bool DirectFileWriter::writeAll(const char *data, size_t len, uint64_t offset)
+{
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd_, data, len, static_cast<off_t>(offset));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr,
+                    "Failed to write log file: %s\n",
+                    strerror_tl(errno));
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+void DirectFileWriter::preallocate(uint64_t size)
+{
+    if (size <= allocated_)
+        return;
+    uint64_t newSize = (size + kPreallocSize - 1) / kPreallocSize * kPreallocSize;
+    // The extents are reserved without changing the file size, failure only
+    // costs us the fragmentation we tried to avoid.
+    fallocate(fd_,
+              FALLOC_FL_KEEP_SIZE,
+              static_cast<off_t>(allocated_),
+              static_cast<off_t>(newSize - allocated_));
+    allocated_ = newSize;
+}
+
+bool DirectFileWriter::writeBlocks()
+{
+    size_t whole = bufLen_ / kBlockSize * kBlockSize;
+    if (whole == 0)
+        return true;
+    preallocate(offset_ + whole);
+    bool ok = writeAll(buf_, whole, offset_);
+    if (ok)
+    {
+        offset_ += whole;
+    }
+    else
+    {
+        // The blocks are dropped (e.g. ENOSPC), otherwise the staging buffer
+        // stays full and nothing more can be logged. The next blocks are
+        // written at the same offset.
+        droppedBytes_ += whole;
+    }
+    bufLen_ -= whole;
+    memmove(buf_, buf_ + whole, bufLen_);
+    return ok;
+}
+
+void DirectFileWriter::writeTail()
+{
+    if (bufLen_ == 0)
+        return;
+    size_t padded = (bufLen_ + kBlockSize - 1) / kBlockSize * kBlockSize;
+    memset(buf_ + bufLen_, 0, padded - bufLen_);
+    preallocate(offset_ + padded);
+    writeAll(buf_, padded, offset_);
+}
+
+void DirectFileWriter::write(const char *data, size_t len)
+{
+    if (fd_ < 0)
+        return;
+    while (len > 0)
+    {
+        size_t n = std::min(len, kStagingSize - bufLen_);
+        memcpy(buf_ + bufLen_, data, n);
+        bufLen_ += n;
+        data += n;
+        len -= n;
+        if (bufLen_ == kStagingSize && !writeBlocks())
+        {
+            fprintf(stderr,
+                    "%llu bytes of log are dropped\n",
+                    static_cast<long long unsigned int>(droppedBytes_));
+        }
+    }
+    writeBlocks();
+}
+
+void DirectFileWriter::flush()
+{
+    if (fd_ < 0)
+        return;
+    writeBlocks();
+    writeTail();
+}
+
+void DirectFileWriter::close()
+{
+    if (fd_ < 0)
+        return;
+    flush();
+    if (ftruncate(fd_, static_cast<off_t>(length())) != 0)
+    {
+        fprintf(stderr,
+                "Failed to truncate log file: %s\n",
+                strerror_tl(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    free(buf_);
+    buf_ = nullptr;
+    bufLen_ = 0;
+    offset_ = 0;
+    allocated_ = 0;
+}
+#endif
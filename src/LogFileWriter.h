@@ -0,0 +1,274 @@
+/**
+ * @file LogFileWriter.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/NonCopyable.h>
+#include <xiaoLog/LoggerFile.h>
+#include <xiaoLog/FramedLog.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef XIAOLOG_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+namespace xiaoLog
+{
+    /**
+     * @brief This class is the interface of the low level writers used by
+     * LoggerFile. A writer appends to exactly one file between open() and
+     * close().
+     *
+     */
+    class LogFileWriter : NonCopyable
+    {
+    public:
+        virtual ~LogFileWriter() = default;
+
+        /**
+         * @brief Open the file in append mode.
+         *
+         * @param fileName
+         * @return true if the file is opened.
+         */
+        virtual bool open(const std::string &fileName) = 0;
+        virtual void write(const char *data, size_t len) = 0;
+        virtual void flush() = 0;
+
+        /**
+         * @brief Flush and wait until the data is on the disk (fdatasync).
+         *
+         */
+        virtual void sync();
+
+        /**
+         * @brief Start writing back the data written since the last call and
+         * wait for the range started by the last call, so the dirty pages of
+         * the file stay bounded to about one flush (sync_file_range). It does
+         * nothing on systems other than Linux.
+         *
+         */
+        void writeBehind();
+
+        /**
+         * @brief Close the file. After this call the file on disk has exactly
+         * the length returned by length().
+         *
+         */
+        virtual void close() = 0;
+        virtual uint64_t length() const = 0;
+        virtual bool isOpen() const = 0;
+
+        /**
+         * @brief The length of the log data written, which is length() unless
+         * the writer transforms the data.
+         *
+         * @return uint64_t
+         */
+        virtual uint64_t rawLength() const
+        {
+            return length();
+        }
+
+        /**
+         * @brief Set the compression dictionary of the writers which compress.
+         *
+         * @param dictionary
+         */
+        virtual void setDictionary(std::shared_ptr<const std::string> dictionary)
+        {
+            (void)dictionary;
+        }
+
+        static std::unique_ptr<LogFileWriter> newWriter(
+            LoggerFile::WriteMode mode);
+
+    protected:
+        virtual int fileDescriptor() const = 0;
+
+    private:
+        uint64_t writeBehindFrom_{0};
+        uint64_t writeBehindTo_{0};
+    };
+
+    class StdioFileWriter : public LogFileWriter
+    {
+    public:
+        ~StdioFileWriter() override;
+        bool open(const std::string &fileName) override;
+        void write(const char *data, size_t len) override;
+        void flush() override;
+        void close() override;
+        uint64_t length() const override;
+        bool isOpen() const override
+        {
+            return fp_ != nullptr;
+        }
+
+    private:
+        int fileDescriptor() const override;
+
+        FILE *fp_{nullptr};
+    };
+
+#ifndef _WIN32
+    /**
+     * @brief This class appends to the file through a shared memory mapping.
+     * The file is grown by kExtentSize with fallocate and a window of
+     * kWindowSize bytes is mapped around the write position. The file is
+     * truncated to the real length when it is closed.
+     *
+     */
+    class MmapFileWriter : public LogFileWriter
+    {
+    public:
+        ~MmapFileWriter() override;
+        bool open(const std::string &fileName) override;
+        void write(const char *data, size_t len) override;
+        void flush() override;
+        void sync() override;
+        void close() override;
+        uint64_t length() const override
+        {
+            return length_;
+        }
+        bool isOpen() const override
+        {
+            return fd_ >= 0;
+        }
+
+    private:
+        int fileDescriptor() const override
+        {
+            return fd_;
+        }
+        bool reserve(uint64_t size);
+        bool mapWindow(uint64_t offset);
+        void unmapWindow();
+        uint64_t trimTrailingZeros(uint64_t size);
+
+        int fd_{-1};
+        char *window_{nullptr};
+        uint64_t windowStart_{0};
+        uint64_t windowSize_{0};
+        uint64_t length_{0};
+        uint64_t allocated_{0};
+        uint64_t syncedTo_{0};
+    };
+#endif
+
+#ifdef __linux__
+    /**
+     * @brief This class writes the file with O_DIRECT. The data is staged in
+     * a block aligned buffer and only whole blocks are written, the tail
+     * which doesn't fill a block is kept for the next write. flush() writes
+     * the tail padded with zeros and close() truncates the padding.
+     *
+     */
+    class DirectFileWriter : public LogFileWriter
+    {
+    public:
+        ~DirectFileWriter() override;
+        bool open(const std::string &fileName) override;
+        void write(const char *data, size_t len) override;
+        void flush() override;
+        void close() override;
+        uint64_t length() const override
+        {
+            return offset_ + bufLen_;
+        }
+        bool isOpen() const override
+        {
+            return fd_ >= 0;
+        }
+
+    private:
+        int fileDescriptor() const override
+        {
+            return fd_;
+        }
+        bool loadTail(uint64_t size);
+        // Returns false if the blocks were dropped because of an error.
+        bool writeBlocks();
+        void writeTail();
+        bool writeAll(const char *data, size_t len, uint64_t offset);
+        void preallocate(uint64_t size);
+
+        int fd_{-1};
+        char *buf_{nullptr};
+        size_t bufLen_{0};
+        uint64_t offset_{0};
+        uint64_t allocated_{0};
+        uint64_t droppedBytes_{0};
+    };
+#endif
+
+    struct FramedDictionary
+    {
+        uint64_t fileOffset;
+        uint32_t dictId;
+        uint32_t reserved;
+    };
+
+    /**
+     * @brief This class writes the FramedLog format. Each write() is
+     * compressed into one frame on the calling thread. length() is the size
+     * of the compressed file, rawLength() the size of the log.
+     *
+     */
+    class FramedFileWriter : public LogFileWriter
+    {
+    public:
+        ~FramedFileWriter() override;
+        bool open(const std::string &fileName) override;
+        void write(const char *data, size_t len) override;
+        void flush() override;
+        void close() override;
+        uint64_t length() const override
+        {
+            return length_;
+        }
+        uint64_t rawLength() const override
+        {
+            return rawLength_;
+        }
+        bool isOpen() const override
+        {
+            return fp_ != nullptr;
+        }
+        void setDictionary(
+            std::shared_ptr<const std::string> dictionary) override;
+
+    private:
+        int fileDescriptor() const override;
+        bool compress(const char *data, size_t len, size_t &outLen);
+        void writeFrame(uint8_t codec,
+                        uint32_t dictId,
+                        const char *data,
+                        size_t len,
+                        size_t rawLen);
+
+        FILE *fp_{nullptr};
+        uint64_t length_{0};
+        uint64_t rawLength_{0};
+        std::vector<FramedLogReader::Frame> frames_;
+        std::vector<FramedDictionary> dictionaries_;
+        std::shared_ptr<const std::string> dictionary_;
+        uint32_t dictId_{0};
+        std::string compressed_;
+#ifdef XIAOLOG_ZLIB_SUPPORT
+        z_stream stream_;
+        bool streamInited_{false};
+#endif
+    };
+}
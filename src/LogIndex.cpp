@@ -0,0 +1,224 @@
+/**
+ * @file LogIndex.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogIndex.h>
+#include <xiaoLog/ShardedFileLogger.h>
+#include <string.h>
+#include <time.h>
+
+namespace xiaoLog
+{
+    static constexpr uint64_t kIndexMagic{0x7869616749647831ULL};
+    static constexpr uint32_t kIndexVersion{1};
+
+    struct IndexHeader
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t blockSize;
+    };
+
+    static_assert(sizeof(LogIndex::Block) == 64, "");
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+static bool isDigits(const char *p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (p[i] < '0' || p[i] > '9')
+            return false;
+    }
+    return true;
+}
+
+static int toInt(const char *p, size_t n)
+{
+    int v = 0;
+    for (size_t i = 0; i < n; ++i)
+        v = v * 10 + (p[i] - '0');
+    return v;
+}
+
+static void resetBlock(LogIndex::Block &block, uint64_t offset)
+{
+    memset(&block, 0, sizeof(block));
+    block.offset = offset;
+    block.minTime = INT64_MAX;
+    block.maxTime = INT64_MIN;
+}
+
+std::string LogIndex::indexFileName(const std::string &logFileName)
+{
+    if (logFileName.size() > 3 &&
+        logFileName.compare(logFileName.size() - 3, 3, ".gz") == 0)
+        return logFileName.substr(0, logFileName.size() - 3) + ".idx";
+    return logFileName + ".idx";
+}
+
+bool LogIndex::load(const std::string &indexFileName,
+                    std::vector<Block> &blocks)
+{
+    blocks.clear();
+    FILE *fp = fopen(indexFileName.c_str(), "rb");
+    if (!fp)
+        return false;
+    IndexHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != kIndexMagic || header.blockSize != sizeof(Block))
+    {
+        fclose(fp);
+        return false;
+    }
+    Block block;
+    while (fread(&block, sizeof(block), 1, fp) == 1)
+        blocks.push_back(block);
+    fclose(fp);
+    return true;
+}
+
+bool LogLineParser::parse(const char *line,
+                          size_t len,
+                          int64_t &microSeconds,
+                          int &level)
+{
+    uint64_t seq, recordLen;
+    if (len > AsyncFileLogger::kRecordHeaderLength &&
+        ShardedFileLogger::parseRecordHeader(line, seq, recordLen))
+    {
+        line += AsyncFileLogger::kRecordHeaderLength;
+        len -= AsyncFileLogger::kRecordHeaderLength;
+    }
+    // YYYYMMDD HH:MM:SS.uuuuuu
+    if (len < 25 || !isDigits(line, 8) || line[8] != ' ' ||
+        !isDigits(line + 9, 2) || line[11] != ':' || !isDigits(line + 12, 2) ||
+        line[14] != ':' || !isDigits(line + 15, 2) || line[17] != '.' ||
+        !isDigits(line + 18, 6) || line[24] != ' ')
+        return false;
+    bool utc = len >= 29 && memcmp(line + 24, " UTC ", 5) == 0;
+    if (utc != lastUtc_ || memcmp(line, lastSecond_, 17) != 0)
+    {
+        struct tm tm_time;
+        memset(&tm_time, 0, sizeof(tm_time));
+        tm_time.tm_year = toInt(line, 4) - 1900;
+        tm_time.tm_mon = toInt(line + 4, 2) - 1;
+        tm_time.tm_mday = toInt(line + 6, 2);
+        tm_time.tm_hour = toInt(line + 9, 2);
+        tm_time.tm_min = toInt(line + 12, 2);
+        tm_time.tm_sec = toInt(line + 15, 2);
+        tm_time.tm_isdst = -1;
+#ifndef _WIN32
+        lastSeconds_ = static_cast<int64_t>(utc ? timegm(&tm_time)
+                                                : mktime(&tm_time));
+#else
+        lastSeconds_ = static_cast<int64_t>(utc ? _mkgmtime(&tm_time)
+                                                : mktime(&tm_time));
+#endif
+        memcpy(lastSecond_, line, 17);
+        lastUtc_ = utc;
+    }
+    microSeconds = lastSeconds_ * 1000000 + toInt(line + 18, 6);
+    // The thread id and the level follow.
+    size_t pos;
+    level = Logger::parseLevel(line, len, pos);
+    return true;
+}
+
+LogIndexWriter::~LogIndexWriter()
+{
+    close();
+}
+
+bool LogIndexWriter::open(const std::string &indexFileName, uint64_t offset)
+{
+    close();
+    fp_ = fopen(indexFileName.c_str(), "a+b");
+    if (!fp_)
+        return false;
+    IndexHeader header;
+    fseek(fp_, 0, SEEK_SET);
+    bool valid = fread(&header, sizeof(header), 1, fp_) == 1 &&
+                 header.magic == kIndexMagic &&
+                 header.blockSize == sizeof(LogIndex::Block);
+    if (!valid)
+    {
+        // A new file, or not an index we can append to.
+        fp_ = freopen(indexFileName.c_str(), "wb", fp_);
+        if (!fp_)
+            return false;
+        header.magic = kIndexMagic;
+        header.version = kIndexVersion;
+        header.blockSize = sizeof(LogIndex::Block);
+        fwrite(&header, sizeof(header), 1, fp_);
+    }
+    resetBlock(block_, offset);
+    atLineStart_ = true;
+    lastTime_ = 0;
+    return true;
+}
+
+void LogIndexWriter::append(const char *data, size_t len)
+{
+    if (!fp_)
+        return;
+    while (len > 0)
+    {
+        auto nl = static_cast<const char *>(memchr(data, '\n', len));
+        size_t n = nl ? nl - data + 1 : len;
+        int64_t time;
+        int level;
+        if (atLineStart_ && parser_.parse(data, n, time, level))
+        {
+            if (time < block_.minTime)
+                block_.minTime = time;
+            if (time > block_.maxTime)
+                block_.maxTime = time;
+            lastTime_ = time;
+            if (level >= 0)
+                ++block_.counts[level];
+        }
+        block_.length += n;
+        atLineStart_ = nl != nullptr;
+        data += n;
+        len -= n;
+        if (atLineStart_ && block_.length >= interval_)
+            finishBlock();
+    }
+}
+
+void LogIndexWriter::finishBlock()
+{
+    if (block_.length == 0)
+        return;
+    if (block_.minTime > block_.maxTime)
+    {
+        // Only the continuation of the previous record.
+        block_.minTime = lastTime_;
+        block_.maxTime = lastTime_;
+    }
+    fwrite(&block_, sizeof(block_), 1, fp_);
+    resetBlock(block_, block_.offset + block_.length);
+}
+
+void LogIndexWriter::flush()
+{
+    if (fp_)
+        fflush(fp_);
+}
+
+void LogIndexWriter::close()
+{
+    if (!fp_)
+        return;
+    finishBlock();
+    fclose(fp_);
+    fp_ = nullptr;
+}
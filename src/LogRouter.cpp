@@ -0,0 +1,119 @@
+/**
+ * @file LogRouter.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogRouter.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <assert.h>
+#include <stdio.h>
+
+using namespace xiaoLog;
+
+constexpr int LogRouter::kMaxChannels;
+constexpr size_t LogRouter::kMaxLoggers;
+constexpr int LogRouter::kNoLevel;
+
+LogRouter &LogRouter::route(int channel,
+                            Logger::LogLevel minLevel,
+                            Logger::LogLevel maxLevel,
+                            AsyncFileLogger &logger)
+{
+    assert(!installed_);
+    if (channel < -1 || channel >= kMaxChannels - 1)
+    {
+        fprintf(stderr, "The channel %d can't be routed\n", channel);
+        return *this;
+    }
+    size_t index = loggerIndex(logger);
+    if (index < kMaxLoggers && minLevel <= maxLevel)
+        routes_.push_back({channel, minLevel, maxLevel, index});
+    return *this;
+}
+
+LogRouter &LogRouter::routeAllChannels(Logger::LogLevel minLevel,
+                                       Logger::LogLevel maxLevel,
+                                       AsyncFileLogger &logger)
+{
+    assert(!installed_);
+    size_t index = loggerIndex(logger);
+    if (index < kMaxLoggers && minLevel <= maxLevel)
+        routes_.push_back({kMaxChannels, minLevel, maxLevel, index});
+    return *this;
+}
+
+size_t LogRouter::loggerIndex(AsyncFileLogger &logger)
+{
+    for (size_t i = 0; i < loggers_.size(); ++i)
+    {
+        if (loggers_[i] == &logger)
+            return i;
+    }
+    if (loggers_.size() == kMaxLoggers)
+    {
+        fprintf(stderr,
+                "A router can't hold more than %zu loggers\n",
+                kMaxLoggers);
+        return kMaxLoggers;
+    }
+    loggers_.push_back(&logger);
+    return loggers_.size() - 1;
+}
+
+void LogRouter::install()
+{
+    assert(!installed_);
+    for (auto &route : routes_)
+    {
+        uint64_t bit = uint64_t(1) << route.logger;
+        size_t first = route.channel == kMaxChannels ? 0 : slot(route.channel);
+        size_t last = route.channel == kMaxChannels ? kMaxChannels - 1 : first;
+        for (size_t s = first; s <= last; ++s)
+        {
+            for (int level = route.minLevel; level <= route.maxLevel; ++level)
+                table_[s][level] |= bit;
+            if (route.minLevel == Logger::kTrace &&
+                route.maxLevel == Logger::kFatal)
+                table_[s][kNoLevel] |= bit;
+            channelLoggers_[s] |= bit;
+        }
+    }
+    installed_ = true;
+    for (int channel = -1; channel < kMaxChannels - 1; ++channel)
+    {
+        if (channelLoggers_[slot(channel)] == 0)
+            continue;
+        Logger::setRecordFunction(
+            [this](const LogRecord &record) { output(record); },
+            [this, channel]() { flush(channel); },
+            channel);
+    }
+}
+
+void LogRouter::output(const LogRecord &record)
+{
+    int level = record.level;
+    uint64_t bits =
+        table_[slot(record.channel)][level < 0 ? kNoLevel : level];
+    // Every logger gets the same bytes.
+    for (size_t i = 0; bits != 0; ++i, bits >>= 1)
+    {
+        if (bits & 1)
+            loggers_[i]->output(record.data, record.length);
+    }
+}
+
+void LogRouter::flush(int channel)
+{
+    uint64_t bits = channelLoggers_[slot(channel)];
+    for (size_t i = 0; bits != 0; ++i, bits >>= 1)
+    {
+        if (bits & 1)
+            loggers_[i]->flush();
+    }
+}
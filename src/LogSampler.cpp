@@ -0,0 +1,73 @@
+/**
+ * @file LogSampler.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogSampler.h>
+#include <string.h>
+#include <math.h>
+
+using namespace xiaoLog;
+
+constexpr int LogSampler::kMaxChannels;
+constexpr uint64_t LogSampler::kAlways;
+
+static uint64_t rateToThreshold(double rate)
+{
+    if (!(rate > 0))
+        return 0;
+    if (rate >= 1)
+        return UINT64_MAX;
+    auto threshold = ldexp(rate, 64);
+    // Rates just below 1 round up to 2^64, which doesn't fit.
+    if (threshold >= ldexp(1.0, 64))
+        return UINT64_MAX - 1;
+    return static_cast<uint64_t>(threshold);
+}
+
+void LogSampler::setRate(Logger::LogLevel level, double rate, int channel)
+{
+    thresholds_().values[row(channel)][level].store(rateToThreshold(rate),
+                                                    std::memory_order_relaxed);
+}
+
+void LogSampler::setRateOfAllChannels(Logger::LogLevel level, double rate)
+{
+    auto threshold = rateToThreshold(rate);
+    for (auto &channel : thresholds_().values)
+        channel[level].store(threshold, std::memory_order_relaxed);
+}
+
+double LogSampler::rate(Logger::LogLevel level, int channel)
+{
+    auto threshold = thresholds_().values[row(channel)][level].load(
+        std::memory_order_relaxed);
+    if (threshold == kAlways)
+        return 1;
+    return ldexp(static_cast<double>(threshold), -64);
+}
+
+uint64_t LogSampler::hash(const char *traceId, size_t len)
+{
+    uint64_t h = hash(static_cast<uint64_t>(len));
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, traceId, 8);
+        h = hash(h ^ word);
+        traceId += 8;
+        len -= 8;
+    }
+    if (len > 0)
+    {
+        uint64_t word = 0;
+        memcpy(&word, traceId, len);
+        h = hash(h ^ word);
+    }
+    return h;
+}
@@ -8,7 +8,11 @@
  *
  */
 #include <xiaoLog/Logger.h>
+#include <xiaoLog/FlightRecorder.h>
+#include <xiaoLog/LogBroadcast.h>
+#include <xiaoLog/RequestLogScope.h>
 #include <assert.h>
+#include <mutex>
 #include <thread>
 #include <iostream>
 #ifdef __unix__
@@ -74,6 +78,52 @@ namespace xiaoLog
         s.append(v.data_, v.size_);
         return s;
     }
+
+    // Tells the setter of an object used by all the logging threads when
+    // the object it replaced is no longer used. A thread counts itself in
+    // the current epoch while it uses the object. The setter publishes the
+    // new one, then moves to the next epoch twice, each time waiting for the
+    // threads of the epoch it left, new users go to the other one.
+    class UsageEpochs
+    {
+    public:
+        size_t enter()
+        {
+            size_t epoch = epoch_.load() & 1;
+            users_[epoch].fetch_add(1);
+            return epoch;
+        }
+        void leave(size_t epoch)
+        {
+            users_[epoch].fetch_sub(1, std::memory_order_release);
+        }
+        // Called by one setter at a time, after the new object is published.
+        void synchronize()
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                size_t epoch = epoch_.fetch_add(1) & 1;
+                while (users_[epoch].load(std::memory_order_acquire) != 0)
+                    std::this_thread::yield();
+            }
+        }
+
+    private:
+        std::atomic<size_t> epoch_{0};
+        std::atomic<int> users_[2]{{0}, {0}};
+    };
+
+    static UsageEpochs &recorderUsers()
+    {
+        static UsageEpochs epochs;
+        return epochs;
+    }
+
+    static UsageEpochs &broadcastUsers()
+    {
+        static UsageEpochs epochs;
+        return epochs;
+    }
 }
 
 using namespace xiaoLog;
@@ -86,6 +136,20 @@ static thread_local pid_t threadId_{0};
 static thread_local uint64_t threadId_{0};
 #endif
 
+static uint64_t currentThreadId()
+{
+#ifdef __linux__
+    if (threadId_ == 0)
+        threadId_ = static_cast<pid_t>(::syscall(SYS_gettid));
+#else
+    if (threadId_ == 0)
+    {
+        pthread_threadid_np(NULL, &threadId_);
+    }
+#endif
+    return static_cast<uint64_t>(threadId_);
+}
+
 void Logger::formatTime()
 {
     uint64_t now = static_cast<uint64_t>(date_.secondsSinceEpoch());
@@ -134,15 +198,7 @@ void Logger::formatTime()
                  static_cast<long long unsigned int>(microSec));
         logStream_ << T(tmp, 12);
     }
-#ifdef __linux__
-    if (threadId_ == 0)
-        threadId_ = static_cast<pid_t>(::syscall(SYS_gettid));
-#else
-    if (threadId_ == 0)
-    {
-        pthread_threadid_np(NULL, &threadId_);
-    }
-#endif
+    currentThreadId();
     logStream_ << threadId_;
 }
 static const char *logLevelStr[Logger::LogLevel::kNumberOfLogLevels] = {
@@ -154,14 +210,38 @@ static const char *logLevelStr[Logger::LogLevel::kNumberOfLogLevels] = {
     " FATAL ",
 };
 
+const char *Logger::levelString(LogLevel level)
+{
+    return logLevelStr[level];
+}
+
+int Logger::parseLevel(const char *msg, uint64_t len, size_t &pos)
+{
+    // YYYYMMDD HH:MM:SS.uuuuuu
+    if (len < 25 || msg[8] != ' ' || msg[17] != '.' || msg[24] != ' ')
+        return -1;
+    size_t i = len >= 29 && memcmp(msg + 24, " UTC ", 5) == 0 ? 29 : 25;
+    while (i < len && msg[i] >= '0' && msg[i] <= '9')
+        ++i;
+    if (len - i < 7)
+        return -1;
+    for (int level = 0; level < kNumberOfLogLevels; ++level)
+    {
+        if (memcmp(msg + i, logLevelStr[level], 7) == 0)
+        {
+            pos = i;
+            return level;
+        }
+    }
+    return -1;
+}
+
 Logger::Logger(SourceFile file, int line)
     : sourceFile_(file), fileLine_(line), level_(kInfo)
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
 }
 Logger::Logger(SourceFile file, int line, LogLevel level)
     : sourceFile_(file),
@@ -170,33 +250,24 @@ Logger::Logger(SourceFile file, int line, LogLevel level)
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
 }
 Logger::Logger(SourceFile file, int line, LogLevel level, const char *func)
     : sourceFile_(file),
       fileLine_(line),
-      level_(std::clamp(level, kTrace, kFatal))
-#ifdef XIAOLOG_SPDLOG_SUPPORT
-      ,
+      level_(std::clamp(level, kTrace, kFatal)),
       func_(func)
-#endif
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7) << "[" << func << "] ";
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
 }
 Logger::Logger(SourceFile file, int line, bool)
     : sourceFile_(file), fileLine_(line), level_(kFatal)
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
     if (errno != 0) // errno 是一个全局变量，用于存储最近一次系统调用的错误代码
     {
         logStream_ << strerror_tl(errno) << " (errno=" << errno << ") ";
@@ -207,25 +278,19 @@ Logger::Logger() : level_(kInfo)
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
 }
 Logger::Logger(LogLevel level) : level_(std::clamp(level, kTrace, kFatal))
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
 }
 Logger::Logger(bool) : level_(kFatal)
 {
     formatTime();
     logStream_ << T(logLevelStr[level_], 7);
-#ifdef XIAOLOG_SPDLOG_SUPPORT
     spdLogMessageOffset_ = logStream_.bufferLength();
-#endif
     if (errno != 0)
     {
         logStream_ << strerror_tl(errno) << " (errno=" << errno << ") ";
@@ -265,57 +330,180 @@ std::shared_ptr<spdlog::logger> Logger::getSpdLogger(int index)
 #endif
 }
 
-RawLogger::~RawLogger()
+void Logger::setFlightRecorder(std::shared_ptr<FlightRecorder> recorder)
 {
+    static std::mutex mutex;
+    static std::shared_ptr<FlightRecorder> current;
+    std::lock_guard<std::mutex> lock(mutex);
+    flightRecorder_().store(recorder.get());
+    // Other threads may still be writing to the old recorder.
+    recorderUsers().synchronize();
+    current = std::move(recorder);
+}
 
-#ifdef XIAOLOG_SPDLOG_SUPPORT
-
+void Logger::recordFlight(const char *msg, const uint64_t len)
+{
+#ifndef _WIN32
+    if (!flightRecorder_().load(std::memory_order_relaxed))
+        return;
+    auto epoch = recorderUsers().enter();
+    auto recorder = flightRecorder_().load();
+    if (recorder)
+        recorder->record(msg, len);
+    recorderUsers().leave(epoch);
+#else
+    (void)msg;
+    (void)len;
 #endif
+}
+
+void Logger::setLogBroadcast(std::shared_ptr<LogBroadcast> broadcast)
+{
+    static std::mutex mutex;
+    static std::shared_ptr<LogBroadcast> current;
+    std::lock_guard<std::mutex> lock(mutex);
+    logBroadcast_().store(broadcast.get());
+    // Other threads may still be publishing to the old broadcast.
+    broadcastUsers().synchronize();
+    current = std::move(broadcast);
+}
+
+void Logger::broadcastRecord(int level,
+                             int index,
+                             const char *msg,
+                             const uint64_t len)
+{
+    if (!logBroadcast_().load(std::memory_order_relaxed))
+        return;
+    auto epoch = broadcastUsers().enter();
+    auto broadcast = logBroadcast_().load();
+    if (broadcast)
+        broadcast->publish(level, index, msg, len);
+    broadcastUsers().leave(epoch);
+}
+
+void Logger::setOutputFunction(
+    std::function<void(const char *msg, const uint64_t len)> outputFunc,
+    std::function<void()> flushFunc,
+    int index)
+{
+    std::function<void(const LogRecord &record)> recordFunc;
+    if (outputFunc)
+    {
+        recordFunc = [outputFunc](const LogRecord &record) {
+            outputFunc(record.data, record.length);
+        };
+    }
+    setRecordFunction(std::move(recordFunc), std::move(flushFunc), index);
+}
+
+void Logger::setRecordFunction(
+    std::function<void(const LogRecord &record)> recordFunc,
+    std::function<void()> flushFunc,
+    int index)
+{
+    if (index < 0)
+    {
+        recordFunc_() = std::move(recordFunc);
+        flushFunc_() = std::move(flushFunc);
+    }
+    else
+    {
+        recordFunc_(index) = std::move(recordFunc);
+        flushFunc_(index) = std::move(flushFunc);
+    }
+}
+
+std::function<void(const LogRecord &record)> &Logger::recordFunc_()
+{
+    static std::function<void(const LogRecord &record)> recordFunc =
+        [](const LogRecord &record) {
+            Logger::defaultOutputFunction(record.data, record.length);
+        };
+    return recordFunc;
+}
 
-    if (index_ < 0)
+std::function<void(const LogRecord &record)> &Logger::recordFunc_(
+    size_t index)
+{
+    static std::vector<std::function<void(const LogRecord &record)>>
+        recordFuncs;
+    while (index >= recordFuncs.size())
     {
-        auto &oFunc = Logger::outputFunc_();
-        if (!oFunc)
+        recordFuncs.emplace_back(recordFunc_());
+    }
+    return recordFuncs[index];
+}
+
+void Logger::outputRecord(const LogRecord &record)
+{
+    if (record.channel < 0)
+    {
+        auto &rFunc = Logger::recordFunc_();
+        if (!rFunc)
             return;
-        oFunc(logStream_.bufferData(), logStream_.bufferLength());
+        rFunc(record);
+        if (record.level >= kError)
+            Logger::flushFunc_()();
     }
     else
     {
-        auto &oFunc = Logger::outputFunc_(index_);
-        if (!oFunc)
+        auto &rFunc = Logger::recordFunc_(record.channel);
+        if (!rFunc)
             return;
-        oFunc(logStream_.bufferData(), logStream_.bufferLength());
+        rFunc(record);
+        if (record.level >= kError)
+            Logger::flushFunc_(record.channel)();
     }
 }
 
+RawLogger::~RawLogger()
+{
+
+#ifdef XIAOLOG_SPDLOG_SUPPORT
+
+#endif
+    LogRecord record;
+    record.threadId = currentThreadId();
+    record.channel = index_;
+    record.data = logStream_.bufferData();
+    record.length = logStream_.bufferLength();
+    record.bodyLength = logStream_.bufferLength();
+    Logger::recordFlight(record.data, record.length);
+    Logger::broadcastRecord(-1, index_, record.data, record.length);
+    if (RequestLogScope::capture(record))
+        return;
+    Logger::outputRecord(record);
+}
+
 Logger::~Logger()
 {
 
 #ifdef XIAOLOG_SPDLOG_SUPPORT
 
 #endif
+    size_t bodyEnd = logStream_.bufferLength();
     if (sourceFile_.data_)
         logStream_ << T(" - ", 3) << sourceFile_ << ":" << fileLine_ << '\n';
     else
         logStream_ << '\n';
-    if (index_ < 0)
-    {
-        auto &oFunc = Logger::outputFunc_();
-        if (!oFunc)
-            return;
-        oFunc(logStream_.bufferData(), logStream_.bufferLength());
-        if (level_ >= kError)
-            Logger::flushFunc_()();
-    }
-    else
-    {
-        auto &oFunc = Logger::outputFunc_(index_);
-        if (!oFunc)
-            return;
-        oFunc(logStream_.bufferData(), logStream_.bufferLength());
-        if (level_ >= kError)
-            Logger::flushFunc_(index_)();
-    }
+    LogRecord record;
+    record.date = date_;
+    record.level = level_;
+    record.threadId = static_cast<uint64_t>(threadId_);
+    record.sourceFile = sourceFile_;
+    record.line = fileLine_;
+    record.func = func_;
+    record.channel = index_;
+    record.data = logStream_.bufferData();
+    record.length = logStream_.bufferLength();
+    record.bodyOffset = spdLogMessageOffset_;
+    record.bodyLength = bodyEnd - spdLogMessageOffset_;
+    recordFlight(record.data, record.length);
+    broadcastRecord(level_, index_, record.data, record.length);
+    if (RequestLogScope::capture(record))
+        return;
+    outputRecord(record);
 }
 LogStream &Logger::stream()
 {
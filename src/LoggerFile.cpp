@@ -0,0 +1,687 @@
+/**
+ * @file LoggerFile.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LoggerFile.h>
+#include <xiaoLog/LogIndex.h>
+#include "LogFileWriter.h"
+#if !defined(_WIN32) || defined(__MINGW32__)
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#else
+#include <windows.h>
+#endif
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <algorithm>
+#include <iostream>
+#include <functional>
+#ifdef XIAOLOG_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+namespace xiaoLog
+{
+    extern const char *strerror_tl(int savedErrno);
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+#if !defined(_WIN32) || defined(__MINGW32__)
+using NameFilter = std::function<bool(const std::string &)>;
+
+// Count the files in dir which pass the filter, and their total size.
+static size_t directoryFiles(const std::string &dir,
+                             const NameFilter &filter,
+                             uint64_t &size)
+{
+    size_t count = 0;
+    size = 0;
+    DIR *dp = opendir(dir.c_str());
+    if (dp == nullptr)
+        return 0;
+    struct dirent *dirp;
+    struct stat st;
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        if (!filter(name))
+            continue;
+        std::string fullname = dir + name;
+        if (stat(fullname.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+        {
+            size += static_cast<uint64_t>(st.st_size);
+            ++count;
+        }
+    }
+    closedir(dp);
+    return count;
+}
+
+// Remove the files in dir which pass the filter, and dir itself once no
+// other files are left in it.
+static int removeDirectory(const std::string &dir, const NameFilter &filter)
+{
+    DIR *dp = opendir(dir.c_str());
+    if (dp == nullptr)
+        return -1;
+    struct dirent *dirp;
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        if (filter(name))
+            remove((dir + name).c_str());
+    }
+    closedir(dp);
+    if (rmdir(dir.c_str()) != 0 && errno != ENOTEMPTY && errno != EEXIST)
+        return -1;
+    return 0;
+}
+#endif
+
+LoggerFile::LoggerFile(const std::string &filePath,
+                       const std::string &fileBaseName,
+                       const std::string &fileExtName,
+                       bool switchOnLimitOnly,
+                       size_t maxFiles,
+                       WriteMode writeMode)
+    : writer_(LogFileWriter::newWriter(writeMode)),
+      creationDate_(Date::date()),
+      filePath_(filePath),
+      fileBaseName_(fileBaseName),
+      fileExtName_(fileExtName),
+      switchOnLimitOnly_(switchOnLimitOnly),
+      writeMode_(writeMode),
+      maxFiles_(maxFiles)
+{
+    open();
+
+    if (maxFiles_ > 0)
+    {
+        initFilenameQueue();
+    }
+}
+
+void LoggerFile::open()
+{
+    creationDate_ = Date::date();
+    updateRotationTime();
+    fileFullName_ = filePath_ + fileBaseName_ + fileExtName_;
+    writer_->setDictionary(frameDictionary_);
+    if (!writer_->open(fileFullName_))
+    {
+        std::cout << strerror_tl(errno) << std::endl;
+    }
+    openIndex();
+}
+
+void LoggerFile::setFrameDictionary(const std::string &dictionary)
+{
+    frameDictionary_ = std::make_shared<const std::string>(dictionary);
+    writer_->setDictionary(frameDictionary_);
+}
+
+void LoggerFile::setIndexInterval(uint64_t bytes)
+{
+    indexInterval_ = bytes;
+    openIndex();
+}
+
+void LoggerFile::openIndex()
+{
+    if (indexInterval_ == 0 || !writer_->isOpen())
+    {
+        indexWriter_.reset();
+        return;
+    }
+    indexWriter_.reset(new LogIndexWriter(indexInterval_));
+    if (!indexWriter_->open(LogIndex::indexFileName(fileFullName_),
+                            writer_->rawLength()))
+    {
+        fprintf(stderr,
+                "Failed to open the index of %s: %s\n",
+                fileFullName_.c_str(),
+                strerror_tl(errno));
+        indexWriter_.reset();
+    }
+}
+
+LoggerFile::operator bool() const
+{
+    return writer_->isOpen();
+}
+
+uint64_t LoggerFile::fileSeq_{0};
+void LoggerFile::writeLog(const StringPtr buf)
+{
+    writer_->write(buf->c_str(), buf->length());
+    unsyncedBytes_ += buf->length();
+    if (indexWriter_)
+        indexWriter_->append(buf->c_str(), buf->length());
+}
+
+void LoggerFile::flush()
+{
+    writer_->flush();
+    if (indexWriter_)
+        indexWriter_->flush();
+    if (syncPolicy_ == SyncPolicy::kPeriodic && unsyncedBytes_ > 0)
+    {
+        bool noThreshold = syncBytes_ == 0 && syncInterval_.count() == 0;
+        if (noThreshold || (syncBytes_ > 0 && unsyncedBytes_ >= syncBytes_) ||
+            (syncInterval_.count() > 0 &&
+             std::chrono::steady_clock::now() - lastSyncTime_ >= syncInterval_))
+        {
+            sync();
+        }
+    }
+    else if (syncPolicy_ == SyncPolicy::kWriteBehind)
+    {
+        writer_->writeBehind();
+    }
+}
+
+void LoggerFile::sync()
+{
+    writer_->sync();
+    unsyncedBytes_ = 0;
+    lastSyncTime_ = std::chrono::steady_clock::now();
+}
+
+uint64_t LoggerFile::getLength()
+{
+    return writer_->length();
+}
+
+void LoggerFile::switchLog(bool openNewOne)
+{
+    if (writer_->isOpen())
+    {
+        if (syncPolicy_ == SyncPolicy::kPeriodic && unsyncedBytes_ > 0)
+            sync();
+        std::string newName = archiveName();
+        if (indexWriter_)
+        {
+            indexWriter_.reset();
+#if !defined(_WIN32) || defined(__MINGW32__)
+            rename(LogIndex::indexFileName(fileFullName_).c_str(),
+                   LogIndex::indexFileName(newName).c_str());
+#else
+#endif
+        }
+        if (housekeepingThreadPtr_)
+        {
+            // The open file follows the rename, so it can still be closed by
+            // the housekeeping thread after the next file has taken its name.
+#if !defined(_WIN32) || defined(__MINGW32__)
+            rename(fileFullName_.c_str(), newName.c_str());
+#else
+#endif
+            std::unique_ptr<LogFileWriter> next;
+            {
+                std::lock_guard<std::mutex> lock(housekeepingMutex_);
+                rotatedFiles_.emplace_back(std::move(writer_), newName);
+                if (openNewOne)
+                    next = std::move(nextWriter_);
+                // Rename before the housekeeping thread can open the next
+                // file again under the same name.
+#if !defined(_WIN32) || defined(__MINGW32__)
+                if (next)
+                    rename(nextFileName_.c_str(), fileFullName_.c_str());
+#else
+#endif
+            }
+            housekeepingCond_.notify_one();
+            if (next)
+            {
+                writer_ = std::move(next);
+                writer_->setDictionary(frameDictionary_);
+                creationDate_ = Date::date();
+                updateRotationTime();
+                openIndex();
+            }
+            else
+            {
+                writer_ = LogFileWriter::newWriter(writeMode_);
+                if (openNewOne)
+                    open();
+            }
+            return;
+        }
+
+        writer_->close();
+#if !defined(_WIN32) || defined(__MINGW32__)
+        rename(fileFullName_.c_str(), newName.c_str());
+#else
+#endif
+        archive(nullptr, newName);
+        if (openNewOne)
+            open();
+    }
+}
+
+std::string LoggerFile::formatDate(const char *fmt) const
+{
+    if (rotationPeriod_ != RotationPeriod::kNone && !rotateInLocalTime_)
+        return creationDate_.toCustomFormattedString(fmt);
+    return creationDate_.toCustomFormattedStringLocal(fmt);
+}
+
+std::string LoggerFile::archiveName()
+{
+    char seq[12];
+    snprintf(seq,
+             sizeof(seq),
+             ".%06llu",
+             static_cast<long long unsigned int>(fileSeq_ % 1000000));
+    ++fileSeq_;
+
+    std::string dir = filePath_;
+    if (directoryPerDay_)
+    {
+        dir += formatDate("%Y%m%d") + "/";
+        if (dir != lastDayDirectory_)
+        {
+#if !defined(_WIN32) || defined(__MINGW32__)
+            mkdir(dir.c_str(), 0755);
+#else
+#endif
+            lastDayDirectory_ = dir;
+        }
+    }
+    return dir + fileBaseName_ + "." + formatDate("%y%m%d-%H%M%S") +
+           std::string(seq) + fileExtName_;
+}
+
+void LoggerFile::setRotationPeriod(RotationPeriod period, bool localTime)
+{
+    rotationPeriod_ = period;
+    rotateInLocalTime_ = localTime;
+    updateRotationTime();
+}
+
+void LoggerFile::updateRotationTime()
+{
+    if (rotationPeriod_ == RotationPeriod::kNone)
+    {
+        nextRotationTime_ = INT64_MAX;
+        return;
+    }
+    int64_t seconds = creationDate_.secondsSinceEpoch();
+    int64_t next;
+    if (!rotateInLocalTime_)
+    {
+        int64_t period =
+            rotationPeriod_ == RotationPeriod::kHourly ? 3600 : 24 * 3600;
+        next = (seconds / period + 1) * period;
+    }
+    else
+    {
+        // Let mktime() deal with DST changes and odd time zone offsets.
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm_time;
+#ifndef _WIN32
+        localtime_r(&t, &tm_time);
+#else
+#endif
+        tm_time.tm_min = 0;
+        tm_time.tm_sec = 0;
+        if (rotationPeriod_ == RotationPeriod::kHourly)
+        {
+            tm_time.tm_hour += 1;
+        }
+        else
+        {
+            tm_time.tm_hour = 0;
+            tm_time.tm_mday += 1;
+        }
+        tm_time.tm_isdst = -1;
+        next = static_cast<int64_t>(mktime(&tm_time));
+    }
+    nextRotationTime_ = next * MICRO_SECONDS_PRE_SEC;
+}
+
+void LoggerFile::setDirectoryPerDay(bool flag)
+{
+    if (directoryPerDay_ == flag)
+        return;
+    directoryPerDay_ = flag;
+    // The queue holds directories instead of files now, scan again.
+    filenameQueueInited_ = false;
+    filenameQueue_.clear();
+    totalSize_ = 0;
+}
+
+void LoggerFile::archive(std::unique_ptr<LogFileWriter> writer,
+                         const std::string &fileName)
+{
+    if (writer)
+        writer->close();
+    std::string name = fileName;
+    // Framed files are compressed already.
+    if (compress_ && writeMode_ != WriteMode::kFramed &&
+        compressFile(fileName, fileName + ".gz"))
+        name += ".gz";
+    if (!retentionEnabled())
+        return;
+    if (!filenameQueueInited_)
+    {
+        // The scan picks up the file we have just archived.
+        initFilenameQueue();
+        return;
+    }
+    ArchivedFile file{name, 0, Date::now().secondsSinceEpoch()};
+#if !defined(_WIN32) || defined(__MINGW32__)
+    struct stat st;
+    if (stat(name.c_str(), &st) == 0)
+        file.size = static_cast<uint64_t>(st.st_size);
+#endif
+    totalSize_ += file.size;
+    if (directoryPerDay_)
+    {
+        file.name.erase(file.name.rfind('/') + 1);
+        if (!filenameQueue_.empty() && filenameQueue_.back().name == file.name)
+        {
+            filenameQueue_.back().size += file.size;
+            filenameQueue_.back().mtime = file.mtime;
+            deleteOldFiles();
+            return;
+        }
+    }
+    filenameQueue_.push_back(std::move(file));
+    deleteOldFiles();
+}
+
+bool LoggerFile::hasCompressionSupport()
+{
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LoggerFile::compressFile(const std::string &fileName,
+                              const std::string &gzName)
+{
+#ifdef XIAOLOG_ZLIB_SUPPORT
+    FILE *in = fopen(fileName.c_str(), "rb");
+    if (!in)
+        return false;
+    gzFile out = gzopen(gzName.c_str(), "wb");
+    if (!out)
+    {
+        fclose(in);
+        return false;
+    }
+    constexpr size_t kChunkSize{256 * 1024};
+    std::unique_ptr<char[]> buf(new char[kChunkSize]);
+    bool ok = true;
+    size_t n;
+    while ((n = fread(buf.get(), 1, kChunkSize, in)) > 0)
+    {
+        if (gzwrite(out, buf.get(), static_cast<unsigned>(n)) !=
+            static_cast<int>(n))
+        {
+            ok = false;
+            break;
+        }
+    }
+    if (ferror(in))
+        ok = false;
+    fclose(in);
+    if (gzclose(out) != Z_OK)
+        ok = false;
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to compress file %s\n", fileName.c_str());
+        remove(gzName.c_str());
+        return false;
+    }
+    remove(fileName.c_str());
+    return true;
+#else
+    (void)fileName;
+    (void)gzName;
+    return false;
+#endif
+}
+
+void LoggerFile::setAsyncHousekeeping(bool flag)
+{
+    if (!flag)
+    {
+        stopHousekeeping();
+        return;
+    }
+    if (housekeepingThreadPtr_)
+        return;
+    nextFileName_ = filePath_ + fileBaseName_ + fileExtName_ + ".next";
+    housekeepingStop_ = false;
+    housekeepingThreadPtr_ = std::unique_ptr<std::thread>(new std::thread(
+        std::bind(&LoggerFile::housekeepingThreadFunc, this)));
+}
+
+void LoggerFile::housekeepingThreadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "LogHousekeeper");
+#endif
+    if (retentionEnabled() && !filenameQueueInited_)
+        initFilenameQueue();
+    std::vector<std::pair<std::unique_ptr<LogFileWriter>, std::string>> files;
+    while (true)
+    {
+        bool needNext;
+        {
+            std::lock_guard<std::mutex> lock(housekeepingMutex_);
+            needNext = !nextWriter_ && !housekeepingStop_;
+        }
+        if (needNext)
+        {
+            auto writer = LogFileWriter::newWriter(writeMode_);
+            if (writer->open(nextFileName_))
+            {
+                std::lock_guard<std::mutex> lock(housekeepingMutex_);
+                nextWriter_ = std::move(writer);
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(housekeepingMutex_);
+            housekeepingCond_.wait(lock, [this]() {
+                return housekeepingStop_ || !rotatedFiles_.empty();
+            });
+            if (rotatedFiles_.empty())
+                break;
+            files.swap(rotatedFiles_);
+        }
+        for (auto &file : files)
+        {
+            archive(std::move(file.first), file.second);
+        }
+        files.clear();
+    }
+}
+
+void LoggerFile::stopHousekeeping()
+{
+    if (!housekeepingThreadPtr_)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(housekeepingMutex_);
+        housekeepingStop_ = true;
+    }
+    housekeepingCond_.notify_all();
+    housekeepingThreadPtr_->join();
+    housekeepingThreadPtr_.reset();
+    if (nextWriter_)
+    {
+        nextWriter_->close();
+        nextWriter_.reset();
+        remove(nextFileName_.c_str());
+    }
+}
+
+LoggerFile::~LoggerFile()
+{
+    if (!switchOnLimitOnly_)
+        switchLog(false);
+    stopHousekeeping();
+    indexWriter_.reset();
+    writer_->close();
+}
+
+void LoggerFile::initFilenameQueue()
+{
+    filenameQueueInited_ = true;
+    if (!retentionEnabled())
+    {
+        return;
+    }
+    std::vector<ArchivedFile> files;
+#if !defined(_WIN32) || defined(__MINGW32__)
+    DIR *dp;
+    struct dirent *dirp;
+    struct stat st;
+
+    if ((dp = opendir(filePath_.c_str())) == nullptr)
+    {
+        fprintf(stderr,
+                "Can't open dir %s: %s\n",
+                filePath_.c_str(),
+                strerror_tl(errno));
+        return;
+    }
+
+    auto isArchive = [this](const std::string &name) {
+        return isArchiveName(name, false);
+    };
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        if (directoryPerDay_)
+        {
+            // Other loggers may share the day directories, only the files
+            // of this one count.
+            std::string fullname = filePath_ + name + "/";
+            uint64_t size;
+            if (name.size() != 8 ||
+                !std::all_of(name.begin(), name.end(), ::isdigit) ||
+                stat(fullname.c_str(), &st) == -1 || !S_ISDIR(st.st_mode) ||
+                directoryFiles(fullname, isArchive, size) == 0)
+            {
+                continue;
+            }
+            files.push_back({std::move(fullname),
+                             size,
+                             static_cast<int64_t>(st.st_mtime)});
+            continue;
+        }
+        if (!isArchive(name))
+        {
+            continue;
+        }
+        std::string fullname = filePath_ + name;
+        if (stat(fullname.c_str(), &st) == -1)
+        {
+            fprintf(stderr,
+                    "Can't stat file %s: %s\n",
+                    fullname.c_str(),
+                    strerror_tl(errno));
+            continue;
+        }
+        if (!S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+        files.push_back({std::move(fullname),
+                         static_cast<uint64_t>(st.st_size),
+                         static_cast<int64_t>(st.st_mtime)});
+    }
+    closedir(dp);
+#else
+#endif
+    // The names contain the creation time, so they sort from the oldest.
+    std::sort(files.begin(),
+              files.end(),
+              [](const ArchivedFile &a, const ArchivedFile &b) {
+                  return a.name < b.name;
+              });
+    filenameQueue_.clear();
+    totalSize_ = 0;
+    for (auto &file : files)
+    {
+        totalSize_ += file.size;
+        filenameQueue_.push_back(std::move(file));
+    }
+    deleteOldFiles();
+}
+
+bool LoggerFile::isArchiveName(const std::string &name, bool withIndex) const
+{
+    // fileBaseName_.yymmdd-hhmmss.nnnnnn fileExtName_
+    const size_t nameSize = fileBaseName_.size() + 21 + fileExtName_.size();
+    if (name.size() < nameSize ||
+        name.compare(0, fileBaseName_.size(), fileBaseName_) != 0 ||
+        name.compare(nameSize - fileExtName_.size(),
+                     fileExtName_.size(),
+                     fileExtName_) != 0)
+    {
+        return false;
+    }
+    if (name.size() == nameSize)
+        return true;
+    if (name.size() == nameSize + 3)
+        return name.compare(nameSize, 3, ".gz") == 0;
+    return withIndex && name.size() == nameSize + 4 &&
+           name.compare(nameSize, 4, ".idx") == 0;
+}
+
+void LoggerFile::deleteOldFiles()
+{
+    int64_t deadline = maxAge_.count() > 0
+                           ? Date::now().secondsSinceEpoch() - maxAge_.count()
+                           : 0;
+    while (!filenameQueue_.empty() &&
+           ((maxFiles_ > 0 && filenameQueue_.size() > maxFiles_) ||
+            (maxTotalSize_ > 0 && totalSize_ > maxTotalSize_) ||
+            filenameQueue_.front().mtime < deadline))
+    {
+        ArchivedFile file = std::move(filenameQueue_.front());
+        filenameQueue_.pop_front();
+        totalSize_ -= file.size;
+        const std::string &filename = file.name;
+#if !defined(_WIN32) || defined(__MINGW32__)
+        int r = filename.back() == '/'
+                    ? removeDirectory(filename,
+                                      [this](const std::string &name) {
+                                          return isArchiveName(name, true);
+                                      })
+                    : remove(filename.c_str());
+        if (filename.back() != '/')
+            remove(LogIndex::indexFileName(filename).c_str());
+#else
+        // Convert UTF-8 file to UCS-2
+        auto wName{utils::toNativePath(filename)};
+        int r = _wremove(wName.c_str());
+#endif
+        if (r != 0)
+        {
+            fprintf(stderr,
+                    "Failed to remove file %s: %s\n",
+                    filename.c_str(),
+                    strerror_tl(errno));
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file PipeSink.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/PipeSink.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdio.h>
+
+namespace xiaoLog
+{
+    extern const char *strerror_tl(int savedErrno);
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+std::shared_ptr<PipeSink> PipeSink::open(int fd, size_t pipeSize)
+{
+    if (fd < 0)
+        return nullptr;
+    std::shared_ptr<PipeSink> sink(new PipeSink(fd, false));
+    sink->setPipeSize(pipeSize);
+    return sink;
+}
+
+std::shared_ptr<PipeSink> PipeSink::openFifo(const std::string &path,
+                                             size_t pipeSize)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr,
+                "Failed to open %s: %s\n",
+                path.c_str(),
+                strerror_tl(errno));
+        return nullptr;
+    }
+    std::shared_ptr<PipeSink> sink(new PipeSink(fd, true));
+    sink->setPipeSize(pipeSize);
+    return sink;
+}
+
+PipeSink::PipeSink(int fd, bool ownFd) : fd_(fd), ownFd_(ownFd)
+{
+    struct stat st;
+    isPipe_ = fstat(fd_, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+void PipeSink::setPipeSize(size_t pipeSize)
+{
+    if (pipeSize > 0 && isPipe_ &&
+        fcntl(fd_, F_SETPIPE_SZ, static_cast<int>(pipeSize)) < 0)
+        fprintf(stderr,
+                "Failed to resize the pipe: %s\n",
+                strerror_tl(errno));
+}
+
+PipeSink::~PipeSink()
+{
+    if (ownFd_)
+        ::close(fd_);
+}
+
+void PipeSink::write(const StringPtr &buf)
+{
+    if (failed_ || buf->empty())
+        return;
+    writeAll(buf->data(), buf->size());
+}
+
+void PipeSink::writeAll(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd_, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // EPIPE: the reader is gone, the rest of the logs is lost.
+            fprintf(stderr,
+                    "Failed to write to the pipe: %s\n",
+                    strerror_tl(errno));
+            failed_ = true;
+            return;
+        }
+        writtenBytes_.fetch_add(static_cast<uint64_t>(n),
+                                std::memory_order_relaxed);
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+#endif
@@ -0,0 +1,175 @@
+/**
+ * @file RequestLogScope.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/RequestLogScope.h>
+#include <xiaoLog/Logger.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace xiaoLog
+{
+    // The fields of a held record, its text follows. The strings of the
+    // source file and of the function are static.
+    struct HeldRecordHeader
+    {
+        int64_t microSeconds;
+        uint64_t threadId;
+        const char *sourceFile;
+        const char *func;
+        uint32_t len;
+        int32_t level;
+        int32_t index;
+        int32_t sourceFileSize;
+        int32_t line;
+        uint32_t bodyOffset;
+        uint32_t bodyLength;
+    };
+
+    /**
+     * @brief The records held on a thread, reused by its scopes. Only the
+     * end of the data is reset between requests, the memory stays.
+     *
+     */
+    struct HeldRecords
+    {
+        std::vector<char> data;
+        size_t used{0};
+        size_t maxSize{0};
+        RequestLogScope *scope{nullptr};
+    };
+
+    static thread_local HeldRecords heldRecords;
+    static std::atomic<uint64_t> droppedHeldRecords{0};
+}  // namespace xiaoLog
+
+using namespace xiaoLog;
+
+RequestLogScope::RequestLogScope(std::chrono::microseconds latencyThreshold,
+                                 size_t maxBufferSize)
+    : start_(std::chrono::steady_clock::now()),
+      latencyThreshold_(latencyThreshold)
+{
+    auto &held = heldRecords;
+    if (held.scope)
+        return;
+    held.scope = this;
+    held.used = 0;
+    held.maxSize = maxBufferSize;
+    active_ = true;
+}
+
+RequestLogScope::~RequestLogScope()
+{
+    if (!active_)
+        return;
+    if (failed_ ||
+        std::chrono::steady_clock::now() - start_ > latencyThreshold_)
+        commit();
+    heldRecords.used = 0;
+    heldRecords.scope = nullptr;
+}
+
+void RequestLogScope::commit()
+{
+    if (!active_)
+        return;
+    failed_ = true;
+    auto &held = heldRecords;
+    // Records logged by the output functions are not held.
+    held.scope = nullptr;
+    size_t pos = 0;
+    while (pos < held.used)
+    {
+        HeldRecordHeader header;
+        memcpy(&header, held.data.data() + pos, sizeof(header));
+        pos += sizeof(header);
+        LogRecord record;
+        record.date = Date(header.microSeconds);
+        record.level = header.level;
+        record.threadId = header.threadId;
+        record.sourceFile.data_ = header.sourceFile;
+        record.sourceFile.size_ = header.sourceFileSize;
+        record.line = header.line;
+        record.func = header.func;
+        record.channel = header.index;
+        record.data = held.data.data() + pos;
+        record.length = header.len;
+        record.bodyOffset = header.bodyOffset;
+        record.bodyLength = header.bodyLength;
+        Logger::outputRecord(record);
+        pos += header.len;
+    }
+    held.used = 0;
+    held.scope = this;
+}
+
+void RequestLogScope::discard()
+{
+    if (active_)
+        heldRecords.used = 0;
+}
+
+uint64_t RequestLogScope::droppedRecords()
+{
+    return droppedHeldRecords.load(std::memory_order_relaxed);
+}
+
+bool RequestLogScope::capture(const LogRecord &record)
+{
+    auto &held = heldRecords;
+    if (!held.scope)
+        return false;
+    auto level = record.level;
+    auto len = record.length;
+    if (level >= Logger::kError)
+        held.scope->failed_ = true;
+    auto need = sizeof(HeldRecordHeader) + static_cast<size_t>(len);
+    if (held.used + need > held.maxSize)
+    {
+        if (level >= Logger::kError)
+        {
+            // An error is never dropped, the held records go out before it
+            // and the error is output by the caller.
+            held.scope->commit();
+            return false;
+        }
+        droppedHeldRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        if (held.data.size() < held.used + need)
+            held.data.resize(
+                (std::min)(held.maxSize,
+                           (std::max)(held.data.size() * 2, held.used + need)));
+        HeldRecordHeader header;
+        header.microSeconds = record.date.microSecondsSinceEpoch();
+        header.threadId = record.threadId;
+        header.sourceFile = record.sourceFile.data_;
+        header.func = record.func;
+        header.len = static_cast<uint32_t>(len);
+        header.level = level;
+        header.index = record.channel;
+        header.sourceFileSize = record.sourceFile.size_;
+        header.line = record.line;
+        header.bodyOffset = static_cast<uint32_t>(record.bodyOffset);
+        header.bodyLength = static_cast<uint32_t>(record.bodyLength);
+        memcpy(held.data.data() + held.used, &header, sizeof(header));
+        memcpy(held.data.data() + held.used + sizeof(header),
+               record.data,
+               static_cast<size_t>(len));
+        held.used += need;
+    }
+    // The process may not survive a fatal error.
+    if (level >= Logger::kFatal)
+        held.scope->commit();
+    return true;
+}
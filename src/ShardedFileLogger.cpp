@@ -0,0 +1,128 @@
+/**
+ * @file ShardedFileLogger.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/ShardedFileLogger.h>
+#include <xiaoLog/Date.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <algorithm>
+#include <thread>
+
+using namespace xiaoLog;
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static bool parseHex(const char *data, size_t len, uint64_t &value)
+{
+    value = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        int v = hexValue(data[i]);
+        if (v < 0)
+            return false;
+        value = (value << 4) | static_cast<uint64_t>(v);
+    }
+    return true;
+}
+
+ShardedFileLogger::ShardedFileLogger(size_t shardNum, ShardBy shardBy)
+    : sequence_(std::make_shared<std::atomic<uint64_t>>(
+          // Starting at the current time keeps the files of successive runs
+          // in order as long as a run logs less than a record per
+          // microsecond on average.
+          static_cast<uint64_t>(Date::now().microSecondsSinceEpoch()))),
+      shardBy_(shardBy)
+{
+    if (shardNum == 0)
+        shardNum = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < shardNum; ++i)
+    {
+        shards_.emplace_back(new AsyncFileLogger);
+        shards_.back()->setRecordSequence(sequence_);
+    }
+    setFileName("xiaoLog");
+}
+
+void ShardedFileLogger::setFileName(const std::string &baseName,
+                                    const std::string &extName,
+                                    const std::string &path)
+{
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        shards_[i]->setFileName(baseName + "." + std::to_string(i),
+                                extName,
+                                path);
+    }
+}
+
+size_t ShardedFileLogger::shardIndex() const
+{
+#ifdef __linux__
+    if (shardBy_ == ShardBy::kCpu)
+    {
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+            return static_cast<size_t>(cpu) % shards_.size();
+    }
+#endif
+    static std::atomic<size_t> threadCounter{0};
+    thread_local size_t threadIndex = threadCounter.fetch_add(1);
+    return threadIndex % shards_.size();
+}
+
+void ShardedFileLogger::output(const char *msg, const uint64_t len)
+{
+    shards_[shardIndex()]->output(msg, len);
+}
+
+void ShardedFileLogger::flush()
+{
+    for (auto &shard : shards_)
+    {
+        shard->flush();
+    }
+}
+
+void ShardedFileLogger::flushAndWait(bool sync)
+{
+    std::vector<std::future<void>> futures;
+    for (auto &shard : shards_)
+    {
+        futures.push_back(shard->flushAsync(sync));
+    }
+    for (auto &future : futures)
+    {
+        future.wait();
+    }
+}
+
+void ShardedFileLogger::startLogging()
+{
+    for (auto &shard : shards_)
+    {
+        shard->startLogging();
+    }
+}
+
+bool ShardedFileLogger::parseRecordHeader(const char *data,
+                                          uint64_t &seq,
+                                          uint64_t &len)
+{
+    return parseHex(data, 16, seq) && data[16] == ' ' &&
+           parseHex(data + 17, 8, len) && data[25] == ' ';
+}
@@ -0,0 +1,383 @@
+/**
+ * @file SharedLogRing.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/SharedLogRing.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <chrono>
+
+namespace xiaoLog
+{
+    static constexpr uint64_t kRingMagic{0x78696167526e6731ULL};
+    // Records start on 4 byte boundaries, so the length never wraps. The
+    // rings are cache line aligned.
+    static constexpr uint64_t kRecordAlign{4};
+    static constexpr uint64_t kRingAlign{64};
+
+    struct SharedHeader
+    {
+        uint64_t magic;
+        uint64_t ringSize;
+        uint64_t ringNum;
+        std::atomic<int32_t> collector;
+    };
+
+    struct RingHeader
+    {
+        alignas(64) std::atomic<int32_t> owner;
+        std::atomic<uint64_t> dropped;
+        alignas(64) std::atomic<uint64_t> writePos;
+        alignas(64) std::atomic<uint64_t> readPos;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                  "The ring needs address-free atomics");
+
+    static constexpr size_t kHeaderSize{(sizeof(SharedHeader) + 63) / 64 * 64};
+    extern const char *strerror_tl(int savedErrno);
+} // namespace xiaoLog
+
+using namespace xiaoLog;
+
+static bool processAlive(int pid)
+{
+    return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+std::shared_ptr<SharedLogRing> SharedLogRing::create(const std::string &name,
+                                                     size_t ringSize,
+                                                     size_t ringNum)
+{
+    int fd;
+    if (name.empty())
+    {
+#ifdef __linux__
+        fd = memfd_create("xiaoLog", MFD_CLOEXEC);
+#else
+        errno = ENOSYS;
+        fd = -1;
+#endif
+    }
+    else
+    {
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0)
+    {
+        fprintf(stderr,
+                "Failed to create the shared log ring: %s\n",
+                strerror_tl(errno));
+        return nullptr;
+    }
+    ringSize = (ringSize + kRingAlign - 1) / kRingAlign * kRingAlign;
+    std::shared_ptr<SharedLogRing> ring(new SharedLogRing);
+    if (!ring->map(fd, true, ringSize, ringNum))
+        return nullptr;
+    return ring;
+}
+
+std::shared_ptr<SharedLogRing> SharedLogRing::attach(const std::string &name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr,
+                "Failed to attach the shared log ring: %s\n",
+                strerror_tl(errno));
+        return nullptr;
+    }
+    std::shared_ptr<SharedLogRing> ring(new SharedLogRing);
+    if (!ring->map(fd, false, 0, 0))
+        return nullptr;
+    return ring;
+}
+
+void SharedLogRing::unlink(const std::string &name)
+{
+    shm_unlink(name.c_str());
+}
+
+bool SharedLogRing::map(int fd, bool init, size_t ringSize, size_t ringNum)
+{
+    fd_ = fd;
+    if (!init)
+    {
+        // magic, ringSize and ringNum.
+        uint64_t header[3];
+        if (pread(fd_, header, sizeof(header), 0) !=
+                static_cast<ssize_t>(sizeof(header)) ||
+            header[0] != kRingMagic)
+        {
+            fprintf(stderr, "Not a shared log ring\n");
+            return false;
+        }
+        ringSize = header[1];
+        ringNum = header[2];
+    }
+    mapSize_ = kHeaderSize + ringNum * (sizeof(RingHeader) + ringSize);
+    if (init && ftruncate(fd_, static_cast<off_t>(mapSize_)) != 0)
+    {
+        fprintf(stderr,
+                "Failed to size the shared log ring: %s\n",
+                strerror_tl(errno));
+        return false;
+    }
+    void *addr =
+        mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+    {
+        fprintf(stderr,
+                "Failed to map the shared log ring: %s\n",
+                strerror_tl(errno));
+        return false;
+    }
+    base_ = static_cast<char *>(addr);
+    if (init)
+    {
+        // The new file is zero filled, which is a valid empty state.
+        auto header = reinterpret_cast<SharedHeader *>(base_);
+        header->ringSize = ringSize;
+        header->ringNum = ringNum;
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = kRingMagic;
+    }
+    return true;
+}
+
+SharedLogRing::~SharedLogRing()
+{
+    if (base_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ring_ >= 0 && pid_ == getpid())
+        {
+            auto header = reinterpret_cast<SharedHeader *>(base_);
+            auto ring = reinterpret_cast<RingHeader *>(
+                base_ + kHeaderSize +
+                ring_ * (sizeof(RingHeader) + header->ringSize));
+            // The collector reclaims the ring once it's drained.
+            int pid = pid_;
+            ring->owner.compare_exchange_strong(pid, -pid);
+        }
+        munmap(base_, mapSize_);
+    }
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+int SharedLogRing::ownRing()
+{
+    int pid = getpid();
+    if (ring_ >= 0 && pid_ == pid)
+        return ring_;
+    // A forked child doesn't inherit the ring of its parent.
+    pid_ = pid;
+    ring_ = -1;
+    auto header = reinterpret_cast<SharedHeader *>(base_);
+    for (uint64_t i = 0; i < header->ringNum; ++i)
+    {
+        auto ring = reinterpret_cast<RingHeader *>(
+            base_ + kHeaderSize + i * (sizeof(RingHeader) + header->ringSize));
+        int expected = 0;
+        if (ring->owner.compare_exchange_strong(expected,
+                                                pid,
+                                                std::memory_order_acquire))
+        {
+            ring_ = static_cast<int>(i);
+            break;
+        }
+    }
+    return ring_;
+}
+
+void SharedLogRing::output(const char *msg, const uint64_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int index = ownRing();
+    if (index < 0)
+        return;
+    auto header = reinterpret_cast<SharedHeader *>(base_);
+    uint64_t size = header->ringSize;
+    auto ring = reinterpret_cast<RingHeader *>(
+        base_ + kHeaderSize + index * (sizeof(RingHeader) + size));
+    auto data = reinterpret_cast<char *>(ring + 1);
+    uint64_t need = (sizeof(uint32_t) + len + kRecordAlign - 1) /
+                    kRecordAlign * kRecordAlign;
+    uint64_t writePos = ring->writePos.load(std::memory_order_relaxed);
+    uint64_t readPos = ring->readPos.load(std::memory_order_acquire);
+    if (len > UINT32_MAX || need > size - (writePos - readPos))
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t recordLen = static_cast<uint32_t>(len);
+    memcpy(data + writePos % size, &recordLen, sizeof(recordLen));
+    uint64_t offset = (writePos + sizeof(recordLen)) % size;
+    uint64_t first = std::min<uint64_t>(len, size - offset);
+    memcpy(data + offset, msg, first);
+    memcpy(data, msg + first, len - first);
+    ring->writePos.store(writePos + need, std::memory_order_release);
+}
+
+size_t SharedLogRing::drain(
+    const std::function<void(const char *, uint64_t)> &func)
+{
+    auto header = reinterpret_cast<SharedHeader *>(base_);
+    uint64_t size = header->ringSize;
+    size_t count = 0;
+    // Look for dead producers once a second, not a syscall per poll.
+    auto now = std::chrono::steady_clock::now();
+    bool checkOwners = now - lastOwnerCheck_ >= std::chrono::seconds(1);
+    if (checkOwners)
+        lastOwnerCheck_ = now;
+    for (uint64_t i = 0; i < header->ringNum; ++i)
+    {
+        auto ring = reinterpret_cast<RingHeader *>(
+            base_ + kHeaderSize + i * (sizeof(RingHeader) + size));
+        int owner = ring->owner.load(std::memory_order_acquire);
+        if (owner == 0)
+            continue;
+        // A negative owner released the ring. A dead owner may have been in
+        // the middle of a record which was never published. Either way the
+        // write cursor doesn't move any more.
+        bool gone = owner < 0 || (checkOwners && !processAlive(owner));
+        auto data = reinterpret_cast<char *>(ring + 1);
+        uint64_t readPos = ring->readPos.load(std::memory_order_relaxed);
+        uint64_t writePos = ring->writePos.load(std::memory_order_acquire);
+        while (readPos < writePos)
+        {
+            uint32_t len;
+            memcpy(&len, data + readPos % size, sizeof(len));
+            uint64_t offset = (readPos + sizeof(len)) % size;
+            if (offset + len <= size)
+            {
+                func(data + offset, len);
+            }
+            else
+            {
+                tmpRecord_.assign(data + offset, size - offset);
+                tmpRecord_.append(data, len - (size - offset));
+                func(tmpRecord_.data(), len);
+            }
+            readPos += (sizeof(len) + len + kRecordAlign - 1) / kRecordAlign *
+                       kRecordAlign;
+            ++count;
+        }
+        ring->readPos.store(readPos, std::memory_order_release);
+        auto dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            char logErr[128];
+            auto strlen =
+                snprintf(logErr,
+                         sizeof(logErr),
+                         "%llu log information is lost\n",
+                         static_cast<long long unsigned int>(dropped));
+            func(logErr, strlen);
+        }
+        if (gone)
+        {
+            ring->owner.compare_exchange_strong(owner,
+                                                0,
+                                                std::memory_order_release);
+        }
+    }
+    return count;
+}
+
+bool SharedLogRing::tryBecomeCollector()
+{
+    auto header = reinterpret_cast<SharedHeader *>(base_);
+    int pid = getpid();
+    int collector = header->collector.load(std::memory_order_acquire);
+    if (collector == pid)
+        return true;
+    if (collector != 0 && processAlive(collector))
+        return false;
+    return header->collector.compare_exchange_strong(collector,
+                                                     pid,
+                                                     std::memory_order_acq_rel);
+}
+
+void SharedLogRing::releaseCollector()
+{
+    auto header = reinterpret_cast<SharedHeader *>(base_);
+    int pid = getpid();
+    header->collector.compare_exchange_strong(pid, 0);
+}
+
+SharedLogCollector::SharedLogCollector(std::shared_ptr<SharedLogRing> ring)
+    : ring_(std::move(ring))
+{
+}
+
+SharedLogCollector::~SharedLogCollector()
+{
+    stopFlag_ = true;
+    if (threadPtr_)
+    {
+        threadPtr_->join();
+        if (ring_->tryBecomeCollector())
+        {
+            ring_->drain([this](const char *msg, uint64_t len) {
+                fileLogger_.output(msg, len);
+            });
+            ring_->releaseCollector();
+        }
+    }
+}
+
+void SharedLogCollector::startCollecting()
+{
+    fileLogger_.startLogging();
+    threadPtr_ = std::unique_ptr<std::thread>(new std::thread(
+        std::bind(&SharedLogCollector::collectThreadFunc, this)));
+}
+
+void SharedLogCollector::collectThreadFunc()
+{
+#ifdef __linux__
+    prctl(PR_SET_NAME, "LogCollector");
+#endif
+    // Producers don't make syscalls, so the rings are polled with a backoff.
+    constexpr std::chrono::microseconds kMinSleep{100};
+    constexpr std::chrono::microseconds kMaxSleep{10000};
+    constexpr std::chrono::milliseconds kElectionInterval{100};
+    auto sleepTime = kMinSleep;
+    while (!stopFlag_)
+    {
+        if (!ring_->tryBecomeCollector())
+        {
+            std::this_thread::sleep_for(kElectionInterval);
+            continue;
+        }
+        auto count = ring_->drain([this](const char *msg, uint64_t len) {
+            fileLogger_.output(msg, len);
+        });
+        if (count > 0)
+        {
+            sleepTime = kMinSleep;
+            continue;
+        }
+        std::this_thread::sleep_for(sleepTime);
+        sleepTime = std::min(sleepTime * 2, kMaxSleep);
+    }
+}
+#endif
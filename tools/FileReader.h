@@ -0,0 +1,184 @@
+/**
+ * @file FileReader.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/FramedLog.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef XIAOLOG_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+namespace xiaoLog
+{
+    /**
+     * @brief A buffered reader for the command line tools. Files of the
+     * FramedLog format, and rotated files compressed with gzip if the tools
+     * are built with zlib, are read transparently.
+     *
+     */
+    class FileReader
+    {
+    public:
+        FileReader() : buf_(kBufferSize)
+        {
+        }
+        ~FileReader()
+        {
+            close();
+        }
+        FileReader(const FileReader &) = delete;
+        FileReader &operator=(const FileReader &) = delete;
+
+        bool open(const std::string &fileName)
+        {
+            close();
+            if (FramedLog::isFramed(fileName))
+            {
+                framed_.reset(new FramedLogReader);
+                rawOffset_ = 0;
+                return framed_->open(fileName);
+            }
+#ifdef XIAOLOG_ZLIB_SUPPORT
+            file_ = gzopen(fileName.c_str(), "rb");
+#else
+            file_ = fopen(fileName.c_str(), "rb");
+#endif
+            return file_ != nullptr;
+        }
+
+        void close()
+        {
+            if (file_)
+            {
+#ifdef XIAOLOG_ZLIB_SUPPORT
+                gzclose(file_);
+#else
+                fclose(file_);
+#endif
+                file_ = nullptr;
+            }
+            framed_.reset();
+            begin_ = end_ = 0;
+        }
+
+        /**
+         * @brief Read exactly len bytes.
+         *
+         * @return false at the end of the file.
+         */
+        bool read(char *data, size_t len)
+        {
+            while (len > 0)
+            {
+                if (begin_ == end_ && !fill())
+                    return false;
+                size_t n = std::min(len, end_ - begin_);
+                memcpy(data, buf_.data() + begin_, n);
+                begin_ += n;
+                data += n;
+                len -= n;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Read up to and including the next '\n'.
+         *
+         * @return false if nothing is left.
+         */
+        bool readLine(std::string &line)
+        {
+            line.clear();
+            while (true)
+            {
+                if (begin_ == end_ && !fill())
+                    return !line.empty();
+                auto start = buf_.data() + begin_;
+                auto nl = static_cast<const char *>(
+                    memchr(start, '\n', end_ - begin_));
+                size_t n = nl ? nl - start + 1 : end_ - begin_;
+                line.append(start, n);
+                begin_ += n;
+                if (nl)
+                    return true;
+            }
+        }
+
+        /**
+         * @brief Look at the next len bytes without consuming them.
+         *
+         * @return nullptr if fewer bytes are left.
+         */
+        const char *peek(size_t len)
+        {
+            if (end_ - begin_ < len)
+            {
+                memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+                end_ -= begin_;
+                begin_ = 0;
+                while (end_ < len)
+                {
+                    auto n = readSome(buf_.data() + end_, buf_.size() - end_);
+                    if (n <= 0)
+                        return nullptr;
+                    end_ += static_cast<size_t>(n);
+                }
+            }
+            return buf_.data() + begin_;
+        }
+
+    private:
+        static constexpr size_t kBufferSize{256 * 1024};
+
+        long readSome(char *data, size_t len)
+        {
+            if (framed_)
+            {
+                auto n = framed_->pread(data, len, rawOffset_);
+                rawOffset_ += n;
+                return static_cast<long>(n);
+            }
+#ifdef XIAOLOG_ZLIB_SUPPORT
+            return gzread(file_, data, static_cast<unsigned>(len));
+#else
+            return static_cast<long>(fread(data, 1, len, file_));
+#endif
+        }
+
+        bool fill()
+        {
+            if (!file_ && !framed_)
+                return false;
+            auto n = readSome(buf_.data(), buf_.size());
+            if (n <= 0)
+                return false;
+            begin_ = 0;
+            end_ = static_cast<size_t>(n);
+            return true;
+        }
+
+#ifdef XIAOLOG_ZLIB_SUPPORT
+        gzFile file_{nullptr};
+#else
+        FILE *file_{nullptr};
+#endif
+        std::unique_ptr<FramedLogReader> framed_;
+        uint64_t rawOffset_{0};
+        std::vector<char> buf_;
+        size_t begin_{0};
+        size_t end_{0};
+    };
+}
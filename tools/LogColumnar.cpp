@@ -0,0 +1,398 @@
+/**
+ * @file LogColumnar.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Convert log files to the columnar format of ColumnarLogWriter and
+ * scan columnar files, reading only the row groups and the columns a query
+ * needs.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/ColumnarLog.h>
+#include <xiaoLog/Date.h>
+#include "FileReader.h"
+#include "LogFilter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+static const char *const kColumnNames[ColumnarLog::kNumberOfColumns] =
+    {"time", "level", "tid", "file", "line", "channel", "message"};
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s export [-c channel] [-g rows] -o output file...\n"
+            "       %s cat [--from time] [--to time] [--local] "
+            "[--level level] [--channel n] [-f columns] [-o output] file...\n"
+            "       %s stats file...\n"
+            "  export  convert log files (plain, gzip or framed) to a "
+            "columnar file, their records go to the channel given by -c\n"
+            "  cat     print the records of columnar files, as log lines or "
+            "as the tab separated columns given by -f, e.g. -f "
+            "time,level,message; row groups are skipped by their "
+            "statistics\n"
+            "  stats   print the row groups and the size of every column\n",
+            prog,
+            prog,
+            prog);
+}
+
+static FILE *openOutput(const char *outputName)
+{
+    if (!outputName)
+        return stdout;
+    FILE *out = fopen(outputName, "wb");
+    if (!out)
+        fprintf(stderr, "Can't open %s: %s\n", outputName, strerror(errno));
+    return out;
+}
+
+static int exportFiles(const std::vector<const char *> &files,
+                       const char *outputName,
+                       int channel,
+                       size_t rowGroupSize)
+{
+    ColumnarLogWriter writer(rowGroupSize);
+    if (!writer.open(outputName))
+        return 1;
+    LogLineParser parser;
+    std::string line;
+    std::string record;
+    int64_t time;
+    int level;
+    for (auto name : files)
+    {
+        FileReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "Can't open %s: %s\n", name, strerror(errno));
+            return 1;
+        }
+        // A record ends where the next one starts, so continuation lines
+        // stay in its message.
+        while (reader.readLine(line))
+        {
+            if (parser.parse(line.data(), line.size(), time, level) &&
+                !record.empty())
+            {
+                writer.output(record.data(), record.size(), channel);
+                record.clear();
+            }
+            record += line;
+        }
+        if (!record.empty())
+        {
+            writer.output(record.data(), record.size(), channel);
+            record.clear();
+        }
+    }
+    writer.close();
+    return 0;
+}
+
+struct CatOptions
+{
+    int64_t from{INT64_MIN};
+    int64_t to{INT64_MAX};
+    int level{-1};
+    bool hasChannel{false};
+    int32_t channel{-1};
+    std::vector<int> columns;
+};
+
+static void printRecord(FILE *out,
+                        const ColumnarLogReader::Columns &columns,
+                        size_t i)
+{
+    auto level = columns.levels[i];
+    std::string text = Date(columns.times[i]).toFormattedString(true);
+    fprintf(out,
+            "%s UTC %llu %-5s %s",
+            text.c_str(),
+            static_cast<long long unsigned int>(columns.tids[i]),
+            level < LogIndex::kNumberOfLevels ? kLevelNames[level] : "",
+            columns.messages[i].c_str());
+    if (!columns.files[i].empty())
+        fprintf(out,
+                " - %s:%u",
+                columns.files[i].c_str(),
+                columns.lines[i]);
+    fputc('\n', out);
+}
+
+static void printColumns(FILE *out,
+                         const ColumnarLogReader::Columns &columns,
+                         size_t i,
+                         const std::vector<int> &selected)
+{
+    for (size_t c = 0; c < selected.size(); ++c)
+    {
+        if (c > 0)
+            fputc('\t', out);
+        switch (selected[c])
+        {
+            case ColumnarLog::kTime:
+                fputs(Date(columns.times[i]).toFormattedString(true).c_str(),
+                      out);
+                break;
+            case ColumnarLog::kLevel:
+                if (columns.levels[i] < LogIndex::kNumberOfLevels)
+                    fputs(kLevelNames[columns.levels[i]], out);
+                break;
+            case ColumnarLog::kTid:
+                fprintf(out,
+                        "%llu",
+                        static_cast<long long unsigned int>(columns.tids[i]));
+                break;
+            case ColumnarLog::kFile:
+                fputs(columns.files[i].c_str(), out);
+                break;
+            case ColumnarLog::kLine:
+                fprintf(out, "%u", columns.lines[i]);
+                break;
+            case ColumnarLog::kChannel:
+                fprintf(out, "%d", columns.channels[i]);
+                break;
+            case ColumnarLog::kMessage:
+                fputs(columns.messages[i].c_str(), out);
+                break;
+        }
+    }
+    fputc('\n', out);
+}
+
+static int catFiles(const std::vector<const char *> &files,
+                    FILE *out,
+                    const CatOptions &options)
+{
+    unsigned mask = 0;
+    if (options.columns.empty())
+        mask = ColumnarLog::kAllColumns & ~(1u << ColumnarLog::kChannel);
+    for (auto column : options.columns)
+        mask |= 1u << column;
+    if (options.from != INT64_MIN || options.to != INT64_MAX)
+        mask |= 1u << ColumnarLog::kTime;
+    if (options.level >= 0)
+        mask |= 1u << ColumnarLog::kLevel;
+    if (options.hasChannel)
+        mask |= 1u << ColumnarLog::kChannel;
+    ColumnarLogReader::Columns columns;
+    for (auto name : files)
+    {
+        ColumnarLogReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "%s is not a columnar log file\n", name);
+            return 1;
+        }
+        auto &groups = reader.rowGroups();
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            auto &group = groups[g];
+            if (group.maxTime < options.from || group.minTime > options.to ||
+                (options.level >= 0 && (group.maxLevel < options.level ||
+                                        group.minLevel == ColumnarLog::kNoLevel)) ||
+                (options.hasChannel && (group.minChannel > options.channel ||
+                                        group.maxChannel < options.channel)))
+                continue;
+            if (!reader.read(g, columns, mask))
+            {
+                fprintf(stderr,
+                        "%s: corrupted row group at offset %llu\n",
+                        name,
+                        static_cast<long long unsigned int>(group.offset));
+                return 1;
+            }
+            for (size_t i = 0; i < group.rows; ++i)
+            {
+                if ((mask & (1u << ColumnarLog::kTime)) &&
+                    (columns.times[i] < options.from ||
+                     columns.times[i] > options.to))
+                    continue;
+                if (options.level >= 0 &&
+                    (columns.levels[i] < options.level ||
+                     columns.levels[i] == ColumnarLog::kNoLevel))
+                    continue;
+                if (options.hasChannel &&
+                    columns.channels[i] != options.channel)
+                    continue;
+                if (options.columns.empty())
+                    printRecord(out, columns, i);
+                else
+                    printColumns(out, columns, i, options.columns);
+            }
+        }
+    }
+    return 0;
+}
+
+static int stats(const std::vector<const char *> &files, FILE *out)
+{
+    for (auto name : files)
+    {
+        ColumnarLogReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "%s is not a columnar log file\n", name);
+            return 1;
+        }
+        uint64_t rows = 0;
+        uint64_t sizes[ColumnarLog::kNumberOfColumns]{0};
+        fprintf(out, "%s:\n", name);
+        for (auto &group : reader.rowGroups())
+        {
+            fprintf(out,
+                    "  offset %llu rows %u time %s - %s level %d - %d "
+                    "channel %d - %d\n",
+                    static_cast<long long unsigned int>(group.offset),
+                    group.rows,
+                    Date(group.minTime).toFormattedString(true).c_str(),
+                    Date(group.maxTime).toFormattedString(true).c_str(),
+                    group.minLevel == ColumnarLog::kNoLevel ? -1
+                                                            : group.minLevel,
+                    group.maxLevel == ColumnarLog::kNoLevel ? -1
+                                                            : group.maxLevel,
+                    group.minChannel,
+                    group.maxChannel);
+            rows += group.rows;
+            for (int i = 0; i < ColumnarLog::kNumberOfColumns; ++i)
+                sizes[i] += group.columnLengths[i];
+        }
+        fprintf(out,
+                "  %zu row groups, %llu rows\n",
+                reader.rowGroups().size(),
+                static_cast<long long unsigned int>(rows));
+        for (int i = 0; i < ColumnarLog::kNumberOfColumns; ++i)
+            fprintf(out,
+                    "  %-8s %llu bytes\n",
+                    kColumnNames[i],
+                    static_cast<long long unsigned int>(sizes[i]));
+    }
+    return 0;
+}
+
+static bool parseColumns(const char *str, std::vector<int> &columns)
+{
+    std::string list(str);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        auto comma = list.find(',', pos);
+        if (comma == std::string::npos)
+            comma = list.size();
+        auto name = list.substr(pos, comma - pos);
+        int column = -1;
+        for (int i = 0; i < ColumnarLog::kNumberOfColumns; ++i)
+        {
+            if (name == kColumnNames[i])
+                column = i;
+        }
+        if (column < 0)
+            return false;
+        columns.push_back(column);
+        pos = comma + 1;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+    const char *outputName = nullptr;
+    const char *from = nullptr;
+    const char *to = nullptr;
+    bool local = false;
+    int channel = -1;
+    size_t rowGroupSize = 64 * 1024;
+    CatOptions options;
+    std::vector<const char *> files;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-o") == 0 && hasValue)
+            outputName = argv[++i];
+        else if (strcmp(argv[i], "-c") == 0 && hasValue)
+            channel = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-g") == 0 && hasValue)
+            rowGroupSize =
+                static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--from") == 0 && hasValue)
+            from = argv[++i];
+        else if (strcmp(argv[i], "--to") == 0 && hasValue)
+            to = argv[++i];
+        else if (strcmp(argv[i], "--local") == 0)
+            local = true;
+        else if (strcmp(argv[i], "--level") == 0 && hasValue)
+        {
+            options.level = parseLevelName(argv[++i]);
+            if (options.level < 0)
+            {
+                fprintf(stderr, "Unknown level %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--channel") == 0 && hasValue)
+        {
+            options.hasChannel = true;
+            options.channel = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && hasValue)
+        {
+            if (!parseColumns(argv[++i], options.columns))
+            {
+                fprintf(stderr, "Unknown columns %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+    if ((from && !parseFilterTime(from, local, false, options.from)) ||
+        (to && !parseFilterTime(to, local, true, options.to)))
+    {
+        fprintf(stderr, "Wrong time format\n");
+        return 1;
+    }
+    if (files.empty() || rowGroupSize == 0 ||
+        (command == "export" && !outputName))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (command == "export")
+        return exportFiles(files, outputName, channel, rowGroupSize);
+    FILE *out = openOutput(outputName);
+    if (!out)
+        return 1;
+    int ret;
+    if (command == "cat")
+        ret = catFiles(files, out, options);
+    else if (command == "stats")
+        ret = stats(files, out);
+    else
+    {
+        usage(argv[0]);
+        ret = 1;
+    }
+    if (out != stdout)
+        fclose(out);
+    return ret;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file LogFilter.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <xiaoLog/LogIndex.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <string>
+
+namespace xiaoLog
+{
+    static const char *const kLevelNames[LogIndex::kNumberOfLevels] =
+        {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+    /**
+     * @brief Parse a time argument of the command line tools,
+     * "YYYYMMDD HH:MM[:SS[.uuuuuu]]" or "YYYY-MM-DD HH:MM[:SS]". An upper
+     * bound covers the whole last unit, e.g. a minute.
+     *
+     * @param str
+     * @param local Whether the time is a local time or UTC.
+     * @param upper
+     * @param time Microseconds since epoch.
+     * @return false if the format is wrong.
+     */
+    inline bool parseFilterTime(const char *str,
+                                bool local,
+                                bool upper,
+                                int64_t &time)
+    {
+        std::string digits;
+        for (auto p = str; *p; ++p)
+        {
+            if (*p >= '0' && *p <= '9')
+                digits += *p;
+            else if (!strchr("-: T.", *p))
+                return false;
+        }
+        if (digits.size() < 12 || digits.size() == 13 || digits.size() > 20)
+            return false;
+        struct tm tm_time;
+        memset(&tm_time, 0, sizeof(tm_time));
+        tm_time.tm_year = std::stoi(digits.substr(0, 4)) - 1900;
+        tm_time.tm_mon = std::stoi(digits.substr(4, 2)) - 1;
+        tm_time.tm_mday = std::stoi(digits.substr(6, 2));
+        tm_time.tm_hour = std::stoi(digits.substr(8, 2));
+        tm_time.tm_min = std::stoi(digits.substr(10, 2));
+        int64_t unit = 60 * 1000000LL;
+        int64_t micro = 0;
+        if (digits.size() >= 14)
+        {
+            tm_time.tm_sec = std::stoi(digits.substr(12, 2));
+            unit = 1000000;
+            if (digits.size() > 14)
+            {
+                std::string frac = digits.substr(14);
+                unit = 1;
+                for (size_t i = frac.size(); i < 6; ++i)
+                    unit *= 10;
+                micro = std::stoll(frac) * unit;
+            }
+        }
+        tm_time.tm_isdst = -1;
+#ifndef _WIN32
+        time_t seconds = local ? mktime(&tm_time) : timegm(&tm_time);
+#else
+        time_t seconds = local ? mktime(&tm_time) : _mkgmtime(&tm_time);
+#endif
+        time = static_cast<int64_t>(seconds) * 1000000 + micro;
+        if (upper)
+            time += unit - 1;
+        return true;
+    }
+
+    /**
+     * @brief Parse a level name, in any case.
+     *
+     * @param str
+     * @return The level, or a negative value if the name is unknown.
+     */
+    inline int parseLevelName(const char *str)
+    {
+        std::string name;
+        for (auto p = str; *p; ++p)
+            name += static_cast<char>(toupper(static_cast<unsigned char>(*p)));
+        for (int i = 0; i < LogIndex::kNumberOfLevels; ++i)
+        {
+            if (name == kLevelNames[i])
+                return i;
+        }
+        return -2;
+    }
+}
@@ -0,0 +1,194 @@
+/**
+ * @file LogFrame.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Decompress, inspect and train dictionaries for the frame-compressed
+ * log files written with LoggerFile::WriteMode::kFramed.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/FramedLog.h>
+#include "FileReader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s cat [-o output] [--offset n] [--length n] file...\n"
+            "       %s info file...\n"
+            "       %s train [-s size] -o dictionary sample...\n"
+            "  cat    print the uncompressed log, or a range of it; only the "
+            "frames of the range are decompressed\n"
+            "  info   print the frames of the files and the compression ratio\n"
+            "  train  build a dictionary for "
+            "AsyncFileLogger::setFrameDictionary() from sample logs\n",
+            prog,
+            prog,
+            prog);
+}
+
+static FILE *openOutput(const char *outputName)
+{
+    if (!outputName)
+        return stdout;
+    FILE *out = fopen(outputName, "wb");
+    if (!out)
+        fprintf(stderr, "Can't open %s: %s\n", outputName, strerror(errno));
+    return out;
+}
+
+static int catFiles(const std::vector<const char *> &files,
+                    FILE *out,
+                    uint64_t offset,
+                    uint64_t length)
+{
+    std::vector<char> buf(1024 * 1024);
+    for (auto name : files)
+    {
+        FramedLogReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "%s is not a framed log file\n", name);
+            return 1;
+        }
+        uint64_t pos = offset;
+        uint64_t end = reader.rawSize();
+        if (pos < end && length < end - pos)
+            end = pos + length;
+        while (pos < end)
+        {
+            auto n = reader.pread(buf.data(),
+                                  static_cast<size_t>(std::min<uint64_t>(
+                                      buf.size(), end - pos)),
+                                  pos);
+            if (n == 0)
+            {
+                fprintf(stderr,
+                        "%s: corrupted frame at offset %llu\n",
+                        name,
+                        static_cast<long long unsigned int>(pos));
+                return 1;
+            }
+            fwrite(buf.data(), 1, n, out);
+            pos += n;
+        }
+    }
+    return 0;
+}
+
+static int info(const std::vector<const char *> &files, FILE *out)
+{
+    for (auto name : files)
+    {
+        FramedLogReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "%s is not a framed log file\n", name);
+            return 1;
+        }
+        fprintf(out,
+                "%s: %zu frames, %llu bytes, %llu uncompressed (%.1fx)\n",
+                name,
+                reader.frames().size(),
+                static_cast<long long unsigned int>(reader.fileSize()),
+                static_cast<long long unsigned int>(reader.rawSize()),
+                reader.fileSize() > 0
+                    ? static_cast<double>(reader.rawSize()) / reader.fileSize()
+                    : 0.0);
+        for (auto &frame : reader.frames())
+        {
+            fprintf(out,
+                    "  file offset %llu, log offset %llu\n",
+                    static_cast<long long unsigned int>(frame.fileOffset),
+                    static_cast<long long unsigned int>(frame.rawOffset));
+        }
+    }
+    return 0;
+}
+
+static int train(const std::vector<const char *> &files, FILE *out, size_t size)
+{
+    std::string samples;
+    for (auto name : files)
+    {
+        FileReader reader;
+        if (!reader.open(name))
+        {
+            fprintf(stderr, "Can't open %s: %s\n", name, strerror(errno));
+            return 1;
+        }
+        std::string line;
+        while (reader.readLine(line))
+            samples += line;
+    }
+    auto dictionary = FramedLog::trainDictionary(samples, size);
+    fwrite(dictionary.data(), 1, dictionary.size(), out);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+    const char *outputName = nullptr;
+    uint64_t offset = 0;
+    uint64_t length = UINT64_MAX;
+    size_t size = 32 * 1024;
+    std::vector<const char *> files;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-o") == 0 && hasValue)
+            outputName = argv[++i];
+        else if (strcmp(argv[i], "--offset") == 0 && hasValue)
+            offset = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--length") == 0 && hasValue)
+            length = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-s") == 0 && hasValue)
+            size = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty() || (command == "train" && !outputName))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    FILE *out = openOutput(outputName);
+    if (!out)
+        return 1;
+    int ret;
+    if (command == "cat")
+        ret = catFiles(files, out, offset, length);
+    else if (command == "info")
+        ret = info(files, out);
+    else if (command == "train")
+        ret = train(files, out, size);
+    else
+    {
+        usage(argv[0]);
+        ret = 1;
+    }
+    if (out != stdout)
+        fclose(out);
+    return ret;
+}
@@ -0,0 +1,538 @@
+/**
+ * @file LogGrep.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Search the current and the rotated log files in parallel, with
+ * level and time filters, and print the matching lines in time order.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogIndex.h>
+#include <xiaoLog/FramedLog.h>
+#include "FileReader.h"
+#include "LogFilter.h"
+#include "StringSearch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xiaoLog;
+
+namespace
+{
+    constexpr uint64_t kChunkSize{8 * 1024 * 1024};
+    // How far back a continuation line looks for the line with the time.
+    constexpr uint64_t kMaxLookBack{1024 * 1024};
+
+    struct Options
+    {
+        std::unique_ptr<StringSearch> search;
+        int64_t from{INT64_MIN};
+        int64_t to{INT64_MAX};
+        int minLevel{-1};
+        bool count{false};
+        bool fileNames{false};
+
+        bool filtered() const
+        {
+            return from != INT64_MIN || to != INT64_MAX || minLevel >= 0;
+        }
+    };
+
+    struct InputFile
+    {
+        std::string name;
+        // Mapped plain files are split into chunks, other files are read
+        // by one thread.
+        const char *data{nullptr};
+        uint64_t size{0};
+    };
+
+    struct Match
+    {
+        int64_t time;
+        size_t offset;
+        size_t len;
+    };
+
+    struct Task
+    {
+        size_t file;
+        uint64_t begin;
+        uint64_t end;
+        std::string text;
+        std::vector<Match> matches;
+        uint64_t count{0};
+    };
+
+    /**
+     * @brief The time and the level of the record a line belongs to.
+     *
+     */
+    struct Record
+    {
+        LogLineParser parser;
+        int64_t time{INT64_MIN};
+        int level{-1};
+        bool known{false};
+
+        bool update(const char *line, size_t len)
+        {
+            int64_t lineTime;
+            int lineLevel;
+            if (!parser.parse(line, len, lineTime, lineLevel))
+                return false;
+            time = lineTime;
+            level = lineLevel;
+            known = true;
+            return true;
+        }
+    };
+
+    class Grep
+    {
+    public:
+        Grep(const Options &options, const std::vector<InputFile> &files)
+            : options_(options), files_(files)
+        {
+        }
+
+        void run(Task &task)
+        {
+            auto &file = files_[task.file];
+            if (file.data)
+                grepMapped(file, task);
+            else
+                grepStream(file, task);
+        }
+
+    private:
+        bool accepts(const Record &record) const
+        {
+            if (!options_.filtered())
+                return true;
+            return record.known && record.time >= options_.from &&
+                   record.time <= options_.to &&
+                   (options_.minLevel < 0 || record.level >= options_.minLevel);
+        }
+
+        void emit(Task &task,
+                  const Record &record,
+                  const char *line,
+                  size_t len)
+        {
+            ++task.count;
+            if (options_.count)
+                return;
+            size_t offset = task.text.size();
+            if (options_.fileNames)
+            {
+                task.text += files_[task.file].name;
+                task.text += ':';
+            }
+            task.text.append(line, len);
+            if (len == 0 || line[len - 1] != '\n')
+                task.text += '\n';
+            task.matches.push_back(
+                {record.time, offset, task.text.size() - offset});
+        }
+
+        static const char *lineStart(const char *begin, const char *pos)
+        {
+            if (pos == begin)
+                return begin;
+#ifdef __GLIBC__
+            auto nl = static_cast<const char *>(
+                memrchr(begin, '\n', static_cast<size_t>(pos - begin)));
+            return nl ? nl + 1 : begin;
+#else
+            while (pos > begin && pos[-1] != '\n')
+                --pos;
+            return pos;
+#endif
+        }
+
+        /**
+         * @brief Find the record of a continuation line in the lines before
+         * it, which may be before the chunk.
+         *
+         */
+        static void lookBack(const InputFile &file,
+                             const char *line,
+                             Record &record)
+        {
+            const char *limit =
+                static_cast<uint64_t>(line - file.data) > kMaxLookBack
+                    ? line - kMaxLookBack
+                    : file.data;
+            while (line > limit)
+            {
+                auto start = lineStart(limit, line - 1);
+                if (record.update(start, static_cast<size_t>(line - start)))
+                    return;
+                line = start;
+            }
+        }
+
+        void grepMapped(const InputFile &file, Task &task)
+        {
+            const char *pos = file.data + task.begin;
+            const char *end = file.data + task.end;
+            Record record;
+            const auto &search = *options_.search;
+            if (search.pattern().empty())
+            {
+                // Only the filters, every line is looked at.
+                bool first = true;
+                while (pos < end)
+                {
+                    auto nl = static_cast<const char *>(
+                        memchr(pos, '\n', static_cast<size_t>(end - pos)));
+                    auto lineEnd = nl ? nl + 1 : end;
+                    size_t len = static_cast<size_t>(lineEnd - pos);
+                    if (!record.update(pos, len) && first)
+                        lookBack(file, pos, record);
+                    first = false;
+                    if (accepts(record))
+                        emit(task, record, pos, len);
+                    pos = lineEnd;
+                }
+                return;
+            }
+            while (pos < end)
+            {
+                auto found =
+                    search.find(pos, static_cast<size_t>(end - pos));
+                if (!found)
+                    break;
+                auto start = lineStart(pos, found);
+                auto nl = static_cast<const char *>(
+                    memchr(found, '\n', static_cast<size_t>(end - found)));
+                auto lineEnd = nl ? nl + 1 : end;
+                size_t len = static_cast<size_t>(lineEnd - start);
+                record.known = false;
+                record.time = INT64_MIN;
+                if (!record.update(start, len))
+                    lookBack(file, start, record);
+                if (accepts(record))
+                    emit(task, record, start, len);
+                pos = lineEnd;
+            }
+        }
+
+        void grepStream(const InputFile &file, Task &task)
+        {
+            FileReader reader;
+            if (!reader.open(file.name))
+            {
+                fprintf(stderr,
+                        "Can't open %s: %s\n",
+                        file.name.c_str(),
+                        strerror(errno));
+                return;
+            }
+            Record record;
+            const auto &search = *options_.search;
+            std::string line;
+            while (reader.readLine(line))
+            {
+                record.update(line.data(), line.size());
+                if (accepts(record) && search.find(line.data(), line.size()))
+                    emit(task, record, line.data(), line.size());
+            }
+        }
+
+        const Options &options_;
+        const std::vector<InputFile> &files_;
+    };
+
+    struct Later
+    {
+        const std::vector<Task> *tasks;
+        const std::vector<size_t> *cursors;
+        bool operator()(size_t a, size_t b) const
+        {
+            auto timeA = (*tasks)[a].matches[(*cursors)[a]].time;
+            auto timeB = (*tasks)[b].matches[(*cursors)[b]].time;
+            return timeA != timeB ? timeA > timeB : a > b;
+        }
+    };
+} // namespace
+
+static bool isLogFile(const std::string &name, const std::string &baseName)
+{
+    return name.compare(0, baseName.size(), baseName) == 0 &&
+           (name.size() < 4 || name.compare(name.size() - 4, 4, ".idx") != 0) &&
+           (name.size() < 5 || name.compare(name.size() - 5, 5, ".next") != 0);
+}
+
+/**
+ * @brief Add the log files of a directory, including the directories per
+ * day (YYYYMMDD) of the rotated files.
+ *
+ */
+static void addDirectory(const std::string &dir,
+                         const std::string &baseName,
+                         bool topLevel,
+                         std::vector<std::string> &names)
+{
+#ifndef _WIN32
+    DIR *dp = opendir(dir.c_str());
+    if (!dp)
+        return;
+    struct dirent *dirp;
+    struct stat st;
+    std::vector<std::string> found;
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        std::string fullname = dir + "/" + name;
+        if (name == "." || name == ".." || stat(fullname.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+        {
+            if (topLevel && name.size() == 8 &&
+                std::all_of(name.begin(), name.end(), ::isdigit))
+                addDirectory(fullname, baseName, false, names);
+        }
+        else if (S_ISREG(st.st_mode) && isLogFile(name, baseName))
+        {
+            found.push_back(std::move(fullname));
+        }
+    }
+    closedir(dp);
+    std::sort(found.begin(), found.end());
+    names.insert(names.end(), found.begin(), found.end());
+#else
+    (void)dir;
+    (void)baseName;
+    (void)topLevel;
+    (void)names;
+#endif
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] pattern file|directory...\n"
+            "Search the log files for a fixed string in parallel and print "
+            "the matching lines in time order. Directories are searched for "
+            "the files of a logger, including rotated files in the "
+            "directories per day. Files compressed with gzip or framed are "
+            "read by one thread each, plain files are split between "
+            "threads.\n"
+            "  -b name       only the files of the directories starting with "
+            "this base name\n"
+            "  -j threads    the number of threads, the CPUs by default\n"
+            "  --from time   the first time, \"YYYYMMDD HH:MM[:SS[.uuuuuu]]\" "
+            "or \"YYYY-MM-DD HH:MM[:SS]\"\n"
+            "  --to time     the last time, the whole last minute or second "
+            "is included\n"
+            "  --local       the times are local times, not UTC\n"
+            "  --level name  only records of this level or higher\n"
+            "  -c            print the number of matching lines\n"
+            "  -H            print the file name of each line\n"
+            "An empty pattern matches every line, e.g. to filter by time.\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    const char *pattern = nullptr;
+    const char *fromStr = nullptr;
+    const char *toStr = nullptr;
+    bool local = false;
+    std::string baseName;
+    unsigned threadNum = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--from") == 0 && hasValue)
+            fromStr = argv[++i];
+        else if (strcmp(argv[i], "--to") == 0 && hasValue)
+            toStr = argv[++i];
+        else if (strcmp(argv[i], "--local") == 0)
+            local = true;
+        else if (strcmp(argv[i], "--level") == 0 && hasValue)
+        {
+            options.minLevel = parseLevelName(argv[++i]);
+            if (options.minLevel < 0)
+            {
+                fprintf(stderr, "Unknown level %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "-b") == 0 && hasValue)
+            baseName = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && hasValue)
+            threadNum = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "-c") == 0)
+            options.count = true;
+        else if (strcmp(argv[i], "-H") == 0)
+            options.fileNames = true;
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else if (!pattern)
+            pattern = argv[i];
+        else
+            paths.push_back(argv[i]);
+    }
+    if (!pattern || paths.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if ((fromStr && !parseFilterTime(fromStr, local, false, options.from)) ||
+        (toStr && !parseFilterTime(toStr, local, true, options.to)))
+    {
+        fprintf(stderr, "Bad time, see the usage with --help\n");
+        return 2;
+    }
+    options.search.reset(new StringSearch(pattern));
+
+    std::vector<std::string> names;
+    for (auto &path : paths)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            addDirectory(path, baseName, true, names);
+        else
+            names.push_back(path);
+    }
+
+    std::vector<InputFile> files;
+    std::vector<Task> tasks;
+    for (auto &name : names)
+    {
+        InputFile file;
+        file.name = name;
+        bool plain = name.size() < 3 ||
+                     name.compare(name.size() - 3, 3, ".gz") != 0;
+        plain = plain && !FramedLog::isFramed(name);
+#ifndef _WIN32
+        int fd = plain ? open(name.c_str(), O_RDONLY | O_CLOEXEC) : -1;
+        struct stat st;
+        bool empty = fd >= 0 && fstat(fd, &st) == 0 && st.st_size == 0;
+        if (fd >= 0 && !empty)
+        {
+            void *addr = mmap(nullptr,
+                              static_cast<size_t>(st.st_size),
+                              PROT_READ,
+                              MAP_PRIVATE,
+                              fd,
+                              0);
+            if (addr != MAP_FAILED)
+            {
+                madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                file.data = static_cast<const char *>(addr);
+                file.size = static_cast<uint64_t>(st.st_size);
+            }
+        }
+        if (fd >= 0)
+            close(fd);
+        if (empty)
+            continue;
+#endif
+        size_t index = files.size();
+        files.push_back(std::move(file));
+        const auto &added = files.back();
+        if (!added.data)
+        {
+            tasks.push_back({index, 0, 0, {}, {}, 0});
+            continue;
+        }
+        // Chunks of whole lines.
+        uint64_t begin = 0;
+        while (begin < added.size)
+        {
+            uint64_t end = std::min(begin + kChunkSize, added.size);
+            if (end < added.size)
+            {
+                auto nl = static_cast<const char *>(
+                    memchr(added.data + end,
+                           '\n',
+                           static_cast<size_t>(added.size - end)));
+                end = nl ? static_cast<uint64_t>(nl - added.data) + 1
+                         : added.size;
+            }
+            tasks.push_back({index, begin, end, {}, {}, 0});
+            begin = end;
+        }
+    }
+
+    Grep grep(options, files);
+    std::atomic<size_t> nextTask{0};
+    std::vector<std::thread> threads;
+    threadNum = std::min<unsigned>(threadNum,
+                                   static_cast<unsigned>(tasks.size()));
+    for (unsigned i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([&grep, &tasks, &nextTask]() {
+            size_t index;
+            while ((index = nextTask.fetch_add(1)) < tasks.size())
+                grep.run(tasks[index]);
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    uint64_t total = 0;
+    for (auto &task : tasks)
+        total += task.count;
+    if (options.count)
+    {
+        printf("%llu\n", static_cast<long long unsigned int>(total));
+    }
+    else
+    {
+        // Each task is in time order, merge them.
+        std::vector<size_t> cursors(tasks.size(), 0);
+        std::priority_queue<size_t, std::vector<size_t>, Later> heap(
+            Later{&tasks, &cursors});
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            if (!tasks[i].matches.empty())
+                heap.push(i);
+        }
+        while (!heap.empty())
+        {
+            auto index = heap.top();
+            heap.pop();
+            auto &task = tasks[index];
+            auto &match = task.matches[cursors[index]];
+            fwrite(task.text.data() + match.offset, 1, match.len, stdout);
+            if (++cursors[index] < task.matches.size())
+                heap.push(index);
+        }
+    }
+#ifndef _WIN32
+    for (auto &file : files)
+    {
+        if (file.data)
+            munmap(const_cast<char *>(file.data), file.size);
+    }
+#endif
+    return total > 0 ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file LogMerge.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Merge the files written by a ShardedFileLogger into one stream
+ * ordered by the record sequence numbers.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/ShardedFileLogger.h>
+#include "FileReader.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+namespace
+{
+    struct Source
+    {
+        FileReader reader;
+        uint64_t seq{0};
+        std::string header;
+        std::string record;
+
+        /**
+         * @brief Read the next record. A line without a valid header (e.g. a
+         * file written without a sequence) goes with the previous number.
+         *
+         */
+        bool next()
+        {
+            const char *data =
+                reader.peek(AsyncFileLogger::kRecordHeaderLength);
+            uint64_t recordSeq{0}, len{0};
+            if (data &&
+                ShardedFileLogger::parseRecordHeader(data, recordSeq, len))
+            {
+                seq = recordSeq;
+                header.assign(data, AsyncFileLogger::kRecordHeaderLength);
+                record.resize(static_cast<size_t>(len));
+                return reader.read(&header[0], header.size()) &&
+                       reader.read(&record[0], record.size());
+            }
+            header.clear();
+            return reader.readLine(record);
+        }
+    };
+
+    struct Later
+    {
+        const std::vector<std::unique_ptr<Source>> *sources;
+        bool operator()(size_t a, size_t b) const
+        {
+            auto seqA = (*sources)[a]->seq;
+            auto seqB = (*sources)[b]->seq;
+            return seqA != seqB ? seqA > seqB : a > b;
+        }
+    };
+} // namespace
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-k] [-o output] file...\n"
+            "Merge the shard files of a ShardedFileLogger, including rotated "
+            "and gzipped ones, in the order of the record sequence numbers.\n"
+            "  -k         keep the record headers\n"
+            "  -o output  write to a file instead of the standard output\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    bool keepHeaders = false;
+    const char *outputName = nullptr;
+    std::vector<std::unique_ptr<Source>> sources;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-k") == 0)
+        {
+            keepHeaders = true;
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outputName = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            std::unique_ptr<Source> source(new Source);
+            if (!source->reader.open(argv[i]))
+            {
+                fprintf(stderr, "Can't open %s: %s\n", argv[i], strerror(errno));
+                return 1;
+            }
+            sources.push_back(std::move(source));
+        }
+    }
+    if (sources.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if (outputName && (out = fopen(outputName, "w")) == nullptr)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", outputName, strerror(errno));
+        return 1;
+    }
+
+    std::priority_queue<size_t, std::vector<size_t>, Later> heap(
+        Later{&sources});
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        if (sources[i]->next())
+            heap.push(i);
+    }
+    while (!heap.empty())
+    {
+        auto index = heap.top();
+        heap.pop();
+        auto &source = *sources[index];
+        if (keepHeaders)
+            fwrite(source.header.data(), 1, source.header.size(), out);
+        fwrite(source.record.data(), 1, source.record.size(), out);
+        if (source.next())
+            heap.push(index);
+    }
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
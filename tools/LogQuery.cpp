@@ -0,0 +1,416 @@
+/**
+ * @file LogQuery.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Print or count the records of a time range and a level, reading
+ * only the blocks of the log files their index points to.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/LogIndex.h>
+#include <xiaoLog/FramedLog.h>
+#include "FileReader.h"
+#include "LogFilter.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+namespace
+{
+    struct Query
+    {
+        int64_t from{INT64_MIN};
+        int64_t to{INT64_MAX};
+        int minLevel{-1};
+        bool count{false};
+        bool exact{false};
+        FILE *out{stdout};
+
+        bool overlaps(const LogIndex::Block &block) const
+        {
+            return block.minTime <= to && block.maxTime >= from;
+        }
+        bool covers(const LogIndex::Block &block) const
+        {
+            return block.minTime >= from && block.maxTime <= to;
+        }
+    };
+
+    /**
+     * @brief Filter lines. A continuation line goes with the record it
+     * belongs to, a range always starts on a line boundary.
+     *
+     */
+    class Matcher
+    {
+    public:
+        explicit Matcher(const Query &query) : query_(query)
+        {
+        }
+
+        void reset()
+        {
+            keep_ = false;
+        }
+
+        void line(const char *data, size_t len)
+        {
+            int64_t time;
+            int level;
+            if (parser_.parse(data, len, time, level))
+            {
+                keep_ = time >= query_.from && time <= query_.to &&
+                        (query_.minLevel < 0 || level >= query_.minLevel);
+                if (keep_ && query_.count && level >= 0)
+                    ++counts[level];
+            }
+            if (keep_ && !query_.count)
+                fwrite(data, 1, len, query_.out);
+        }
+
+        uint64_t counts[LogIndex::kNumberOfLevels]{0};
+
+    private:
+        const Query &query_;
+        LogLineParser parser_;
+        bool keep_{false};
+    };
+
+    struct Range
+    {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct LogFile
+    {
+        std::string name;
+        std::vector<LogIndex::Block> blocks;
+        bool indexed{false};
+        int64_t firstTime{INT64_MIN};
+    };
+} // namespace
+
+static bool isGzip(const std::string &name)
+{
+    return name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] file...\n"
+            "Print the records of the log files in a time range, reading only "
+            "the blocks their index (file.idx) points to. Files without an "
+            "index are read entirely.\n"
+            "  --from time   the first time, \"YYYYMMDD HH:MM[:SS[.uuuuuu]]\" "
+            "or \"YYYY-MM-DD HH:MM[:SS]\"\n"
+            "  --to time     the last time, the whole last minute or second "
+            "is included\n"
+            "  --local       the times are local times, not UTC\n"
+            "  --level name  only records of this level or higher\n"
+            "  --count       count the records by level from the index, "
+            "without reading the files; the blocks at the ends of the range "
+            "are counted entirely\n"
+            "  --exact       with --count, read the blocks at the ends of the "
+            "range to count exactly\n"
+            "  -o output     write to a file instead of the standard output\n",
+            prog);
+}
+
+using ReadAt = std::function<long(char *, size_t, uint64_t)>;
+
+static bool readRange(const ReadAt &readAt,
+                      const Range &range,
+                      Matcher &matcher)
+{
+    constexpr size_t kChunkSize{1024 * 1024};
+    std::vector<char> buf(kChunkSize);
+    size_t carry = 0;
+    uint64_t pos = range.begin;
+    matcher.reset();
+    while (pos < range.end)
+    {
+        size_t want = static_cast<size_t>(
+            std::min<uint64_t>(buf.size() - carry, range.end - pos));
+        auto n = readAt(buf.data() + carry, want, pos);
+        if (n < 0)
+            return false;
+        if (n == 0)
+            break;
+        pos += static_cast<uint64_t>(n);
+        size_t end = carry + static_cast<size_t>(n);
+        size_t start = 0;
+        const char *nl;
+        while ((nl = static_cast<const char *>(
+                    memchr(buf.data() + start, '\n', end - start))) != nullptr)
+        {
+            size_t lineEnd = nl - buf.data() + 1;
+            matcher.line(buf.data() + start, lineEnd - start);
+            start = lineEnd;
+        }
+        carry = end - start;
+        memmove(buf.data(), buf.data() + start, carry);
+        if (carry == buf.size())
+        {
+            // A line longer than the buffer.
+            buf.resize(buf.size() * 2);
+        }
+    }
+    if (carry > 0)
+        matcher.line(buf.data(), carry);
+    return true;
+}
+
+static bool readWholeFile(const std::string &name, Matcher &matcher)
+{
+    FileReader reader;
+    if (!reader.open(name))
+        return false;
+    matcher.reset();
+    std::string line;
+    while (reader.readLine(line))
+        matcher.line(line.data(), line.size());
+    return true;
+}
+
+static bool queryFile(const LogFile &file,
+                      const Query &query,
+                      Matcher &matcher,
+                      uint64_t counts[])
+{
+    if (!file.indexed)
+        return readWholeFile(file.name, matcher);
+    // The blocks are almost sorted by time, the running max and the running
+    // min from the end are sorted and can be searched.
+    const auto &blocks = file.blocks;
+    std::vector<int64_t> maxTimes(blocks.size()), minTimes(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+        maxTimes[i] = std::max(blocks[i].maxTime,
+                               i > 0 ? maxTimes[i - 1] : INT64_MIN);
+    for (size_t i = blocks.size(); i-- > 0;)
+        minTimes[i] = std::min(blocks[i].minTime,
+                               i + 1 < blocks.size() ? minTimes[i + 1]
+                                                     : INT64_MAX);
+    size_t first = static_cast<size_t>(
+        std::lower_bound(maxTimes.begin(), maxTimes.end(), query.from) -
+        maxTimes.begin());
+    size_t last = static_cast<size_t>(
+        std::upper_bound(minTimes.begin(), minTimes.end(), query.to) -
+        minTimes.begin());
+
+    uint64_t blockCounts[LogIndex::kNumberOfLevels]{0};
+    std::vector<Range> ranges;
+    auto addRange = [&ranges](uint64_t begin, uint64_t end) {
+        if (begin >= end)
+            return;
+        if (!ranges.empty() && ranges.back().end == begin)
+            ranges.back().end = end;
+        else
+            ranges.push_back({begin, end});
+    };
+    // Data the index doesn't cover, e.g. written before the index was
+    // enabled, is always read.
+    uint64_t covered = 0;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const auto &block = blocks[i];
+        addRange(covered, block.offset);
+        covered = block.offset + block.length;
+        if (i < first || i >= last || !query.overlaps(block))
+            continue;
+        if (query.count && (query.covers(block) || !query.exact))
+        {
+            for (int level = std::max(query.minLevel, 0);
+                 level < LogIndex::kNumberOfLevels;
+                 ++level)
+                blockCounts[level] += block.counts[level];
+            continue;
+        }
+        addRange(block.offset, covered);
+    }
+    bool gzip = isGzip(file.name);
+    FramedLogReader framed;
+    bool isFramed = !gzip && FramedLog::isFramed(file.name);
+    if (isFramed)
+    {
+        // The index has the offsets of the uncompressed log.
+        if (!framed.open(file.name))
+            return false;
+        addRange(covered, framed.rawSize());
+    }
+    else if (!gzip)
+    {
+        struct stat st;
+        if (stat(file.name.c_str(), &st) == 0)
+            addRange(covered, static_cast<uint64_t>(st.st_size));
+    }
+    if (gzip && !ranges.empty())
+    {
+        // No random access in a gzip stream, the whole file is counted.
+        return readWholeFile(file.name, matcher);
+    }
+    for (int level = 0; level < LogIndex::kNumberOfLevels; ++level)
+        counts[level] += blockCounts[level];
+    if (ranges.empty())
+        return true;
+    int fd = -1;
+    ReadAt readAt;
+    if (isFramed)
+    {
+        readAt = [&framed](char *buf, size_t len, uint64_t offset) {
+            return static_cast<long>(framed.pread(buf, len, offset));
+        };
+    }
+    else
+    {
+        fd = open(file.name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        readAt = [fd](char *buf, size_t len, uint64_t offset) {
+#ifndef _WIN32
+            return static_cast<long>(
+                pread(fd, buf, len, static_cast<off_t>(offset)));
+#else
+            _lseeki64(fd, static_cast<__int64>(offset), SEEK_SET);
+            return static_cast<long>(
+                _read(fd, buf, static_cast<unsigned>(len)));
+#endif
+        };
+    }
+    bool ok = true;
+    for (auto &range : ranges)
+    {
+        if (!readRange(readAt, range, matcher))
+        {
+            ok = false;
+            break;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    Query query;
+    bool local = false;
+    const char *fromStr = nullptr;
+    const char *toStr = nullptr;
+    const char *outputName = nullptr;
+    std::vector<LogFile> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--from") == 0 && hasValue)
+            fromStr = argv[++i];
+        else if (strcmp(argv[i], "--to") == 0 && hasValue)
+            toStr = argv[++i];
+        else if (strcmp(argv[i], "--local") == 0)
+            local = true;
+        else if (strcmp(argv[i], "--level") == 0 && hasValue)
+        {
+            query.minLevel = parseLevelName(argv[++i]);
+            if (query.minLevel < 0)
+            {
+                fprintf(stderr, "Unknown level %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--count") == 0)
+            query.count = true;
+        else if (strcmp(argv[i], "--exact") == 0)
+            query.exact = true;
+        else if (strcmp(argv[i], "-o") == 0 && hasValue)
+            outputName = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            LogFile file;
+            file.name = argv[i];
+            file.indexed =
+                LogIndex::load(LogIndex::indexFileName(file.name), file.blocks);
+            if (file.indexed && !file.blocks.empty())
+                file.firstTime = file.blocks.front().minTime;
+            files.push_back(std::move(file));
+        }
+    }
+    if (files.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if ((fromStr && !parseFilterTime(fromStr, local, false, query.from)) ||
+        (toStr && !parseFilterTime(toStr, local, true, query.to)))
+    {
+        fprintf(stderr, "Bad time, see the usage with --help\n");
+        return 1;
+    }
+    if (outputName && (query.out = fopen(outputName, "w")) == nullptr)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", outputName, strerror(errno));
+        return 1;
+    }
+    // Rotated files don't overlap, print them in time order.
+    std::stable_sort(files.begin(),
+                     files.end(),
+                     [](const LogFile &a, const LogFile &b) {
+                         return a.firstTime < b.firstTime;
+                     });
+    Matcher matcher(query);
+    uint64_t counts[LogIndex::kNumberOfLevels]{0};
+    int ret = 0;
+    for (auto &file : files)
+    {
+        if (!queryFile(file, query, matcher, counts))
+        {
+            fprintf(stderr,
+                    "Can't read %s: %s\n",
+                    file.name.c_str(),
+                    strerror(errno));
+            ret = 1;
+        }
+    }
+    if (query.count)
+    {
+        uint64_t total = 0;
+        for (int level = std::max(query.minLevel, 0);
+             level < LogIndex::kNumberOfLevels;
+             ++level)
+        {
+            auto n = counts[level] + matcher.counts[level];
+            total += n;
+            fprintf(query.out,
+                    "%-5s %llu\n",
+                    kLevelNames[level],
+                    static_cast<long long unsigned int>(n));
+        }
+        fprintf(query.out,
+                "total %llu\n",
+                static_cast<long long unsigned int>(total));
+    }
+    if (query.out != stdout)
+        fclose(query.out);
+    return ret;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file LogRecover.cpp
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Print the records kept by a FlightRecorder file, e.g. after a
+ * crash.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#include <xiaoLog/FlightRecorder.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace xiaoLog;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-o output] file\n"
+            "Print the records of a flight recorder file, oldest first.\n"
+            "  -o output  write to a file instead of the standard output\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outputName = nullptr;
+    const char *fileName = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outputName = argv[++i];
+        else if (argv[i][0] != '-' && !fileName)
+            fileName = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!fileName)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if (outputName && (out = fopen(outputName, "w")) == nullptr)
+    {
+        perror(outputName);
+        return 1;
+    }
+#ifndef _WIN32
+    bool ok = FlightRecorder::recover(fileName,
+                                      [out](const char *msg, uint64_t len) {
+                                          fwrite(msg, 1, len, out);
+                                      });
+#else
+    bool ok = false;
+#endif
+    if (out != stdout)
+        fclose(out);
+    if (!ok)
+    {
+        fprintf(stderr, "%s is not a flight recorder file\n", fileName);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file StringSearch.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define XIAOLOG_SEARCH_AVX2
+#endif
+#endif
+
+namespace xiaoLog
+{
+    /**
+     * @brief A substring searcher for the command line tools. The first and
+     * the last byte of the pattern are compared with 32 (AVX2) or 16 (SSE2)
+     * positions at once and only the positions where both match are checked
+     * with memcmp, so the text is scanned at about the speed of memchr. AVX2
+     * is selected at run time.
+     *
+     */
+    class StringSearch
+    {
+    public:
+        explicit StringSearch(std::string pattern)
+            : pattern_(std::move(pattern))
+        {
+#ifdef XIAOLOG_SEARCH_AVX2
+            avx2_ = __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        const std::string &pattern() const
+        {
+            return pattern_;
+        }
+
+        /**
+         * @brief Find the first occurrence of the pattern.
+         *
+         * @return The position in data, or nullptr.
+         */
+        const char *find(const char *data, size_t len) const
+        {
+            size_t n = pattern_.size();
+            if (n == 0)
+                return data;
+            if (n > len)
+                return nullptr;
+            if (n == 1)
+                return static_cast<const char *>(
+                    memchr(data, pattern_[0], len));
+            size_t pos = 0;
+#ifdef XIAOLOG_SEARCH_AVX2
+            if (avx2_)
+            {
+                auto found = findAvx2(data, len, pos);
+                if (found || pos + n > len)
+                    return found;
+            }
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+            auto found = findSse2(data, len, pos);
+            if (found || pos + n > len)
+                return found;
+#endif
+            return findScalar(data, len, pos);
+        }
+
+    private:
+        bool matchAt(const char *p) const
+        {
+            // The first and the last bytes are known to match.
+            return memcmp(p + 1, pattern_.data() + 1, pattern_.size() - 2) == 0;
+        }
+
+        static unsigned countTrailingZeros(uint32_t mask)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+            unsigned n = 0;
+            while ((mask & 1) == 0)
+            {
+                mask >>= 1;
+                ++n;
+            }
+            return n;
+#endif
+        }
+
+#ifdef XIAOLOG_SEARCH_AVX2
+        __attribute__((target("avx2"))) const char *findAvx2(const char *data,
+                                                             size_t len,
+                                                             size_t &pos) const
+        {
+            size_t n = pattern_.size();
+            const __m256i first = _mm256_set1_epi8(pattern_[0]);
+            const __m256i last = _mm256_set1_epi8(pattern_[n - 1]);
+            for (; pos + n - 1 + 32 <= len; pos += 32)
+            {
+                __m256i blockFirst = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(data + pos));
+                __m256i blockLast = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(data + pos + n - 1));
+                uint32_t mask = static_cast<uint32_t>(
+                    _mm256_movemask_epi8(_mm256_and_si256(
+                        _mm256_cmpeq_epi8(first, blockFirst),
+                        _mm256_cmpeq_epi8(last, blockLast))));
+                while (mask != 0)
+                {
+                    auto p = data + pos + countTrailingZeros(mask);
+                    if (matchAt(p))
+                        return p;
+                    mask &= mask - 1;
+                }
+            }
+            return nullptr;
+        }
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+        const char *findSse2(const char *data, size_t len, size_t &pos) const
+        {
+            size_t n = pattern_.size();
+            const __m128i first = _mm_set1_epi8(pattern_[0]);
+            const __m128i last = _mm_set1_epi8(pattern_[n - 1]);
+            for (; pos + n - 1 + 16 <= len; pos += 16)
+            {
+                __m128i blockFirst = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(data + pos));
+                __m128i blockLast = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(data + pos + n - 1));
+                uint32_t mask = static_cast<uint32_t>(
+                    _mm_movemask_epi8(_mm_and_si128(
+                        _mm_cmpeq_epi8(first, blockFirst),
+                        _mm_cmpeq_epi8(last, blockLast))));
+                while (mask != 0)
+                {
+                    auto p = data + pos + countTrailingZeros(mask);
+                    if (matchAt(p))
+                        return p;
+                    mask &= mask - 1;
+                }
+            }
+            return nullptr;
+        }
+#endif
+
+        const char *findScalar(const char *data, size_t len, size_t pos) const
+        {
+            auto end = data + len;
+            auto p = std::search(data + pos,
+                                 end,
+                                 pattern_.begin(),
+                                 pattern_.end());
+            return p == end ? nullptr : p;
+        }
+
+        std::string pattern_;
+#ifdef XIAOLOG_SEARCH_AVX2
+        bool avx2_{false};
+#endif
+    };
+}
@@ -0,0 +1,220 @@
+#include <xiaoLog/AsyncFileLogger.h>
+#include <xiaoLog/AsyncLogExecutor.h>
+#include <xiaoLog/LogSink.h>
+#include <gtest/gtest.h>
+#include "TestUtils.h"
+#include <atomic>
+#include <thread>
+
+using namespace xiaoLog;
+
+TEST(AsyncFileLogger, sharedExecutor)
+{
+    constexpr int kLoggers = 8;
+    auto executor = std::make_shared<AsyncLogExecutor>(2);
+    {
+        std::unique_ptr<AsyncFileLogger> loggers[kLoggers];
+        for (int i = 0; i < kLoggers; ++i)
+        {
+            loggers[i].reset(new AsyncFileLogger);
+            loggers[i]->setFileName("executor_unittest" + std::to_string(i));
+            loggers[i]->setSwitchOnLimitOnly();
+            loggers[i]->setExecutor(executor);
+            loggers[i]->startLogging();
+        }
+        for (int i = 0; i < kLoggers; ++i)
+        {
+            std::string msg = "logger " + std::to_string(i) + "\n";
+            loggers[i]->output(msg.data(), msg.size());
+        }
+        // Written by the flush timer without any explicit flush.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        for (int i = 0; i < kLoggers; ++i)
+        {
+            EXPECT_EQ("logger " + std::to_string(i) + "\n",
+                      readFile("./executor_unittest" + std::to_string(i) +
+                               ".log"));
+        }
+        for (int i = 0; i < kLoggers; ++i)
+        {
+            std::string msg = "bye\n";
+            loggers[i]->output(msg.data(), msg.size());
+            loggers[i]->flush();
+        }
+    }
+    for (int i = 0; i < kLoggers; ++i)
+    {
+        auto name = "./executor_unittest" + std::to_string(i) + ".log";
+        EXPECT_EQ("logger " + std::to_string(i) + "\nbye\n", readFile(name));
+        remove(name.c_str());
+    }
+}
+
+TEST(AsyncFileLogger, waitStrategies)
+{
+    const AsyncFileLogger::WaitStrategy strategies[] = {
+        AsyncFileLogger::WaitStrategy::kBlocking,
+        AsyncFileLogger::WaitStrategy::kAdaptive,
+        AsyncFileLogger::WaitStrategy::kBusyPoll};
+    for (auto strategy : strategies)
+    {
+        remove("./wait_unittest.log");
+        {
+            AsyncFileLogger logger;
+            logger.setFileName("wait_unittest");
+            logger.setSwitchOnLimitOnly();
+            logger.setWaitStrategy(strategy);
+            logger.setFlushInterval(std::chrono::milliseconds(20));
+            logger.startLogging();
+            // Let the logging thread go idle before the first message.
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            std::string msg = "first\n";
+            logger.output(msg.data(), msg.size());
+            // The flush interval writes it out without another message.
+            auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (readFile("./wait_unittest.log") != "first\n" &&
+                   std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            EXPECT_EQ("first\n", readFile("./wait_unittest.log"));
+            msg = "second\n";
+            logger.output(msg.data(), msg.size());
+            logger.flush();
+        }
+        EXPECT_EQ("first\nsecond\n", readFile("./wait_unittest.log"));
+    }
+    remove("./wait_unittest.log");
+}
+
+TEST(AsyncFileLogger, placement)
+{
+    remove("./placement_unittest.log");
+    {
+        AsyncFileLogger logger;
+        logger.setFileName("placement_unittest");
+        logger.setSwitchOnLimitOnly();
+        logger.setThreadAffinity({0});
+        logger.setHugePageBuffers();
+        std::string msg = "before start\n";
+        logger.output(msg.data(), msg.size());
+        logger.startLogging();
+        msg = "after start\n";
+        logger.output(msg.data(), msg.size());
+    }
+    EXPECT_EQ("before start\nafter start\n",
+              readFile("./placement_unittest.log"));
+    remove("./placement_unittest.log");
+}
+
+TEST(AsyncFileLogger, flushBarriers)
+{
+    const LoggerFile::SyncPolicy policies[] = {
+        LoggerFile::SyncPolicy::kNone,
+        LoggerFile::SyncPolicy::kPeriodic,
+        LoggerFile::SyncPolicy::kWriteBehind};
+    for (auto policy : policies)
+    {
+        remove("./barrier_unittest.log");
+        AsyncFileLogger logger;
+        logger.setFileName("barrier_unittest");
+        logger.setSwitchOnLimitOnly();
+        logger.setSyncPolicy(policy, 1024);
+        std::string msg = "before start\n";
+        logger.output(msg.data(), msg.size());
+        logger.flushAndWait();
+        EXPECT_EQ(msg, readFile("./barrier_unittest.log"));
+
+        logger.startLogging();
+        std::string expected = msg;
+        for (int i = 0; i < 1000; ++i)
+        {
+            msg = "message " + std::to_string(i) + "\n";
+            logger.output(msg.data(), msg.size());
+            expected += msg;
+        }
+        auto future = logger.flushAsync(true);
+        EXPECT_EQ(std::future_status::ready,
+                  future.wait_for(std::chrono::seconds(5)));
+        EXPECT_EQ(expected, readFile("./barrier_unittest.log"));
+
+        logger.setSyncOnFlush();
+        msg = "error\n";
+        logger.output(msg.data(), msg.size());
+        logger.flush();
+        EXPECT_EQ(expected + msg, readFile("./barrier_unittest.log"));
+        // Nothing new, the barrier is ready at once.
+        logger.flushAndWait();
+    }
+    remove("./barrier_unittest.log");
+}
+
+// A sink which takes a while to flush what it was given.
+class SlowFlushSink : public LogSink
+{
+public:
+    void write(const StringPtr &buf) override
+    {
+        written_ += buf->size();
+    }
+    void flush() override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        flushed_.store(written_.load());
+    }
+
+    std::atomic<size_t> written_{0};
+    std::atomic<size_t> flushed_{0};
+};
+
+TEST(AsyncFileLogger, barrierWaitsForFlush)
+{
+    auto sink = std::make_shared<SlowFlushSink>();
+    AsyncFileLogger logger;
+    logger.setSink(sink);
+    logger.startLogging();
+    std::string msg = "message\n";
+    logger.output(msg.data(), msg.size());
+    auto first = logger.flushAsync(false);
+    while (sink->written_ < msg.size())
+        std::this_thread::yield();
+    // The buffer is written but not flushed yet, the barrier must wait.
+    logger.flushAsync(false).get();
+    EXPECT_EQ(msg.size(), sink->flushed_.load());
+    first.get();
+}
+
+TEST(AsyncFileLogger, flushStorm)
+{
+    remove("./storm_unittest.log");
+    {
+        AsyncFileLogger logger;
+        logger.setFileName("storm_unittest");
+        logger.setSwitchOnLimitOnly();
+        logger.setFlushCoalesceDelay(std::chrono::milliseconds(5));
+        logger.startLogging();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&logger]() {
+                for (int i = 0; i < 5000; ++i)
+                {
+                    std::string msg = "error\n";
+                    logger.output(msg.data(), msg.size());
+                    logger.flush();
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        logger.flushAndWait();
+        // Nothing is dropped by the queue limit.
+        EXPECT_EQ(4 * 5000 * 6u, readFile("./storm_unittest.log").size());
+    }
+    remove("./storm_unittest.log");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,200 @@
+#include <xiaoLog/ColumnarLog.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace xiaoLog;
+
+TEST(ColumnarLog, parseRecord)
+{
+    LogLineParser parser;
+    ColumnarLog::Record record;
+    std::string line =
+        "20250104 10:20:30.123456 UTC 4321 WARN  disk - almost full - "
+        "Disk.cc:42\n";
+    ASSERT_TRUE(ColumnarLog::parseRecord(line.data(),
+                                         line.size(),
+                                         parser,
+                                         record));
+    EXPECT_EQ(1735986030123456LL, record.time);
+    EXPECT_EQ(3, record.level);
+    EXPECT_EQ(4321u, record.tid);
+    EXPECT_EQ("disk - almost full", record.message);
+    EXPECT_EQ("Disk.cc", record.file);
+    EXPECT_EQ(42u, record.line);
+
+    line = "raw text\n";
+    EXPECT_FALSE(ColumnarLog::parseRecord(line.data(),
+                                          line.size(),
+                                          parser,
+                                          record));
+    EXPECT_EQ(ColumnarLog::kNoLevel, record.level);
+    EXPECT_EQ("raw text", record.message);
+}
+
+TEST(ColumnarLog, liveSink)
+{
+    remove("./columnar_unittest.xlc");
+    constexpr int kChannel = 3;
+    constexpr int kMessages = 2500;
+    auto writer = std::make_shared<ColumnarLogWriter>(1000);
+    ASSERT_TRUE(writer->open("./columnar_unittest.xlc"));
+    writer->setRowGroupInterval(std::chrono::seconds(60));
+    writer->startLogging();
+    Logger::setRecordFunction(
+        [writer](const LogRecord &record) { writer->output(record); },
+        [writer]() { writer->flush(); },
+        kChannel);
+    for (int i = 0; i < kMessages; ++i)
+    {
+        if (i % 100 == 99)
+            LOG_ERROR_TO(kChannel) << "error " << i;
+        else
+            LOG_INFO_TO(kChannel) << "info " << i;
+    }
+    writer->close();
+    Logger::setOutputFunction(nullptr, nullptr, kChannel);
+
+    ColumnarLogReader reader;
+    ASSERT_TRUE(reader.open("./columnar_unittest.xlc"));
+    auto &groups = reader.rowGroups();
+    // The errors flush the file without cutting the groups short.
+    ASSERT_EQ(3u, groups.size());
+    EXPECT_EQ(1000u, groups[0].rows);
+    int row = 0;
+    ColumnarLogReader::Columns columns;
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        EXPECT_EQ(kChannel, groups[g].minChannel);
+        EXPECT_EQ(kChannel, groups[g].maxChannel);
+        EXPECT_LE(groups[g].minTime, groups[g].maxTime);
+        // Only the messages and the levels.
+        ASSERT_TRUE(reader.read(g,
+                                columns,
+                                (1u << ColumnarLog::kMessage) |
+                                    (1u << ColumnarLog::kLevel)));
+        EXPECT_TRUE(columns.times.empty());
+        ASSERT_EQ(groups[g].rows, columns.messages.size());
+        for (size_t i = 0; i < columns.messages.size(); ++i, ++row)
+        {
+            if (row % 100 == 99)
+            {
+                EXPECT_EQ(Logger::kError, columns.levels[i]);
+                EXPECT_EQ("error " + std::to_string(row),
+                          columns.messages[i]);
+            }
+            else
+            {
+                EXPECT_EQ(Logger::kInfo, columns.levels[i]);
+                EXPECT_EQ("info " + std::to_string(row), columns.messages[i]);
+            }
+        }
+    }
+    EXPECT_EQ(kMessages, row);
+    ASSERT_TRUE(reader.read(0, columns));
+    EXPECT_EQ("ColumnarLogUnittest.cpp", columns.files[0]);
+    EXPECT_NE(0u, columns.lines[0]);
+    EXPECT_EQ(groups[0].minTime, columns.times[0]);
+    remove("./columnar_unittest.xlc");
+}
+
+TEST(ColumnarLog, appendAfterCrash)
+{
+    remove("./columnar_crash_unittest.xlc");
+    ColumnarLog::Record record;
+    record.level = Logger::kInfo;
+    record.file = "Crash.cc";
+    {
+        ColumnarLogWriter writer(10);
+        ASSERT_TRUE(writer.open("./columnar_crash_unittest.xlc"));
+        for (int i = 0; i < 20; ++i)
+        {
+            record.time = 1000 + i;
+            record.message = std::to_string(i);
+            writer.append(record);
+        }
+        writer.flush();
+        // The copy has no table, like the file of a crashed process.
+        FILE *in = fopen("./columnar_crash_unittest.xlc", "rb");
+        FILE *out = fopen("./columnar_crash_unittest.copy.xlc", "wb");
+        ASSERT_TRUE(in && out);
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+            fwrite(buf, 1, n, out);
+        fclose(in);
+        fclose(out);
+    }
+    {
+        ColumnarLogReader reader;
+        ASSERT_TRUE(reader.open("./columnar_crash_unittest.copy.xlc"));
+        EXPECT_EQ(2u, reader.rowGroups().size());
+    }
+    {
+        ColumnarLogWriter writer(10);
+        ASSERT_TRUE(writer.open("./columnar_crash_unittest.copy.xlc"));
+        for (int i = 20; i < 30; ++i)
+        {
+            record.time = 1000 + i;
+            record.message = std::to_string(i);
+            writer.append(record);
+        }
+    }
+    ColumnarLogReader reader;
+    ASSERT_TRUE(reader.open("./columnar_crash_unittest.copy.xlc"));
+    ASSERT_EQ(3u, reader.rowGroups().size());
+    int next = 0;
+    ColumnarLogReader::Columns columns;
+    for (size_t g = 0; g < reader.rowGroups().size(); ++g)
+    {
+        ASSERT_TRUE(reader.read(g, columns));
+        for (size_t i = 0; i < columns.times.size(); ++i, ++next)
+        {
+            EXPECT_EQ(1000 + next, columns.times[i]);
+            EXPECT_EQ(std::to_string(next), columns.messages[i]);
+            EXPECT_EQ("Crash.cc", columns.files[i]);
+        }
+    }
+    EXPECT_EQ(30, next);
+    remove("./columnar_crash_unittest.xlc");
+    remove("./columnar_crash_unittest.copy.xlc");
+}
+
+TEST(ColumnarLog, sealsGroupsByTime)
+{
+    remove("./columnar_time_unittest.xlc");
+    ColumnarLog::Record record;
+    record.level = Logger::kInfo;
+    {
+        ColumnarLogWriter writer(1000);
+        ASSERT_TRUE(writer.open("./columnar_time_unittest.xlc"));
+        writer.setRowGroupInterval(std::chrono::milliseconds(20));
+        writer.startLogging();
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 5; ++j)
+            {
+                record.time = 1000 + i * 5 + j;
+                record.message = std::to_string(i * 5 + j);
+                writer.append(record);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    }
+    ColumnarLogReader reader;
+    ASSERT_TRUE(reader.open("./columnar_time_unittest.xlc"));
+    ASSERT_EQ(3u, reader.rowGroups().size());
+    for (auto &group : reader.rowGroups())
+        EXPECT_EQ(5u, group.rows);
+    remove("./columnar_time_unittest.xlc");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+#include <xiaoLog/ConsoleLogger.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace xiaoLog;
+
+class ConsoleLoggerTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char path[] = "./console_unittest_XXXXXX";
+        fd_ = mkstemp(path);
+        path_ = path;
+    }
+    void TearDown() override
+    {
+        Logger::setOutputFunction(nullptr, nullptr, 0);
+        close(fd_);
+        unlink(path_.c_str());
+    }
+    void route(ConsoleLogger &console)
+    {
+        Logger::setRecordFunction(
+            [&console](const LogRecord &record) { console.output(record); },
+            [&console]() { console.flush(); },
+            0);
+    }
+    std::string content()
+    {
+        std::string data;
+        char buf[4096];
+        ssize_t n;
+        off_t offset = 0;
+        while ((n = pread(fd_, buf, sizeof(buf), offset)) > 0)
+        {
+            data.append(buf, static_cast<size_t>(n));
+            offset += n;
+        }
+        return data;
+    }
+
+    int fd_{-1};
+    std::string path_;
+};
+
+TEST_F(ConsoleLoggerTest, writesInOrder)
+{
+    std::string expected;
+    {
+        ConsoleLogger console(fd_);
+        // Not a terminal.
+        EXPECT_FALSE(console.colored());
+        console.startLogging();
+        route(console);
+        for (int i = 0; i < 20000; ++i)
+        {
+            LOG_INFO_TO(0) << "record " << i;
+            expected += "record " + std::to_string(i) + "\n";
+        }
+    }
+    std::string data = content();
+    std::string messages;
+    size_t start = 0;
+    while (start < data.size())
+    {
+        auto end = data.find('\n', start);
+        auto msg = data.find(" INFO  ", start) + 7;
+        messages += data.substr(msg, data.find(" - ", msg) - msg) + "\n";
+        start = end + 1;
+    }
+    EXPECT_EQ(expected, messages);
+}
+
+TEST_F(ConsoleLoggerTest, coloredLevels)
+{
+    {
+        ConsoleLogger console(fd_);
+        console.setColored(true);
+        route(console);
+        LOG_WARN_TO(0) << "colored";
+        LOG_RAW_TO(0) << "raw";
+        auto level = Logger::logLevel();
+        Logger::setLogLevel(Logger::kDebug);
+        // The function name follows the level.
+        LOG_DEBUG_TO(0) << "debug";
+        Logger::setLogLevel(level);
+        // Text output functions get their level parsed.
+        std::string text = "20250104 10:20:30.123456 UTC 42 ERROR text\n";
+        console.output(text.data(), text.size());
+    }
+    std::string data = content();
+    EXPECT_NE(std::string::npos, data.find("\033[33m WARN  \033[0mcolored"));
+    EXPECT_NE(std::string::npos,
+              data.find("\033[36m DEBUG \033[0m[TestBody] debug"));
+    EXPECT_NE(std::string::npos, data.find("42\033[31m ERROR \033[0mtext"));
+    EXPECT_NE(std::string::npos, data.find("\nraw"));
+}
+
+TEST_F(ConsoleLoggerTest, fatalIsWrittenAtOnce)
+{
+    ConsoleLogger console(fd_);
+    route(console);
+    // The logging thread isn't started, only FATAL records are written.
+    LOG_INFO_TO(0) << "before";
+    EXPECT_EQ("", content());
+    LOG_FATAL_TO(0) << "fatal";
+    std::string data = content();
+    auto before = data.find("before");
+    auto fatal = data.find("fatal");
+    ASSERT_NE(std::string::npos, before);
+    ASSERT_NE(std::string::npos, fatal);
+    EXPECT_LT(before, fatal);
+}
+
+TEST_F(ConsoleLoggerTest, dropsWhenTheQueueIsFull)
+{
+    {
+        ConsoleLogger console(fd_);
+        console.setMaxPendingBytes(1000);
+        route(console);
+        for (int i = 0; i < 100; ++i)
+            LOG_INFO_TO(0) << "record " << i;
+        EXPECT_LT(0u, console.droppedRecords());
+        EXPECT_GT(100u, console.droppedRecords());
+    }
+    EXPECT_GE(1000u, content().size());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
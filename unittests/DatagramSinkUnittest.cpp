@@ -0,0 +1,142 @@
+#include <xiaoLog/DatagramSink.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+static int bindUnix(const std::string &path)
+{
+    unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Read the datagrams waiting on a socket.
+static std::vector<std::string> receiveAll(int fd)
+{
+    std::vector<std::string> datagrams;
+    char buf[65536];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        datagrams.emplace_back(buf, static_cast<size_t>(n));
+    return datagrams;
+}
+
+TEST(DatagramSink, unixSocket)
+{
+    const std::string path = "./datagram_unittest.sock";
+    int collector = bindUnix(path);
+    ASSERT_GE(collector, 0);
+    auto sink = DatagramSink::openUnix(path, 1024);
+    ASSERT_TRUE(sink);
+    std::string received;
+    size_t datagrams = 0;
+    {
+        AsyncFileLogger logger;
+        logger.setSink(sink);
+        logger.startLogging();
+        for (int i = 0; i < 1000; ++i)
+        {
+            std::string msg = "record " + std::to_string(i) + "\n";
+            logger.output(msg.data(), msg.size());
+            if (i % 100 == 99)
+            {
+                logger.flushAndWait();
+                for (auto &datagram : receiveAll(collector))
+                {
+                    // Records are not split between datagrams.
+                    EXPECT_LE(datagram.size(), 1024u);
+                    EXPECT_EQ('\n', datagram.back());
+                    received += datagram;
+                    ++datagrams;
+                }
+            }
+        }
+    }
+    std::string expected;
+    for (int i = 0; i < 1000; ++i)
+        expected += "record " + std::to_string(i) + "\n";
+    EXPECT_EQ(expected, received);
+    EXPECT_EQ(datagrams, sink->sentDatagrams());
+    EXPECT_EQ(0u, sink->droppedDatagrams());
+    close(collector);
+    unlink(path.c_str());
+}
+
+TEST(DatagramSink, udpLoopback)
+{
+    int collector = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0,
+              bind(collector,
+                   reinterpret_cast<struct sockaddr *>(&addr),
+                   sizeof(addr)));
+    socklen_t len = sizeof(addr);
+    getsockname(collector, reinterpret_cast<struct sockaddr *>(&addr), &len);
+    auto sink = DatagramSink::openUdp("127.0.0.1", ntohs(addr.sin_port), 100);
+    ASSERT_TRUE(sink);
+    auto buf = std::make_shared<std::string>();
+    for (int i = 0; i < 20; ++i)
+        buf->append("line " + std::to_string(i) + "\n");
+    // Longer than a datagram, it's split.
+    buf->append(std::string(250, 'x') + "\n");
+    sink->write(buf);
+    std::string received;
+    for (auto &datagram : receiveAll(collector))
+    {
+        EXPECT_LE(datagram.size(), 100u);
+        received += datagram;
+    }
+    EXPECT_EQ(*buf, received);
+    close(collector);
+}
+
+TEST(DatagramSink, dropsWhenTheCollectorIsSlow)
+{
+    const std::string path = "./datagram_drop_unittest.sock";
+    int collector = bindUnix(path);
+    ASSERT_GE(collector, 0);
+    auto sink = DatagramSink::openUnix(path, 4096);
+    ASSERT_TRUE(sink);
+    auto buf = std::make_shared<std::string>();
+    while (buf->size() < 4 * 1024 * 1024)
+        buf->append(std::string(99, 'r') + "\n");
+    uint64_t lines = buf->size() / 100;
+    // Nobody reads, the socket queue fills up.
+    sink->write(buf);
+    EXPECT_LT(0u, sink->droppedDatagrams());
+    uint64_t receivedLines = 0;
+    auto datagrams = receiveAll(collector);
+    for (auto &datagram : datagrams)
+        receivedLines += datagram.size() / 100;
+    EXPECT_EQ(datagrams.size(), sink->sentDatagrams());
+    EXPECT_EQ(lines, receivedLines + sink->droppedRecords());
+    close(collector);
+    unlink(path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include <xiaoLog/FlightRecorder.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace xiaoLog;
+
+TEST(FlightRecorder, keepsTheLastRecords)
+{
+    remove("./recorder_unittest.flight");
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 20000;
+    {
+        auto recorder = FlightRecorder::open("./recorder_unittest.flight",
+                                             64 * 1024);
+        ASSERT_TRUE(recorder);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&recorder, t]() {
+                for (int i = 0; i < kMessages; ++i)
+                {
+                    std::string msg = std::to_string(t) + " " +
+                                      std::to_string(i) + "\n";
+                    recorder->record(msg.data(), msg.size());
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+    std::vector<int> last(kThreads, -1);
+    size_t count = 0;
+    EXPECT_TRUE(FlightRecorder::recover(
+        "./recorder_unittest.flight", [&](const char *msg, uint64_t len) {
+            std::string record(msg, len);
+            int t = std::stoi(record);
+            int i = std::stoi(record.substr(record.find(' ') + 1));
+            // The records of each thread are in order.
+            EXPECT_LT(last[t], i);
+            last[t] = i;
+            ++count;
+        }));
+    // About 64 KiB of the latest records.
+    EXPECT_LT(1000u, count);
+    EXPECT_NE(last.end(), std::find(last.begin(), last.end(), kMessages - 1));
+    remove("./recorder_unittest.flight");
+}
+
+TEST(FlightRecorder, survivesCrash)
+{
+    remove("./crash_unittest.flight");
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        Logger::setFlightRecorder(
+            FlightRecorder::open("./crash_unittest.flight", 1024 * 1024));
+        Logger::setOutputFunction([](const char *, const uint64_t) {},
+                                  []() {});
+        for (int i = 0; i < 100; ++i)
+            LOG_INFO << "before the crash " << i;
+        kill(getpid(), SIGKILL);
+    }
+    waitpid(pid, nullptr, 0);
+    std::string content;
+    EXPECT_TRUE(FlightRecorder::recover("./crash_unittest.flight",
+                                        [&](const char *msg, uint64_t len) {
+                                            content.append(msg, len);
+                                        }));
+    EXPECT_NE(std::string::npos, content.find("before the crash 0 "));
+    EXPECT_NE(std::string::npos, content.find("before the crash 99 "));
+    remove("./crash_unittest.flight");
+}
+
+TEST(FlightRecorder, replacedRecordersAreReleased)
+{
+    Logger::setOutputFunction([](const char *, const uint64_t) {}, []() {});
+    std::atomic<bool> stop{false};
+    std::thread logger([&stop]() {
+        while (!stop)
+            LOG_INFO << "while the recorders change";
+    });
+    for (int i = 0; i < 100; ++i)
+    {
+        std::weak_ptr<FlightRecorder> weak;
+        {
+            auto recorder =
+                FlightRecorder::open("./release_unittest.flight", 64 * 1024);
+            ASSERT_TRUE(recorder);
+            weak = recorder;
+            Logger::setFlightRecorder(std::move(recorder));
+        }
+        Logger::setFlightRecorder(nullptr);
+        EXPECT_TRUE(weak.expired());
+    }
+    stop = true;
+    logger.join();
+    Logger::setOutputFunction(
+        [](const char *msg, const uint64_t len) {
+            fwrite(msg, 1, static_cast<size_t>(len), stdout);
+        },
+        []() { fflush(stdout); });
+    remove("./release_unittest.flight");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+#include <xiaoLog/LogBroadcast.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xiaoLog;
+
+TEST(LogBroadcast, filters)
+{
+    auto broadcast = std::make_shared<LogBroadcast>(1024);
+    Logger::setLogBroadcast(broadcast);
+    for (int channel = 1; channel <= 2; ++channel)
+        Logger::setOutputFunction([](const char *, const uint64_t) {},
+                                  []() {},
+                                  channel);
+    LogBroadcast::Subscriber all(broadcast);
+    LogBroadcast::Subscriber warnings(broadcast);
+    warnings.setLevel(Logger::kWarn);
+    warnings.setChannels({2});
+    for (int i = 0; i < 100; ++i)
+    {
+        LOG_INFO_TO(1) << "info " << i;
+        LOG_WARN_TO(2) << "warn " << i;
+        LOG_RAW_TO(2) << "raw " << i;
+    }
+    Logger::setLogBroadcast(nullptr);
+
+    size_t count = 0;
+    EXPECT_EQ(300u, all.poll([&count](const LogBroadcast::Record &record) {
+        EXPECT_FALSE(record.truncated);
+        if (count % 3 == 0)
+        {
+            EXPECT_EQ(Logger::kInfo, record.level);
+            EXPECT_EQ(1, record.channel);
+        }
+        else if (count % 3 == 2)
+        {
+            EXPECT_EQ(-1, record.level);
+        }
+        ++count;
+    }));
+    int next = 0;
+    EXPECT_EQ(100u,
+              warnings.poll([&next](const LogBroadcast::Record &record) {
+                  std::string text(record.data, record.len);
+                  EXPECT_NE(std::string::npos,
+                            text.find("warn " + std::to_string(next) + " "));
+                  ++next;
+              }));
+    EXPECT_EQ(0u, all.gaps());
+    EXPECT_EQ(0u, all.poll([](const LogBroadcast::Record &) {}));
+    for (int channel = 1; channel <= 2; ++channel)
+        Logger::setOutputFunction(nullptr, nullptr, channel);
+}
+
+TEST(LogBroadcast, slowSubscriberSeesGaps)
+{
+    auto broadcast = std::make_shared<LogBroadcast>(16, 8);
+    LogBroadcast::Subscriber subscriber(broadcast);
+    for (int i = 0; i < 100; ++i)
+    {
+        auto msg = "record " + std::to_string(i);
+        broadcast->publish(Logger::kInfo, -1, msg.data(), msg.size());
+    }
+    std::vector<std::string> records;
+    EXPECT_EQ(16u, subscriber.poll([&records](const LogBroadcast::Record &r) {
+        EXPECT_TRUE(r.truncated);
+        records.emplace_back(r.data, r.len);
+    }));
+    EXPECT_EQ(84u, subscriber.gaps());
+    EXPECT_EQ("record 8", records.front());
+
+    LogBroadcast::Subscriber backlog(broadcast, true);
+    EXPECT_EQ(16u, backlog.poll([](const LogBroadcast::Record &) {}));
+    EXPECT_EQ(0u, backlog.gaps());
+}
+
+TEST(LogBroadcast, concurrentProducers)
+{
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 50000;
+    auto broadcast = std::make_shared<LogBroadcast>(256, 64);
+    LogBroadcast::Subscriber subscriber(broadcast);
+    std::atomic<int> running{kThreads};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&broadcast, &running, t]() {
+            for (int i = 0; i < kMessages; ++i)
+            {
+                auto msg = std::to_string(t) + " " + std::to_string(i);
+                broadcast->publish(Logger::kInfo, t, msg.data(), msg.size());
+            }
+            --running;
+        });
+    }
+    std::vector<int> last(kThreads, -1);
+    uint64_t delivered = 0;
+    auto check = [&](const LogBroadcast::Record &record) {
+        std::string text(record.data, record.len);
+        int t = std::stoi(text);
+        int i = std::stoi(text.substr(text.find(' ') + 1));
+        ASSERT_EQ(record.channel, t);
+        // No torn record, and the records of a thread stay in order.
+        EXPECT_LT(last[t], i);
+        last[t] = i;
+        ++delivered;
+    };
+    while (running > 0)
+        subscriber.poll(check);
+    for (auto &thread : threads)
+        thread.join();
+    subscriber.poll(check);
+    EXPECT_EQ(uint64_t(kThreads) * kMessages, delivered + subscriber.gaps());
+}
+
+TEST(LogBroadcast, replacedBroadcastsAreReleased)
+{
+    Logger::setOutputFunction(nullptr, nullptr, 5);
+    for (int i = 0; i < 100; ++i)
+    {
+        std::weak_ptr<LogBroadcast> weak;
+        {
+            auto broadcast = std::make_shared<LogBroadcast>(16);
+            weak = broadcast;
+            Logger::setLogBroadcast(std::move(broadcast));
+        }
+        LOG_INFO_TO(5) << "published " << i;
+        Logger::setLogBroadcast(nullptr);
+        EXPECT_TRUE(weak.expired());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
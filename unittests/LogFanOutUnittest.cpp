@@ -0,0 +1,199 @@
+#include <xiaoLog/LogFanOut.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xiaoLog;
+
+class LogFanOutTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        Logger::setOutputFunction(nullptr, nullptr, 0);
+    }
+    void route(LogFanOut &fanOut)
+    {
+        Logger::setRecordFunction(
+            [&fanOut](const LogRecord &record) { fanOut.output(record); },
+            [&fanOut]() { fanOut.flush(); },
+            0);
+    }
+};
+
+TEST_F(LogFanOutTest, levelThresholds)
+{
+    std::vector<std::string> all, warnings;
+    int flushes = 0;
+    {
+        LogFanOut fanOut;
+        fanOut.addSink(
+            [&all](const char *msg, const uint64_t len) {
+                all.emplace_back(msg, len);
+            },
+            nullptr);
+        LogFanOut::SinkOptions options;
+        options.level = Logger::kWarn;
+        fanOut.addSink(
+            [&warnings](const char *msg, const uint64_t len) {
+                warnings.emplace_back(msg, len);
+            },
+            [&flushes]() { ++flushes; },
+            options);
+        fanOut.startLogging();
+        route(fanOut);
+        for (int i = 0; i < 1000; ++i)
+        {
+            LOG_INFO_TO(0) << "info " << i;
+            if (i % 10 == 0)
+                LOG_WARN_TO(0) << "warn " << i;
+        }
+        LOG_ERROR_TO(0) << "error";
+        LOG_RAW_TO(0) << "raw\n";
+    }
+    ASSERT_EQ(1102u, all.size());
+    ASSERT_EQ(102u, warnings.size());
+    EXPECT_NE(std::string::npos, warnings[0].find("warn 0"));
+    EXPECT_NE(std::string::npos, warnings[100].find("error"));
+    EXPECT_EQ("raw\n", warnings[101]);
+    EXPECT_EQ("raw\n", all.back());
+    EXPECT_LE(1, flushes);
+}
+
+TEST_F(LogFanOutTest, stalledSinkDropsAlone)
+{
+    std::atomic<bool> stalled{true};
+    std::atomic<uint64_t> fast{0}, slow{0};
+    uint64_t dropped = 0;
+    {
+        LogFanOut fanOut(1024);
+        fanOut.addSink([&fast](const char *,
+                               const uint64_t) { ++fast; },
+                       nullptr);
+        LogFanOut::SinkOptions options;
+        options.maxQueuedBytes = 8 * 1024;
+        fanOut.addSink(
+            [&stalled, &slow](const char *, const uint64_t) {
+                while (stalled)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++slow;
+            },
+            nullptr,
+            options);
+        fanOut.startLogging();
+        route(fanOut);
+        for (int i = 0; i < 10000; ++i)
+            LOG_INFO_TO(0) << "record " << i;
+        fanOut.flush();
+        // The fast sink isn't held back by the stalled one.
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (fast < 10000 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_EQ(10000u, fast.load());
+        EXPECT_EQ(0u, fanOut.droppedRecords(0));
+        dropped = fanOut.droppedRecords(1);
+        EXPECT_LT(0u, dropped);
+        stalled = false;
+    }
+    EXPECT_EQ(10000u, slow + dropped);
+}
+
+TEST_F(LogFanOutTest, blockingSinkLosesNothing)
+{
+    std::atomic<uint64_t> received{0};
+    {
+        LogFanOut fanOut(1024);
+        LogFanOut::SinkOptions options;
+        options.maxQueuedBytes = 4 * 1024;
+        options.policy = LogFanOut::OverflowPolicy::kBlock;
+        fanOut.addSink(
+            [&received](const char *, const uint64_t) {
+                if (received++ % 100 == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            },
+            nullptr,
+            options);
+        fanOut.startLogging();
+        route(fanOut);
+        for (int i = 0; i < 5000; ++i)
+            LOG_INFO_TO(0) << "record " << i;
+        EXPECT_EQ(0u, fanOut.droppedRecords(0));
+    }
+    EXPECT_EQ(5000u, received.load());
+}
+
+TEST_F(LogFanOutTest, stalledBlockingSinkHoldsOnlyItsProducers)
+{
+    std::atomic<bool> stalled{true};
+    std::atomic<uint64_t> fast{0};
+    std::atomic<bool> lateReceived{false};
+    LogFanOut fanOut(1024);
+    fanOut.addSink(
+        [&fast, &lateReceived](const char *msg, const uint64_t len) {
+            ++fast;
+            if (std::string(msg, len) == "late\n")
+                lateReceived = true;
+        },
+        nullptr);
+    LogFanOut::SinkOptions options;
+    options.maxQueuedBytes = 4 * 1024;
+    options.policy = LogFanOut::OverflowPolicy::kBlock;
+    fanOut.addSink(
+        [&stalled](const char *, const uint64_t) {
+            while (stalled)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        },
+        nullptr,
+        options);
+    fanOut.setFlushInterval(std::chrono::milliseconds(10));
+    fanOut.startLogging();
+    std::thread producer([&fanOut]() {
+        std::string msg(100, 'x');
+        msg += '\n';
+        for (int i = 0; i < 1000; ++i)
+            fanOut.output(msg.data(), msg.size());
+    });
+    // The producer ends up waiting for the blocking sink.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (fast < 50 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // Another producer still appends, and the other sink still gets it.
+    std::string msg = "late\n";
+    fanOut.output(msg.data(), msg.size());
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!lateReceived && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_TRUE(lateReceived.load());
+    stalled = false;
+    producer.join();
+}
+
+TEST_F(LogFanOutTest, flushInterval)
+{
+    std::atomic<int> received{0};
+    LogFanOut fanOut;
+    fanOut.addSink([&received](const char *,
+                               const uint64_t) { ++received; },
+                   nullptr);
+    fanOut.setFlushInterval(std::chrono::milliseconds(10));
+    fanOut.startLogging();
+    route(fanOut);
+    LOG_INFO_TO(0) << "alone";
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (received == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(1, received.load());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+#include <xiaoLog/Logger.h>
+#include <xiaoLog/RequestLogScope.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+struct SavedRecord
+{
+    int64_t microSeconds;
+    int level;
+    uint64_t threadId;
+    std::string sourceFile;
+    int line;
+    std::string func;
+    int channel;
+    std::string text;
+    std::string header;
+    std::string body;
+};
+
+class LogRecordTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        Logger::setRecordFunction(
+            [this](const LogRecord &record) {
+                SavedRecord saved;
+                saved.microSeconds = record.date.microSecondsSinceEpoch();
+                saved.level = record.level;
+                saved.threadId = record.threadId;
+                saved.sourceFile = std::string(record.sourceFile.data_,
+                                               record.sourceFile.size_);
+                saved.line = record.line;
+                saved.func = record.func ? record.func : "";
+                saved.channel = record.channel;
+                saved.text = std::string(record.data, record.length);
+                saved.header = std::string(record.data, record.bodyOffset);
+                saved.body = std::string(record.body(), record.bodyLength);
+                records_.push_back(saved);
+            },
+            nullptr,
+            3);
+    }
+    void TearDown() override
+    {
+        Logger::setOutputFunction(nullptr, nullptr, 3);
+    }
+
+    std::vector<SavedRecord> records_;
+};
+
+TEST_F(LogRecordTest, fields)
+{
+    auto before = Date::now().microSecondsSinceEpoch();
+    LOG_WARN_TO(3) << "hello " << 42;
+    int line = __LINE__ - 1;
+    ASSERT_EQ(1u, records_.size());
+    auto &record = records_[0];
+    EXPECT_LE(before, record.microSeconds);
+    EXPECT_EQ(Logger::kWarn, record.level);
+    EXPECT_NE(0u, record.threadId);
+    EXPECT_EQ("LogRecordUnittest.cpp", record.sourceFile);
+    EXPECT_EQ(line, record.line);
+    EXPECT_EQ(3, record.channel);
+    EXPECT_EQ("hello 42", record.body);
+    EXPECT_EQ(" WARN  ",
+              record.header.substr(record.header.size() - 7));
+    EXPECT_NE(std::string::npos,
+              record.header.find(std::to_string(record.threadId)));
+    EXPECT_EQ(record.header + "hello 42 - LogRecordUnittest.cpp:" +
+                  std::to_string(line) + "\n",
+              record.text);
+}
+
+TEST_F(LogRecordTest, functionAndRawRecords)
+{
+    LOG_DEBUG_TO(3) << "debug";
+    LOG_RAW_TO(3) << "raw";
+    ASSERT_EQ(2u, records_.size());
+    EXPECT_EQ("TestBody", records_[0].func);
+    EXPECT_EQ("debug", records_[0].body);
+    EXPECT_EQ(-1, records_[1].level);
+    EXPECT_EQ(0, records_[1].microSeconds);
+    EXPECT_EQ("raw", records_[1].body);
+    EXPECT_EQ("raw", records_[1].text);
+}
+
+TEST_F(LogRecordTest, textAdapter)
+{
+    std::vector<std::string> texts;
+    Logger::setOutputFunction(
+        [&texts](const char *msg, const uint64_t len) {
+            texts.emplace_back(msg, len);
+        },
+        nullptr,
+        3);
+    LOG_INFO_TO(3) << "text";
+    ASSERT_EQ(1u, texts.size());
+    EXPECT_NE(std::string::npos, texts[0].find(" INFO  text - "));
+    EXPECT_TRUE(records_.empty());
+}
+
+TEST_F(LogRecordTest, heldRecordsKeepTheirFields)
+{
+    {
+        RequestLogScope scope(std::chrono::seconds(10));
+        LOG_INFO_TO(3) << "held";
+        EXPECT_TRUE(records_.empty());
+        scope.fail();
+    }
+    ASSERT_EQ(1u, records_.size());
+    EXPECT_EQ(Logger::kInfo, records_[0].level);
+    EXPECT_EQ("held", records_[0].body);
+    EXPECT_EQ("LogRecordUnittest.cpp", records_[0].sourceFile);
+    EXPECT_NE(0, records_[0].microSeconds);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include <xiaoLog/LogRouter.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <xiaoLog/LogSink.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+using namespace xiaoLog;
+
+class StringSink : public LogSink
+{
+public:
+    void write(const StringPtr &buf) override
+    {
+        data_ += *buf;
+    }
+    size_t count(const std::string &text) const
+    {
+        size_t n = 0;
+        for (auto pos = data_.find(text); pos != std::string::npos;
+             pos = data_.find(text, pos + 1))
+            ++n;
+        return n;
+    }
+
+private:
+    std::string data_;
+};
+
+TEST(LogRouter, routesByChannelAndLevel)
+{
+    auto mainSink = std::make_shared<StringSink>();
+    auto accessSink = std::make_shared<StringSink>();
+    auto errorSink = std::make_shared<StringSink>();
+    {
+        AsyncFileLogger mainLog, accessLog, errorLog;
+        mainLog.setSink(mainSink);
+        accessLog.setSink(accessSink);
+        errorLog.setSink(errorSink);
+        mainLog.startLogging();
+        accessLog.startLogging();
+        errorLog.startLogging();
+        LogRouter router;
+        router.route(-1, mainLog)
+            .route(1, Logger::kInfo, Logger::kFatal, accessLog)
+            .routeAllChannels(Logger::kError, Logger::kFatal, errorLog);
+        router.install();
+        for (int i = 0; i < 100; ++i)
+        {
+            LOG_INFO << "main " << i;
+            LOG_DEBUG_TO(1) << "access debug " << i;
+            LOG_INFO_TO(1) << "access " << i;
+            if (i % 10 == 0)
+            {
+                LOG_ERROR << "main error " << i;
+                LOG_ERROR_TO(1) << "access error " << i;
+                LOG_ERROR_TO(5) << "other error " << i;
+            }
+        }
+        LOG_RAW << "raw main\n";
+        LOG_RAW_TO(1) << "raw access\n";
+        // Back to stdout.
+        Logger::setOutputFunction(
+            [](const char *msg, const uint64_t len) {
+                fwrite(msg, 1, static_cast<size_t>(len), stdout);
+            },
+            []() { fflush(stdout); });
+        for (int channel = 0; channel < LogRouter::kMaxChannels - 1;
+             ++channel)
+            Logger::setOutputFunction(nullptr, nullptr, channel);
+    }
+    EXPECT_EQ(100u, mainSink->count(" INFO  main "));
+    EXPECT_EQ(10u, mainSink->count("main error"));
+    EXPECT_EQ(1u, mainSink->count("raw main"));
+    EXPECT_EQ(0u, mainSink->count("access"));
+    EXPECT_EQ(110u, accessSink->count("access "));
+    EXPECT_EQ(0u, accessSink->count("debug"));
+    // The route of channel 1 doesn't cover all the levels.
+    EXPECT_EQ(0u, accessSink->count("raw"));
+    EXPECT_EQ(10u, errorSink->count("main error"));
+    EXPECT_EQ(10u, errorSink->count("access error"));
+    EXPECT_EQ(10u, errorSink->count("other error"));
+    EXPECT_EQ(30u, errorSink->count(" ERROR "));
+    EXPECT_EQ(0u, errorSink->count("raw"));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
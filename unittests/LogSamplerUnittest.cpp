@@ -0,0 +1,132 @@
+#include <xiaoLog/LogSampler.h>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace xiaoLog;
+
+static int formatted = 0;
+
+static int format(int value)
+{
+    ++formatted;
+    return value;
+}
+
+class LogSamplerTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        Logger::setLogLevel(Logger::kTrace);
+        Logger::setOutputFunction([this](const char *, const uint64_t) {
+            ++records_;
+        },
+                                  []() {});
+        formatted = 0;
+    }
+    void TearDown() override
+    {
+        for (int level = Logger::kTrace; level < Logger::kNumberOfLogLevels;
+             ++level)
+            LogSampler::setRateOfAllChannels(
+                static_cast<Logger::LogLevel>(level), 1);
+        Logger::setOutputFunction(
+            [](const char *msg, const uint64_t len) {
+                fwrite(msg, 1, static_cast<size_t>(len), stdout);
+            },
+            []() { fflush(stdout); });
+        Logger::setLogLevel(Logger::kDebug);
+    }
+
+    int records_{0};
+};
+
+TEST_F(LogSamplerTest, wholeTraces)
+{
+    LogSampler::setRate(Logger::kDebug, 0.1);
+    LogSampler::setRate(Logger::kTrace, 0.1);
+#ifdef NDEBUG
+    // LOG_TRACE_SAMPLED is compiled out like LOG_TRACE.
+    const int recordsPerTrace = 2;
+#else
+    const int recordsPerTrace = 3;
+#endif
+    int kept = 0;
+    for (uint64_t trace = 1; trace <= 10000; ++trace)
+    {
+        LogSampler::Scope scope(trace);
+        int before = records_;
+        LOG_TRACE_SAMPLED << format(1);
+        LOG_DEBUG_SAMPLED << format(2);
+        LOG_DEBUG_SAMPLED << format(3);
+        // All the records of the trace, or none of them.
+        ASSERT_TRUE(records_ - before == 0 ||
+                    records_ - before == recordsPerTrace);
+        if (records_ > before)
+            ++kept;
+    }
+    EXPECT_NEAR(1000, kept, 150);
+    // The skipped records were not formatted.
+    EXPECT_EQ(records_, formatted);
+}
+
+TEST_F(LogSamplerTest, consistentRates)
+{
+    LogSampler::setRate(Logger::kDebug, 0.5);
+    std::string trace = "4bf92f3577b34da6a3ce929d0e0e4736";
+    bool atHalf;
+    {
+        LogSampler::Scope scope(trace);
+        atHalf = LogSampler::sampled(Logger::kDebug);
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(atHalf, LogSampler::sampled(Logger::kDebug));
+    }
+    // Rates are changed at run time, a trace kept at a rate is kept at a
+    // higher one.
+    LogSampler::setRate(Logger::kDebug, 0.75);
+    EXPECT_DOUBLE_EQ(0.75, LogSampler::rate(Logger::kDebug));
+    {
+        LogSampler::Scope scope(trace.data(), trace.size());
+        if (atHalf)
+        {
+            EXPECT_TRUE(LogSampler::sampled(Logger::kDebug));
+        }
+    }
+    LogSampler::setRate(Logger::kDebug, 0);
+    {
+        LogSampler::Scope scope(trace);
+        EXPECT_FALSE(LogSampler::sampled(Logger::kDebug));
+        // Other levels keep their rate.
+        EXPECT_TRUE(LogSampler::sampled(Logger::kInfo));
+    }
+}
+
+TEST_F(LogSamplerTest, channels)
+{
+    Logger::setOutputFunction([this](const char *, const uint64_t) {
+        ++records_;
+    },
+                              []() {},
+                              2);
+    LogSampler::setRate(Logger::kInfo, 0, 2);
+    LogSampler::Scope scope(uint64_t(42));
+    LOG_INFO_SAMPLED << format(1);
+    LOG_INFO_SAMPLED_TO(2) << format(2);
+    EXPECT_EQ(1, records_);
+    EXPECT_EQ(1, formatted);
+    Logger::setOutputFunction(nullptr, nullptr, 2);
+}
+
+TEST_F(LogSamplerTest, outsideTraces)
+{
+    LogSampler::setRate(Logger::kDebug, 0.25);
+    for (int i = 0; i < 10000; ++i)
+        LOG_DEBUG_SAMPLED << format(i);
+    EXPECT_NEAR(2500, records_, 300);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,184 @@
+#include <xiaoLog/Date.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <xiaoLog/ShardedFileLogger.h>
+#include <gtest/gtest.h>
+#include "TestUtils.h"
+#include <stdio.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace xiaoLog;
+
+/**
+ * @brief Run a tool and return what it prints.
+ *
+ */
+static std::string run(const std::string &command, int &status)
+{
+    std::string output;
+    FILE *fp = popen(command.c_str(), "r");
+    if (!fp)
+    {
+        status = -1;
+        return output;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        output.append(buf, n);
+    status = pclose(fp);
+    return output;
+}
+
+static void removeTree(const std::string &dir)
+{
+    DIR *dp = opendir(dir.c_str());
+    if (!dp)
+        return;
+    struct dirent *dirp;
+    struct stat st;
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        std::string fullname = dir + "/" + name;
+        if (name == "." || name == ".." || stat(fullname.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            removeTree(fullname);
+        else
+            remove(fullname.c_str());
+    }
+    closedir(dp);
+    rmdir(dir.c_str());
+}
+
+TEST(LogTools, grepDirectory)
+{
+    const std::string dir = "./grep_unittest";
+    removeTree(dir);
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/20250104").c_str(), 0755);
+    // The records alternate between the current file and a rotated one in
+    // the directory of the day, the current file is split into chunks.
+    std::ofstream current(dir + "/app.log", std::ios::binary);
+    std::ofstream rotated(dir + "/20250104/app.250104-000000.000000.log",
+                          std::ios::binary);
+    const int64_t start = 1736000000LL * MICRO_SECONDS_PRE_SEC;
+    const uint64_t kChunkSize = 8 * 1024 * 1024;
+    uint64_t currentSize = 0;
+    std::string expected;
+    for (int i = 0; i < 300000; ++i)
+    {
+        int64_t time = start + i * 1000;
+        char prefix[64];
+        snprintf(prefix,
+                 sizeof(prefix),
+                 ".%06d UTC 4242 INFO  ",
+                 static_cast<int>(time % MICRO_SECONDS_PRE_SEC));
+        std::string line = Date(time).toFormattedString(false) + prefix +
+                           "message " + std::to_string(i);
+        bool inCurrent = i % 2 == 0;
+        // Every 1000th line matches, and the lines around the chunk
+        // boundary of the current file.
+        bool match = i % 1000 == 0;
+        if (inCurrent && currentSize + 512 > kChunkSize &&
+            currentSize < kChunkSize + 512)
+            match = true;
+        if (match)
+            line += " needle";
+        line += " - test.cc:1\n";
+        if (match)
+            expected += line;
+        if (inCurrent)
+        {
+            current << line;
+            currentSize += line.size();
+        }
+        else
+        {
+            rotated << line;
+        }
+    }
+    current.close();
+    rotated.close();
+    ASSERT_LT(kChunkSize, currentSize);
+
+    int status;
+    auto output = run(std::string(XIAOLOG_GREP) + " -j 4 -b app needle " +
+                          dir,
+                      status);
+    EXPECT_EQ(0, status);
+    // Whole lines, each once, in time order.
+    EXPECT_EQ(expected, output);
+    output = run(std::string(XIAOLOG_GREP) + " -c -b app needle " + dir,
+                 status);
+    EXPECT_EQ(std::to_string(std::count(expected.begin(),
+                                        expected.end(),
+                                        '\n')) +
+                  "\n",
+              output);
+    removeTree(dir);
+}
+
+TEST(LogTools, mergeShards)
+{
+    remove("./merge_unittest.0.log");
+    remove("./merge_unittest.1.log");
+    std::string expected;
+    {
+        auto sequence = std::make_shared<std::atomic<uint64_t>>(0);
+        AsyncFileLogger shards[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            shards[i].setFileName("merge_unittest." + std::to_string(i));
+            shards[i].setSwitchOnLimitOnly();
+            shards[i].setRecordSequence(sequence);
+            shards[i].startLogging();
+        }
+        // Uneven runs, so neither shard holds every other record.
+        for (int i = 0; i < 10000; ++i)
+        {
+            std::string msg = "record " + std::to_string(i) + "\n";
+            expected += msg;
+            shards[(i / 7 + i / 3) % 2].output(msg.data(), msg.size());
+        }
+    }
+    int status;
+    auto output = run(std::string(XIAOLOG_MERGE) +
+                          " ./merge_unittest.0.log ./merge_unittest.1.log",
+                      status);
+    EXPECT_EQ(0, status);
+    EXPECT_EQ(expected, output);
+
+    // The headers are kept with -k, in the global sequence order.
+    output = run(std::string(XIAOLOG_MERGE) +
+                     " -k ./merge_unittest.1.log ./merge_unittest.0.log",
+                 status);
+    EXPECT_EQ(0, status);
+    size_t pos = 0;
+    uint64_t next = 0;
+    while (pos < output.size())
+    {
+        uint64_t seq, len;
+        ASSERT_TRUE(
+            ShardedFileLogger::parseRecordHeader(&output[pos], seq, len));
+        EXPECT_EQ(next++, seq);
+        pos += AsyncFileLogger::kRecordHeaderLength + len;
+    }
+    EXPECT_EQ(10000u, next);
+    remove("./merge_unittest.0.log");
+    remove("./merge_unittest.1.log");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,407 @@
+#include <xiaoLog/LoggerFile.h>
+#include <xiaoLog/LogIndex.h>
+#include <xiaoLog/FramedLog.h>
+#include <gtest/gtest.h>
+#include "TestUtils.h"
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace xiaoLog;
+
+TEST(LoggerFile, mmapWriteMode)
+{
+    remove("./mmap_unittest.log");
+    std::string expected;
+    {
+        LoggerFile file("./",
+                        "mmap_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kMmap);
+        ASSERT_TRUE(static_cast<bool>(file));
+        for (int i = 0; i < 1000; ++i)
+        {
+            auto buf = std::make_shared<std::string>(
+                "this is the " + std::to_string(i) + "th log\n");
+            expected += *buf;
+            file.writeLog(buf);
+        }
+        file.flush();
+        EXPECT_EQ(expected.size(), file.getLength());
+    }
+    EXPECT_EQ(expected, readFile("./mmap_unittest.log"));
+    {
+        // Reopening appends after the real end of the file.
+        LoggerFile file("./",
+                        "mmap_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kMmap);
+        EXPECT_EQ(expected.size(), file.getLength());
+        file.writeLog(std::make_shared<std::string>("last log\n"));
+    }
+    EXPECT_EQ(expected + "last log\n", readFile("./mmap_unittest.log"));
+    remove("./mmap_unittest.log");
+}
+
+TEST(LoggerFile, directWriteMode)
+{
+    remove("./direct_unittest.log");
+    std::string expected;
+    {
+        LoggerFile file("./",
+                        "direct_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kDirect);
+        ASSERT_TRUE(static_cast<bool>(file));
+        for (int i = 0; i < 1000; ++i)
+        {
+            auto buf = std::make_shared<std::string>(
+                "this is the " + std::to_string(i) + "th log\n");
+            expected += *buf;
+            file.writeLog(buf);
+            if (i % 300 == 0)
+                file.flush();
+        }
+        EXPECT_EQ(expected.size(), file.getLength());
+    }
+    EXPECT_EQ(expected, readFile("./direct_unittest.log"));
+    {
+        LoggerFile file("./",
+                        "direct_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kDirect);
+        EXPECT_EQ(expected.size(), file.getLength());
+        file.writeLog(std::make_shared<std::string>("last log\n"));
+    }
+    EXPECT_EQ(expected + "last log\n", readFile("./direct_unittest.log"));
+    remove("./direct_unittest.log");
+}
+
+#ifdef __linux__
+TEST(LoggerFile, directWriteError)
+{
+    // Every write to /dev/full fails with ENOSPC, the staged blocks must be
+    // dropped instead of filling the staging buffer for good.
+    LoggerFile file("/dev/",
+                    "full",
+                    "",
+                    true,
+                    0,
+                    LoggerFile::WriteMode::kDirect);
+    ASSERT_TRUE(static_cast<bool>(file));
+    auto buf = std::make_shared<std::string>(64 * 1024, 'x');
+    for (int i = 0; i < 64; ++i)
+        file.writeLog(buf);
+    file.flush();
+    EXPECT_LT(file.getLength(), buf->size() * 64);
+}
+#endif
+
+TEST(LoggerFile, framedWriteMode)
+{
+    const std::string fileName = "./framed_unittest.log";
+    remove(fileName.c_str());
+    std::string expected;
+    auto makeBuffer = [&expected](int i) {
+        auto buf = std::make_shared<std::string>();
+        for (int j = 0; j < 100; ++j)
+        {
+            buf->append("20250104 10:03:05.123456 UTC 4242 INFO  request " +
+                        std::to_string(i * 100 + j) +
+                        " served in 3ms - handler.cc:42\n");
+        }
+        expected += *buf;
+        return buf;
+    };
+    std::string samples;
+    for (int i = 0; i < 10; ++i)
+        samples += *makeBuffer(i);
+    expected.clear();
+    auto dictionary = FramedLog::trainDictionary(samples, 4096);
+    EXPECT_FALSE(dictionary.empty());
+    EXPECT_LE(dictionary.size(), 4096u);
+    {
+        LoggerFile file("./",
+                        "framed_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kFramed);
+        file.setFrameDictionary(dictionary);
+        for (int i = 0; i < 50; ++i)
+            file.writeLog(makeBuffer(i));
+        file.flush();
+        EXPECT_LT(file.getLength() * 4, expected.size());
+    }
+    {
+        // Reopening appends frames and rewrites the seek table.
+        LoggerFile file("./",
+                        "framed_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kFramed);
+        for (int i = 50; i < 60; ++i)
+            file.writeLog(makeBuffer(i));
+    }
+    EXPECT_TRUE(FramedLog::isFramed(fileName));
+    FramedLogReader reader;
+    ASSERT_TRUE(reader.open(fileName));
+    EXPECT_EQ(60u, reader.frames().size());
+    ASSERT_EQ(expected.size(), reader.rawSize());
+    std::string data(expected.size(), '\0');
+    EXPECT_EQ(expected.size(), reader.pread(&data[0], data.size(), 0));
+    EXPECT_EQ(expected, data);
+    // Any range is read without the frames before it.
+    for (uint64_t offset : {1000ULL, 123456ULL, expected.size() - 10ULL})
+    {
+        std::string range(5000, '\0');
+        range.resize(reader.pread(&range[0], range.size(), offset));
+        EXPECT_EQ(expected.substr(offset, 5000), range);
+    }
+    auto lastFrame = reader.frames().back();
+    reader.close();
+
+    // A file cut in the middle of a frame loses that frame only.
+    ASSERT_EQ(0, truncate(fileName.c_str(), lastFrame.fileOffset + 10));
+    ASSERT_TRUE(reader.open(fileName));
+    EXPECT_EQ(59u, reader.frames().size());
+    EXPECT_EQ(lastFrame.rawOffset, reader.rawSize());
+    std::string frame;
+    EXPECT_TRUE(reader.readFrame(58, frame));
+    EXPECT_EQ(expected.substr(reader.frames()[58].rawOffset, frame.size()),
+              frame);
+    reader.close();
+
+    // A file without a complete frame is empty, it's reopened from scratch.
+    ASSERT_EQ(0, truncate(fileName.c_str(), 10));
+    expected.clear();
+    {
+        LoggerFile file("./",
+                        "framed_unittest",
+                        ".log",
+                        true,
+                        0,
+                        LoggerFile::WriteMode::kFramed);
+        ASSERT_TRUE(static_cast<bool>(file));
+        file.writeLog(makeBuffer(0));
+    }
+    ASSERT_TRUE(reader.open(fileName));
+    EXPECT_EQ(1u, reader.frames().size());
+    data.assign(expected.size(), '\0');
+    EXPECT_EQ(expected.size(), reader.pread(&data[0], data.size(), 0));
+    EXPECT_EQ(expected, data);
+    reader.close();
+    remove(fileName.c_str());
+}
+
+static std::vector<std::string> listFiles(const std::string &dir)
+{
+    std::vector<std::string> names;
+    DIR *dp = opendir(dir.c_str());
+    if (!dp)
+        return names;
+    struct dirent *dirp;
+    while ((dirp = readdir(dp)) != nullptr)
+    {
+        std::string name = dirp->d_name;
+        if (name != "." && name != "..")
+            names.push_back(name);
+    }
+    closedir(dp);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+TEST(LoggerFile, asyncHousekeeping)
+{
+    const std::string dir = "./housekeeping_unittest/";
+    mkdir(dir.c_str(), 0755);
+    for (auto &name : listFiles(dir))
+        remove((dir + name).c_str());
+    {
+        LoggerFile file(dir, "hk", ".log", true, 3);
+        file.setCompressRotatedFiles(true);
+        file.setAsyncHousekeeping(true);
+        for (int i = 0; i < 10; ++i)
+        {
+            file.writeLog(std::make_shared<std::string>(
+                "this is the " + std::to_string(i) + "th file\n"));
+            file.switchLog(true);
+            EXPECT_TRUE(static_cast<bool>(file));
+        }
+        file.writeLog(std::make_shared<std::string>("current\n"));
+    }
+    auto names = listFiles(dir);
+    // Three rotated files are retained and the pre-opened file is removed.
+    ASSERT_EQ(4u, names.size());
+    EXPECT_EQ("hk.log", names.back());
+    EXPECT_EQ("current\n", readFile(dir + "hk.log"));
+    const char *suffix = LoggerFile::hasCompressionSupport() ? ".log.gz" : ".log";
+    for (size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(strlen(suffix),
+                  names[i].size() - names[i].rfind(".log"));
+    }
+    for (auto &name : names)
+        remove((dir + name).c_str());
+    rmdir(dir.c_str());
+}
+
+TEST(LoggerFile, timeRotation)
+{
+    const std::string dir = "./rotation_unittest/";
+    mkdir(dir.c_str(), 0755);
+    {
+        LoggerFile file(dir, "rotation", ".log");
+        file.setRotationPeriod(LoggerFile::RotationPeriod::kHourly);
+        int64_t now = Date::now().secondsSinceEpoch();
+        int64_t nextHour = (now / 3600 + 1) * 3600 * MICRO_SECONDS_PRE_SEC;
+        EXPECT_FALSE(file.timeToSwitch(now * MICRO_SECONDS_PRE_SEC));
+        EXPECT_FALSE(file.timeToSwitch(nextHour - 1));
+        EXPECT_TRUE(file.timeToSwitch(nextHour));
+
+        file.setRotationPeriod(LoggerFile::RotationPeriod::kDaily, true);
+        time_t t = static_cast<time_t>(now);
+        struct tm tm_time;
+        localtime_r(&t, &tm_time);
+        Date nextDay(tm_time.tm_year + 1900,
+                     tm_time.tm_mon + 1,
+                     tm_time.tm_mday + 1);
+        EXPECT_FALSE(file.timeToSwitch(nextDay.microSecondsSinceEpoch() - 1));
+        EXPECT_TRUE(file.timeToSwitch(nextDay.microSecondsSinceEpoch()));
+
+        file.setRotationPeriod(LoggerFile::RotationPeriod::kNone);
+        EXPECT_FALSE(file.timeToSwitch(INT64_MAX - 1));
+
+        // Rotated files go to the directory of the day they were created.
+        file.setDirectoryPerDay(true);
+        file.writeLog(std::make_shared<std::string>("log\n"));
+        file.switchLog(true);
+        auto day = Date::now().toCustomFormattedStringLocal("%Y%m%d");
+        auto names = listFiles(dir + day);
+        ASSERT_EQ(1u, names.size());
+        EXPECT_EQ("log\n", readFile(dir + day + "/" + names[0]));
+        remove((dir + day + "/" + names[0]).c_str());
+        rmdir((dir + day).c_str());
+    }
+    for (auto &name : listFiles(dir))
+        remove((dir + name).c_str());
+    rmdir(dir.c_str());
+}
+
+TEST(LoggerFile, sharedDayDirectories)
+{
+    const std::string dir = "./day_unittest/";
+    const std::string oldDay = dir + "20000101/";
+    mkdir(dir.c_str(), 0755);
+    mkdir(oldDay.c_str(), 0755);
+    const char *oldFiles[] = {"a.000101-000000.000000.log",
+                              "a.000101-000000.000000.log.idx",
+                              "b.000101-000000.000000.log",
+                              "ab.000101-000000.000000.log"};
+    for (auto name : oldFiles)
+    {
+        FILE *fp = fopen((oldDay + name).c_str(), "w");
+        ASSERT_TRUE(fp != nullptr);
+        fputs("old\n", fp);
+        fclose(fp);
+    }
+    {
+        // Only one day is kept, but the old day holds other loggers' files.
+        LoggerFile file(dir, "a", ".log", true, 1);
+        file.setDirectoryPerDay(true);
+        file.writeLog(std::make_shared<std::string>("log\n"));
+        file.switchLog(true);
+    }
+    auto names = listFiles(oldDay);
+    ASSERT_EQ(2u, names.size());
+    EXPECT_EQ("ab.000101-000000.000000.log", names[0]);
+    EXPECT_EQ("b.000101-000000.000000.log", names[1]);
+    for (auto &name : names)
+        remove((oldDay + name).c_str());
+    for (auto &day : listFiles(dir))
+    {
+        for (auto &name : listFiles(dir + day))
+            remove((dir + day + "/" + name).c_str());
+        rmdir((dir + day).c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+TEST(LoggerFile, sparseIndex)
+{
+    const std::string dir = "./index_unittest/";
+    mkdir(dir.c_str(), 0755);
+    static const char *levels[] = {
+        " TRACE ", " DEBUG ", " INFO  ", " WARN  ", " ERROR ", " FATAL "};
+    const int64_t start = 1736000000LL * MICRO_SECONDS_PRE_SEC;
+    uint64_t counts[LogIndex::kNumberOfLevels]{0};
+    std::string rotatedName;
+    {
+        LoggerFile file(dir, "index", ".log", true);
+        file.setIndexInterval(4096);
+        for (int i = 0; i < 2000; ++i)
+        {
+            int64_t time = start + i * 1000;
+            char prefix[64];
+            snprintf(prefix,
+                     sizeof(prefix),
+                     ".%06d UTC 4242",
+                     static_cast<int>(time % MICRO_SECONDS_PRE_SEC));
+            auto buf = std::make_shared<std::string>(
+                Date(time).toFormattedString(false) + prefix + levels[i % 6] +
+                "message " + std::to_string(i) + " - test.cc:1\n");
+            if (i % 10 == 0)
+                buf->append("  a continuation line\n");
+            ++counts[i % 6];
+            file.writeLog(buf);
+        }
+        file.switchLog(true);
+        auto names = listFiles(dir);
+        ASSERT_EQ(4u, names.size());
+        rotatedName = dir + names[0];
+    }
+    std::vector<LogIndex::Block> blocks;
+    ASSERT_TRUE(LogIndex::load(LogIndex::indexFileName(rotatedName), blocks));
+    ASSERT_GT(blocks.size(), 10u);
+    uint64_t offset = 0;
+    uint64_t indexed[LogIndex::kNumberOfLevels]{0};
+    for (auto &block : blocks)
+    {
+        // Contiguous blocks of whole lines.
+        EXPECT_EQ(offset, block.offset);
+        EXPECT_LE(block.minTime, block.maxTime);
+        offset += block.length;
+        for (int i = 0; i < LogIndex::kNumberOfLevels; ++i)
+            indexed[i] += block.counts[i];
+    }
+    EXPECT_EQ(readFile(rotatedName).size(), offset);
+    EXPECT_EQ(start, blocks.front().minTime);
+    EXPECT_EQ(start + 1999 * 1000, blocks.back().maxTime);
+    for (int i = 0; i < LogIndex::kNumberOfLevels; ++i)
+        EXPECT_EQ(counts[i], indexed[i]);
+
+    int64_t time;
+    int level;
+    LogLineParser parser;
+    EXPECT_FALSE(parser.parse("  a continuation line\n", 22, time, level));
+    for (auto &name : listFiles(dir))
+        remove((dir + name).c_str());
+    rmdir(dir.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+#include <xiaoLog/PipeSink.h>
+#include <xiaoLog/AsyncFileLogger.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace xiaoLog;
+
+TEST(PipeSink, slowReader)
+{
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    auto sink = PipeSink::open(fds[1]);
+    ASSERT_TRUE(sink);
+    std::string received;
+    std::thread reader([&received, fd = fds[0]]() {
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0)
+        {
+            received.append(buf, static_cast<size_t>(n));
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+    std::string expected;
+    {
+        AsyncFileLogger logger;
+        logger.setSink(sink);
+        logger.startLogging();
+        for (int i = 0; i < 200000; ++i)
+        {
+            std::string msg = "record " + std::to_string(i) + "\n";
+            expected += msg;
+            logger.output(msg.data(), msg.size());
+        }
+    }
+    sink.reset();
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    EXPECT_EQ(expected, received);
+}
+
+TEST(PipeSink, buffersAreReusedAtOnce)
+{
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    auto sink = PipeSink::open(fds[1]);
+    ASSERT_TRUE(sink);
+    auto buf = std::make_shared<std::string>(10000, 'x');
+    sink->write(buf);
+    EXPECT_EQ(10000u, sink->writtenBytes());
+    // The pipe has its own copy, refilling the buffer doesn't change what
+    // the reader gets.
+    buf->assign(10000, 'y');
+    std::string data(10000, '\0');
+    size_t received = 0;
+    while (received < data.size())
+    {
+        auto n = read(fds[0], &data[received], data.size() - received);
+        ASSERT_GT(n, 0);
+        received += static_cast<size_t>(n);
+    }
+    EXPECT_EQ(std::string(10000, 'x'), data);
+    sink.reset();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(PipeSink, writesToFiles)
+{
+    char path[] = "./pipe_sink_unittest_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    auto sink = PipeSink::open(fd);
+    ASSERT_TRUE(sink);
+    auto buf = std::make_shared<std::string>("not a pipe\n");
+    sink->write(buf);
+    EXPECT_EQ(11u, sink->writtenBytes());
+    char data[64];
+    EXPECT_EQ(11, pread(fd, data, sizeof(data), 0));
+    close(fd);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
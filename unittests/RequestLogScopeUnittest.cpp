@@ -0,0 +1,133 @@
+#include <xiaoLog/RequestLogScope.h>
+#include <xiaoLog/Logger.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xiaoLog;
+
+class RequestLogScopeTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        for (int channel = -1; channel <= 1; ++channel)
+        {
+            Logger::setOutputFunction(
+                [this, channel](const char *msg, const uint64_t len) {
+                    records_.emplace_back(std::to_string(channel) + " " +
+                                          std::string(msg, len));
+                },
+                [this]() { ++flushes_; },
+                channel);
+        }
+    }
+    void TearDown() override
+    {
+        for (int channel = 0; channel <= 1; ++channel)
+            Logger::setOutputFunction(nullptr, nullptr, channel);
+        Logger::setOutputFunction(
+            [](const char *msg, const uint64_t len) {
+                fwrite(msg, 1, static_cast<size_t>(len), stdout);
+            },
+            []() { fflush(stdout); });
+    }
+
+    std::vector<std::string> records_;
+    int flushes_{0};
+};
+
+TEST_F(RequestLogScopeTest, discardsBoringRequests)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        RequestLogScope scope(std::chrono::seconds(10));
+        LOG_INFO << "request " << i;
+        LOG_WARN_TO(1) << "warning " << i;
+        LOG_RAW << "raw " << i;
+    }
+    EXPECT_TRUE(records_.empty());
+    LOG_INFO << "outside";
+    EXPECT_EQ(1u, records_.size());
+}
+
+TEST_F(RequestLogScopeTest, commitsFailedRequests)
+{
+    {
+        RequestLogScope scope(std::chrono::seconds(10));
+        LOG_INFO << "first";
+        LOG_INFO_TO(1) << "second";
+        EXPECT_TRUE(records_.empty());
+        scope.fail();
+    }
+    ASSERT_EQ(2u, records_.size());
+    EXPECT_EQ(0u, records_[0].find("-1 "));
+    EXPECT_NE(std::string::npos, records_[0].find("first"));
+    EXPECT_EQ(0u, records_[1].find("1 "));
+    EXPECT_NE(std::string::npos, records_[1].find("second"));
+
+    // An error fails the request.
+    records_.clear();
+    {
+        RequestLogScope scope(std::chrono::seconds(10));
+        LOG_INFO << "before";
+        LOG_ERROR << "error";
+        EXPECT_TRUE(records_.empty());
+    }
+    ASSERT_EQ(2u, records_.size());
+    EXPECT_NE(std::string::npos, records_[1].find("error"));
+    EXPECT_EQ(1, flushes_);
+}
+
+TEST_F(RequestLogScopeTest, commitsSlowRequests)
+{
+    {
+        RequestLogScope scope(std::chrono::milliseconds(1));
+        LOG_INFO << "slow";
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(1u, records_.size());
+}
+
+TEST_F(RequestLogScopeTest, nestedScopes)
+{
+    {
+        RequestLogScope outer(std::chrono::seconds(10));
+        LOG_INFO << "outer";
+        {
+            RequestLogScope inner(std::chrono::seconds(10));
+            LOG_INFO << "inner";
+            inner.fail();
+        }
+        EXPECT_TRUE(records_.empty());
+        outer.discard();
+        LOG_INFO << "kept";
+        outer.fail();
+    }
+    ASSERT_EQ(1u, records_.size());
+    EXPECT_NE(std::string::npos, records_[0].find("kept"));
+}
+
+TEST_F(RequestLogScopeTest, fullBuffer)
+{
+    auto dropped = RequestLogScope::droppedRecords();
+    {
+        RequestLogScope scope(std::chrono::seconds(10), 1024);
+        for (int i = 0; i < 100; ++i)
+            LOG_INFO << "record " << i;
+        // The error doesn't fit either, but it isn't dropped.
+        LOG_ERROR << "request failed";
+    }
+    EXPECT_LT(1u, records_.size());
+    EXPECT_EQ(101u, records_.size() + RequestLogScope::droppedRecords() -
+                        dropped);
+    EXPECT_NE(std::string::npos, records_[0].find("record 0 "));
+    EXPECT_NE(std::string::npos, records_.back().find("request failed"));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
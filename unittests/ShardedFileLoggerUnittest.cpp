@@ -0,0 +1,64 @@
+#include <xiaoLog/ShardedFileLogger.h>
+#include <gtest/gtest.h>
+#include "TestUtils.h"
+#include <thread>
+#include <set>
+
+using namespace xiaoLog;
+
+TEST(ShardedFileLogger, sequencedShards)
+{
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 10000;
+    {
+        ShardedFileLogger logger(3);
+        logger.setFileName("sharded_unittest");
+        for (size_t i = 0; i < logger.shardNum(); ++i)
+            logger.shard(i).setSwitchOnLimitOnly();
+        logger.startLogging();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&logger, t]() {
+                for (int i = 0; i < kMessages; ++i)
+                {
+                    std::string msg = "thread " + std::to_string(t) + " " +
+                                      std::to_string(i) + "\n";
+                    logger.output(msg.data(), msg.size());
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        logger.flushAndWait();
+    }
+    std::set<uint64_t> seqs;
+    for (int i = 0; i < 3; ++i)
+    {
+        auto name = "./sharded_unittest." + std::to_string(i) + ".log";
+        auto content = readFile(name);
+        remove(name.c_str());
+        size_t pos = 0;
+        uint64_t last = 0;
+        while (pos < content.size())
+        {
+            uint64_t seq, len;
+            ASSERT_TRUE(
+                ShardedFileLogger::parseRecordHeader(&content[pos], seq, len));
+            // Each shard file is in ascending order.
+            EXPECT_LT(last, seq);
+            last = seq;
+            seqs.insert(seq);
+            pos += 26 + len;
+            EXPECT_EQ('\n', content[pos - 1]);
+        }
+    }
+    ASSERT_EQ(static_cast<size_t>(kThreads * kMessages), seqs.size());
+    EXPECT_EQ(*seqs.begin() + kThreads * kMessages - 1, *seqs.rbegin());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <xiaoLog/SharedLogRing.h>
+#include <gtest/gtest.h>
+#include "TestUtils.h"
+#include <sstream>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace xiaoLog;
+
+TEST(SharedLogRing, forkedProducers)
+{
+    constexpr int kWorkers = 4;
+    constexpr int kMessages = 20000;
+    remove("./shared_ring_unittest.log");
+    {
+        // Small rings, so they wrap many times.
+        auto ring = SharedLogRing::create("", 4096, 8);
+        ASSERT_TRUE(ring);
+        SharedLogCollector collector(ring);
+        collector.fileLogger().setFileName("shared_ring_unittest");
+        collector.fileLogger().setSwitchOnLimitOnly();
+        collector.startCollecting();
+        std::vector<pid_t> pids;
+        for (int w = 0; w < kWorkers; ++w)
+        {
+            pid_t pid = fork();
+            ASSERT_GE(pid, 0);
+            if (pid == 0)
+            {
+                for (int i = 0; i < kMessages; ++i)
+                {
+                    std::string msg = "worker " + std::to_string(w) + " " +
+                                      std::to_string(i) + "\n";
+                    ring->output(msg.data(), msg.size());
+                    // Let the collector keep up with the small ring.
+                    if (i % 50 == 0)
+                        usleep(100);
+                }
+                if (w == 0)
+                    kill(getpid(), SIGKILL);
+                _exit(0);
+            }
+            pids.push_back(pid);
+        }
+        for (auto pid : pids)
+            waitpid(pid, nullptr, 0);
+        // The ring of the killed worker is reclaimed, 8 rings are enough for
+        // the next generation of workers.
+        for (int w = 0; w < 8; ++w)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                std::string msg = "late\n";
+                ring->output(msg.data(), msg.size());
+                _exit(0);
+            }
+            waitpid(pid, nullptr, 0);
+            usleep(w == 3 ? 1200000 : 0);
+        }
+        usleep(100000);
+    }
+    auto content = readFile("./shared_ring_unittest.log");
+    remove("./shared_ring_unittest.log");
+    size_t lines = 0, lost = 0, late = 0;
+    std::istringstream in(content);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.find("is lost") != std::string::npos)
+            lost += std::stoul(line);
+        else if (line == "late")
+            ++late;
+        else
+            ++lines;
+    }
+    EXPECT_EQ(static_cast<size_t>(kWorkers * kMessages), lines + lost);
+    EXPECT_EQ(8u, late);
+    EXPECT_NE(std::string::npos, content.find("worker 0 19999\n"));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
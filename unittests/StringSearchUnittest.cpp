@@ -0,0 +1,94 @@
+#include "StringSearch.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+using namespace xiaoLog;
+
+static std::string makePattern(size_t n)
+{
+    std::string pattern;
+    for (size_t i = 0; i < n; ++i)
+        pattern += static_cast<char>('A' + i % 26);
+    return pattern;
+}
+
+static const char *reference(const char *data,
+                             size_t len,
+                             const std::string &pattern)
+{
+    auto end = data + len;
+    auto p = std::search(data, end, pattern.begin(), pattern.end());
+    return p == end ? nullptr : p;
+}
+
+TEST(StringSearch, everyPosition)
+{
+    // The vector blocks are 16 and 32 bytes, the lengths straddle them.
+    const size_t lengths[] = {1, 2, 16, 31, 33};
+    for (auto n : lengths)
+    {
+        auto pattern = makePattern(n);
+        StringSearch search(pattern);
+        // The first and the last byte match, the middle doesn't.
+        std::string decoy = pattern;
+        if (n >= 3)
+            decoy[n / 2] = '#';
+        for (size_t len = 0; len <= 100; ++len)
+        {
+            // Exactly len bytes, a read past the end is caught by the
+            // sanitizers.
+            std::unique_ptr<char[]> text(new char[len + 1]);
+            auto data = text.get();
+            for (size_t i = 0; i < len; ++i)
+                data[i] = n >= 3 ? decoy[i % n] : 'x';
+            EXPECT_EQ(reference(data, len, pattern), search.find(data, len))
+                << "n=" << n << " len=" << len;
+            for (size_t pos = 0; pos + n <= len; ++pos)
+            {
+                std::copy(pattern.begin(), pattern.end(), data + pos);
+                auto found = search.find(data, len);
+                EXPECT_EQ(reference(data, len, pattern), found)
+                    << "n=" << n << " len=" << len << " pos=" << pos;
+                EXPECT_TRUE(found != nullptr && found <= data + pos);
+                for (size_t i = pos; i < pos + n; ++i)
+                    data[i] = n >= 3 ? decoy[i % n] : 'x';
+            }
+        }
+    }
+}
+
+TEST(StringSearch, bufferEnds)
+{
+    const size_t lengths[] = {1, 2, 16, 31, 33};
+    for (auto n : lengths)
+    {
+        auto pattern = makePattern(n);
+        StringSearch search(pattern);
+        for (size_t len = n; len <= 200; len += 7)
+        {
+            std::string text(len, 'x');
+            text.replace(len - n, n, pattern);
+            // At the very end.
+            std::unique_ptr<char[]> buf(new char[len]);
+            std::copy(text.begin(), text.end(), buf.get());
+            EXPECT_EQ(buf.get() + len - n, search.find(buf.get(), len))
+                << "n=" << n << " len=" << len;
+            // Cut by the end of the buffer.
+            EXPECT_EQ(nullptr, search.find(buf.get(), len - 1))
+                << "n=" << n << " len=" << len;
+        }
+        // Longer than the buffer.
+        EXPECT_EQ(nullptr, search.find(pattern.data(), n - 1));
+    }
+    StringSearch empty("");
+    const char data[] = "abc";
+    EXPECT_EQ(data, empty.find(data, 3));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,28 @@
+/**
+ * @file TestUtils.h
+ * @author Guo Xiao (746921314@qq.com)
+ * @brief Helpers shared by the unit tests.
+ * @version 0.1
+ * @date 2025-01-04
+ *
+ *
+ */
+
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Read a whole file, empty if it can't be opened.
+ *
+ * @param fileName
+ */
+inline std::string readFile(const std::string &fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}